@@ -10,6 +10,18 @@
 // the warped sprite drawing function.
 
 #include <climits>       // needed for MIN_ and MAX_INT constants - thanks @Moros1138!
+#include <cfloat>        // needed for DBL_MAX constant
+#include <thread>        // needed for the thread pool of the parallel rendering mode
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <type_traits>   // needed for the precision back-ends of the affine path
+#include <unordered_map> // needed for the mip chain cache
+#include <list>          // needed for the LRU order of the rotation cache
+#include <atomic>        // needed for the instrumentation (see WARP_STATS)
+#include <chrono>
+#include <cstring>       // needed for memcpy() in the sprite scaling
+#include <fstream>       // needed for the tiled textures
 
 #include "ManipulatedSprite.h"
 
@@ -39,6 +51,44 @@ void olc::GetQuadBoundingBox( std::array<olc::vd2d, 4> points, olc::vi2d &UpLeft
     }
 }
 
+// convenience function to obtain the part of scanline y that is spanned by a quad
+// The span is worked out against the convex hull of the four points, by intersecting the scanline with all six
+// segments between them (the four edges and the two diagonals). This works for concave and self intersecting
+// quads as well, since the bilinear patch of a quad never extends beyond the convex hull of its corner points.
+// The span is widened by one pixel at both sides, so that WarpedSample() remains the only arbiter of which pixels
+// are covered, and clamped to [nMinX, nMaxX]. Returns false if the span is empty.
+bool olc::GetQuadScanlineSpan( const std::array<olc::vd2d, 4> &points, int y, int nMinX, int nMaxX, int &nStartX, int &nStopX ) {
+    double dY = double( y );
+    double dLeft  =  DBL_MAX;
+    double dRight = -DBL_MAX;
+    for (int i = 0; i < 3; i++) {
+        for (int j = i + 1; j < 4; j++) {
+            const olc::vd2d &p0 = points[i];
+            const olc::vd2d &p1 = points[j];
+            // skip segments that don't cross this scanline
+            if (dY < std::min( p0.y, p1.y ) || dY > std::max( p0.y, p1.y )) {
+                continue;
+            }
+            if (p0.y == p1.y) {
+                // horizontal segment - the whole segment is on the scanline
+                dLeft  = std::min( dLeft , std::min( p0.x, p1.x ));
+                dRight = std::max( dRight, std::max( p0.x, p1.x ));
+            } else {
+                double dX = p0.x + (dY - p0.y) * (p1.x - p0.x) / (p1.y - p0.y);
+                dLeft  = std::min( dLeft , dX );
+                dRight = std::max( dRight, dX );
+            }
+        }
+    }
+    if (dLeft > dRight) {
+        return false;
+    }
+    // widen by one pixel and clamp - the comparisons are done in double to prevent int overflow
+    nStartX = int( std::max( double( nMinX ), floor( dLeft  ) - 1.0 ));
+    nStopX  = int( std::min( double( nMaxX ), ceil(  dRight ) + 1.0 ));
+    return nStartX <= nStopX;
+}
+
 // convenience function to calculate the interception point of the two diagonals of a quad
 // NOTE: not sure if this is correct since it only accounts for one diagonal
 olc::vi2d olc::GetQuadCenterpoint( std::array<olc::vf2d, 4> points ) {
@@ -110,205 +160,4136 @@ bool olc::WarpedSample( olc::vd2d q, olc::vd2d b1, olc::vd2d b2, olc::vd2d b3, o
             uv.y >= 0.0 && uv.y <= 1.0);
 }
 
-void olc::DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints ) {
+// Instrumentation
+// ---------------
+// Compiled in if WARP_STATS is defined, see GetWarpStats(). The counters are accumulated per thread (no atomics in the
+// inner loops), and added to the global counters of the current entry point of the thread when the outermost entry
+// point returns. The pool threads add theirs when they finish their share of a ParallelFor(), to the entry point of
+// the thread that called it. The phase timers only count the outermost phase, so that e.g. the setup of the quads
+// within a batch counts as rendering time.
+enum WarpStatCounter {
+    WARP_STAT_CALLS = 0,
+    WARP_STAT_BOX,
+    WARP_STAT_TESTED,
+    WARP_STAT_COVERED,
+    WARP_STAT_DRAWN,
+    WARP_STAT_CLIPPED,
+    WARP_STAT_DISCRIMINANT,
+    WARP_STAT_DENOMINATOR,
+    WARP_STAT_OUT_OF_RANGE,
+    WARP_STAT_TEXELS,
+    WARP_STAT_SETUP_NS,
+    WARP_STAT_TEXTURE_NS,
+    WARP_STAT_RENDER_NS,
+    WARP_STAT_COUNT
+};
 
-    // These lambdas return respectively the values q, b1 - b3 from the bilinear interpolation analysis
-    // The b1 - b3 values can be determined once per quad. The q value is associated per pixel
-    auto Get_q  = [=] ( const std::array<olc::vd2d, 4> &cPts, const olc::vd2d &curVert ) -> olc::vd2d { return curVert - cPts[0];                     };
-    auto Get_b1 = [=] ( const std::array<olc::vd2d, 4> &cPts                           ) -> olc::vd2d { return cPts[1] - cPts[0];                     };
-    auto Get_b2 = [=] ( const std::array<olc::vd2d, 4> &cPts                           ) -> olc::vd2d { return cPts[2] - cPts[0];                     };
-    auto Get_b3 = [=] ( const std::array<olc::vd2d, 4> &cPts                           ) -> olc::vd2d { return cPts[0] - cPts[1] - cPts[2] + cPts[3]; };
+#ifdef WARP_STATS
 
-    // note that the corner points are passed in order: ul, ll, lr, ur, but the WarpedSample() algorithm
-    // assumes the order ll, lr, ul, ur. This rearrangement is done here
-    std::array<olc::vd2d, 4> localCornerPoints;
-    localCornerPoints[0] = cornerPoints[1];
-    localCornerPoints[1] = cornerPoints[2];
-    localCornerPoints[2] = cornerPoints[0];
-    localCornerPoints[3] = cornerPoints[3];
+static std::atomic<uint64_t> aWarpStats[int( olc::WarpEntry::COUNT )][WARP_STAT_COUNT];
+static thread_local int nWarpStatsEntry = -1;       // the outermost entry point this thread is in
+static thread_local uint64_t aWarpStatsLocal[WARP_STAT_COUNT];
+static thread_local int nWarpStatsEntryDepth = 0;
+static thread_local int nWarpStatsPhaseDepth = 0;
 
-    // get b1-b3 values from the quad corner points
-    // NOTE: the q value is associated per pixel and is obtained in the nested loop below
-    olc::vd2d b1 = Get_b1( localCornerPoints );
-    olc::vd2d b2 = Get_b2( localCornerPoints );
-    olc::vd2d b3 = Get_b3( localCornerPoints );
+// adds the counters of this thread to those of entry point nEntry (they are dropped if it's -1)
+static void FlushWarpStats( int nEntry ) {
+    for (int i = 0; i < WARP_STAT_COUNT; i++) {
+        if (nEntry >= 0 && aWarpStatsLocal[i] != 0) {
+            aWarpStats[nEntry][i].fetch_add( aWarpStatsLocal[i], std::memory_order_relaxed );
+        }
+        aWarpStatsLocal[i] = 0;
+    }
+}
 
-    // determine the bounding box around the quad
-    olc::vi2d UpperLeft, LowerRight;
-    GetQuadBoundingBox( localCornerPoints, UpperLeft, LowerRight );
+// marks the scope of an entry point
+class WarpStatsEntry {
+public:
+    WarpStatsEntry( olc::WarpEntry entry ) {
+        if (nWarpStatsEntryDepth++ == 0) {
+            FlushWarpStats( nWarpStatsEntry );  // drops what was counted outside of any entry point
+            nWarpStatsEntry = int( entry );
+            aWarpStatsLocal[WARP_STAT_CALLS]++;
+        }
+    }
+    ~WarpStatsEntry() {
+        if (--nWarpStatsEntryDepth == 0) {
+            FlushWarpStats( nWarpStatsEntry );
+            nWarpStatsEntry = -1;
+        }
+    }
+};
+
+// times the scope of a phase
+class WarpStatsPhase {
+public:
+    WarpStatsPhase( WarpStatCounter counter ) : counter( counter ) {
+        if (nWarpStatsPhaseDepth++ == 0) {
+            tStart = std::chrono::steady_clock::now();
+        }
+    }
+    ~WarpStatsPhase() {
+        if (--nWarpStatsPhaseDepth == 0) {
+            aWarpStatsLocal[counter] += uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - tStart ).count());
+        }
+    }
+private:
+    WarpStatCounter counter;
+    std::chrono::steady_clock::time_point tStart;
+};
 
-    // iterate all pixels within the bounding box of the quad...
-    for (int y = UpperLeft.y; y <= LowerRight.y; y++) {
-        for (int x = UpperLeft.x; x <= LowerRight.x; x++) {
-            // ... and render them if sampling produces valid pixel
-            olc::Pixel pix2render;
-            olc::vd2d q = Get_q( localCornerPoints, { (double)x, (double)y } );
+// discards what is counted within its scope (for work that doesn't end up on screen directly)
+class WarpStatsSuspend {
+public:
+    WarpStatsSuspend() {
+        std::copy( aWarpStatsLocal, aWarpStatsLocal + WARP_STAT_COUNT, aSaved );
+    }
+    ~WarpStatsSuspend() {
+        std::copy( aSaved, aSaved + WARP_STAT_COUNT, aWarpStatsLocal );
+    }
+private:
+    uint64_t aSaved[WARP_STAT_COUNT];
+};
 
-            if (WarpedSample( q, b1, b2, b3, pSprite, pix2render )) {
-                gfx->Draw( x, y, pix2render );
-            }
+#define WARP_STATS_ENTRY( entry )       WarpStatsEntry warpStatsEntry( olc::WarpEntry::entry )
+#define WARP_STATS_PHASE( counter )     WarpStatsPhase warpStatsPhase( counter )
+#define WARP_STATS_SUSPEND()            WarpStatsSuspend warpStatsSuspend
+#define WARP_STATS_ADD( counter, n )    (aWarpStatsLocal[counter] += uint64_t( n ))
+#define WARP_STATS_CURRENT_ENTRY()      nWarpStatsEntry
+#define WARP_STATS_FLUSH( entry )       FlushWarpStats( entry )
+
+olc::WarpStatsSnapshot olc::GetWarpStats() {
+    olc::WarpStatsSnapshot snapshot;
+    snapshot.bEnabled = true;
+    for (int e = 0; e < int( olc::WarpEntry::COUNT ); e++) {
+        uint64_t a[WARP_STAT_COUNT];
+        for (int i = 0; i < WARP_STAT_COUNT; i++) {
+            a[i] = aWarpStats[e][i].load( std::memory_order_relaxed );
         }
+        olc::WarpStats &stats = snapshot.entries[e];
+        stats.nCalls              = a[WARP_STAT_CALLS];
+        stats.nBoxPixels          = a[WARP_STAT_BOX];
+        stats.nTestedPixels       = a[WARP_STAT_TESTED];
+        stats.nCoveredPixels      = a[WARP_STAT_COVERED];
+        stats.nDrawnPixels        = a[WARP_STAT_DRAWN];
+        stats.nRejectClipped      = a[WARP_STAT_CLIPPED];
+        stats.nRejectDiscriminant = a[WARP_STAT_DISCRIMINANT];
+        stats.nRejectDenominator  = a[WARP_STAT_DENOMINATOR];
+        stats.nRejectOutOfRange   = a[WARP_STAT_OUT_OF_RANGE];
+        stats.nTexelsFetched      = a[WARP_STAT_TEXELS];
+        stats.fSetupMs   = double( a[WARP_STAT_SETUP_NS  ] ) * 1.0e-6;
+        stats.fTextureMs = double( a[WARP_STAT_TEXTURE_NS] ) * 1.0e-6;
+        stats.fRenderMs  = double( a[WARP_STAT_RENDER_NS ] ) * 1.0e-6;
     }
+    return snapshot;
 }
 
-// I created a variant that allows for clipping left and right of the warped sprite, and takes a shading factor in [0.0f, 1.0f] for pixel rendering
-void olc::DrawWarpedSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeFactor ) {
+void olc::ResetWarpStats() {
+    for (int e = 0; e < int( olc::WarpEntry::COUNT ); e++) {
+        for (int i = 0; i < WARP_STAT_COUNT; i++) {
+            aWarpStats[e][i].store( 0, std::memory_order_relaxed );
+        }
+    }
+}
+
+#else
+
+#define WARP_STATS_ENTRY( entry )
+#define WARP_STATS_PHASE( counter )
+#define WARP_STATS_SUSPEND()
+#define WARP_STATS_ADD( counter, n )
+#define WARP_STATS_CURRENT_ENTRY()      (-1)
+#define WARP_STATS_FLUSH( entry )
+
+olc::WarpStatsSnapshot olc::GetWarpStats() {
+    return olc::WarpStatsSnapshot();
+}
+
+void olc::ResetWarpStats() {
+}
+
+#endif // WARP_STATS
+
+olc::WarpStats olc::WarpStatsSnapshot::Total() const {
+    olc::WarpStats total;
+    for (const olc::WarpStats &stats : entries) {
+        total.nCalls              += stats.nCalls;
+        total.nBoxPixels          += stats.nBoxPixels;
+        total.nTestedPixels       += stats.nTestedPixels;
+        total.nCoveredPixels      += stats.nCoveredPixels;
+        total.nDrawnPixels        += stats.nDrawnPixels;
+        total.nRejectClipped      += stats.nRejectClipped;
+        total.nRejectDiscriminant += stats.nRejectDiscriminant;
+        total.nRejectDenominator  += stats.nRejectDenominator;
+        total.nRejectOutOfRange   += stats.nRejectOutOfRange;
+        total.nTexelsFetched      += stats.nTexelsFetched;
+        total.fSetupMs   += stats.fSetupMs;
+        total.fTextureMs += stats.fTextureMs;
+        total.fRenderMs  += stats.fRenderMs;
+    }
+    return total;
+}
 
-    // These lambdas return respectively the values q, b1 - b3 from the bilinear interpolation analysis
-    // The b1 - b3 values can be determined once per quad. The q value is associated per pixel
-    auto Get_q  = [=] ( const std::array<olc::vd2d, 4> &cPts, const olc::vd2d &curVert ) -> olc::vd2d { return curVert - cPts[0];                     };
-    auto Get_b1 = [=] ( const std::array<olc::vd2d, 4> &cPts                           ) -> olc::vd2d { return cPts[1] - cPts[0];                     };
-    auto Get_b2 = [=] ( const std::array<olc::vd2d, 4> &cPts                           ) -> olc::vd2d { return cPts[2] - cPts[0];                     };
-    auto Get_b3 = [=] ( const std::array<olc::vd2d, 4> &cPts                           ) -> olc::vd2d { return cPts[0] - cPts[1] - cPts[2] + cPts[3]; };
+const char *olc::WarpEntryName( olc::WarpEntry entry ) {
+    switch (entry) {
+        case olc::WarpEntry::DRAW_WARPED         : return "DrawWarpedSprite";
+        case olc::WarpEntry::DRAW_WARPED_CLIPPED : return "DrawWarpedSpriteClipped";
+        case olc::WarpEntry::DRAW_WARPED_SHADED  : return "DrawWarpedSpriteShaded";
+        case olc::WarpEntry::DRAW_PARTIAL_WARPED : return "DrawPartialWarpedSprite";
+        case olc::WarpEntry::DRAW_PROJECTIVE     : return "DrawProjectiveSprite";
+        case olc::WarpEntry::DRAW_AFFINE         : return "DrawAffineSprite";
+        case olc::WarpEntry::DRAW_ROTATED        : return "DrawRotatedSprite";
+        case olc::WarpEntry::DRAW_PARTIAL_ROTATED: return "DrawPartialRotatedSprite";
+        case olc::WarpEntry::DRAW_WARPED_ROTATED : return "DrawWarpedRotatedSprite";
+        case olc::WarpEntry::DRAW_TILED_TEXTURE  : return "DrawWarpedTiledTexture";
+        case olc::WarpEntry::PLAN_DRAW           : return "WarpPlan::Draw";
+        case olc::WarpEntry::BATCH_DRAW          : return "WarpedSpriteBatch::Draw";
+        case olc::WarpEntry::COLUMN_DRAW         : return "WarpColumnRenderer::Draw";
+        default                                  : return "_INVALID_";
+    }
+}
+
+// counts the pixels of the bounding box [UpperLeft, LowerRight] of a quad, and those that fall outside [ClipUL, ClipLR]
+static inline void CountQuadBox( const olc::vi2d &UpperLeft, const olc::vi2d &LowerRight, const olc::vi2d &ClipUL, const olc::vi2d &ClipLR ) {
+#ifdef WARP_STATS
+    auto Area = []( const olc::vi2d &ul, const olc::vi2d &lr ) {
+        return (ul.x > lr.x || ul.y > lr.y) ? uint64_t( 0 ) : uint64_t( lr.x - ul.x + 1 ) * uint64_t( lr.y - ul.y + 1 );
+    };
+    uint64_t nBox = Area( UpperLeft, LowerRight );
+    WARP_STATS_ADD( WARP_STAT_BOX, nBox );
+    WARP_STATS_ADD( WARP_STAT_CLIPPED, nBox - Area( UpperLeft.max( ClipUL ), LowerRight.min( ClipLR )));
+#else
+    (void)UpperLeft; (void)LowerRight; (void)ClipUL; (void)ClipLR;
+#endif
+}
+
+// same as above, clipped to the draw target of gfx and the columns [nClipLeft, nClipRight]
+static inline void CountQuadBox( olc::PixelGameEngine *gfx, const olc::vi2d &UpperLeft, const olc::vi2d &LowerRight, int nClipLeft, int nClipRight ) {
+    olc::Sprite *pTarget = gfx->GetDrawTarget();
+    if (pTarget != nullptr) {
+        CountQuadBox( UpperLeft, LowerRight, { std::max( 0, nClipLeft ), 0 }, { std::min( pTarget->width - 1, nClipRight ), pTarget->height - 1 } );
+    }
+}
+
+// This struct holds all values of the bilinear interpolation analysis that are constant per quad
+struct WarpSetup {
+    std::array<olc::vd2d, 4> points;    // quad corner points in the order ll, lr, ul, ur
+    olc::vd2d b1, b2, b3;
+    double A      = 0.0;                // quadratic coefficient (constant per quad)
+    double A4     = 0.0;                // 4 * A, used in discriminant
+    double Inv2A  = 0.0;                // 0.5 / A, so that solving for v costs a multiply instead of a divide
+    double W12    = 0.0;                // wedge( b1, b2 ), the constant part of B
+    double dB     = 0.0;                // delta of B per pixel in x direction
+    double dC     = 0.0;                // delta of C per pixel in x direction
+    bool   bLinear = false;             // true if A is (near) zero, and the linear form must be solved
+    bool   bAffine = false;             // true if the quad is a parallelogram (b3 == 0), so that the mapping is linear
+    double InvW12  = 0.0;               // 1.0 / W12, for solving the linear mapping of the affine case
+    olc::vi2d UpperLeft, LowerRight;    // bounding box around the quad
+    const int *pSpans = nullptr;        // optional: start and stop x of the quad per row of the bounding box (see WarpPlan)
+    bool   bConvex = false;             // true if the quad is strictly convex with the winding that WarpedSample() covers
+    double aEdges[4][3];                // if bConvex: the edges as a * x + b * y + c, the distance in pixels (positive inside)
+    // single precision copies of the per quad constants, for the float back-end
+    olc::vf2d fb1, fb2, fb3;
+    float  fA4 = 0.0f, fInv2A = 0.0f, fdB = 0.0f, fdC = 0.0f;
+};
+
+// Works out the per quad constants for the bilinear interpolation from the quad corner points
+static void SetupWarp( const std::array<olc::vd2d, 4> &cornerPoints, WarpSetup &ws ) {
+    WARP_STATS_PHASE( WARP_STAT_SETUP_NS );
+
+    // These lambdas return respectively the values b1 - b3 from the bilinear interpolation analysis
+    auto Get_b1 = [=] ( const std::array<olc::vd2d, 4> &cPts ) -> olc::vd2d { return cPts[1] - cPts[0];                     };
+    auto Get_b2 = [=] ( const std::array<olc::vd2d, 4> &cPts ) -> olc::vd2d { return cPts[2] - cPts[0];                     };
+    auto Get_b3 = [=] ( const std::array<olc::vd2d, 4> &cPts ) -> olc::vd2d { return cPts[0] - cPts[1] - cPts[2] + cPts[3]; };
 
     // note that the corner points are passed in order: ul, ll, lr, ur, but the WarpedSample() algorithm
     // assumes the order ll, lr, ul, ur. This rearrangement is done here
-    std::array<olc::vd2d, 4> localCornerPoints;
-    localCornerPoints[0] = cornerPoints[1];
-    localCornerPoints[1] = cornerPoints[2];
-    localCornerPoints[2] = cornerPoints[0];
-    localCornerPoints[3] = cornerPoints[3];
+    ws.points[0] = cornerPoints[1];
+    ws.points[1] = cornerPoints[2];
+    ws.points[2] = cornerPoints[0];
+    ws.points[3] = cornerPoints[3];
 
     // get b1-b3 values from the quad corner points
-    // NOTE: the q value is associated per pixel and is obtained in the nested loop below
-    olc::vd2d b1 = Get_b1( localCornerPoints );
-    olc::vd2d b2 = Get_b2( localCornerPoints );
-    olc::vd2d b3 = Get_b3( localCornerPoints );
+    ws.b1 = Get_b1( ws.points );
+    ws.b2 = Get_b2( ws.points );
+    ws.b3 = Get_b3( ws.points );
+
+    // the A coefficient of the quadratic formula is constant per quad, as is the b1 x b2 part of B
+    ws.A   = ws.b2.x * ws.b3.y - ws.b2.y * ws.b3.x;
+    ws.W12 = ws.b1.x * ws.b2.y - ws.b1.y * ws.b2.x;
+    ws.bLinear = fabs( ws.A ) < NEAR_ZERO;
+    ws.A4    = 4.0 * ws.A;
+    ws.dB    = -ws.b3.y;
+    ws.dC    = -ws.b1.y;
+    ws.Inv2A = ws.bLinear ? 0.0 : 0.5 / ws.A;
+
+    // if b3 is zero the quad is a parallelogram, and the bilinear mapping reduces to a linear (affine) one
+    ws.bAffine = (ws.b3.x == 0.0 && ws.b3.y == 0.0);
+    ws.InvW12  = (fabs( ws.W12 ) < NEAR_ZERO) ? 0.0 : 1.0 / ws.W12;
 
     // determine the bounding box around the quad
-    olc::vi2d UpperLeft, LowerRight;
-    GetQuadBoundingBox( localCornerPoints, UpperLeft, LowerRight );
+    olc::GetQuadBoundingBox( ws.points, ws.UpperLeft, ws.LowerRight );
+
+    // for the block classification (see ClassifyBlock()) the edges are needed in the order ll, lr, ur, ul. The bilinear
+    // inverse only covers quads with this winding (the cross products are negative with y pointing down), and for
+    // convex ones, the covered pixels are exactly the ones inside all four edges
+    const olc::vd2d *pEdgePts[4] = { &ws.points[0], &ws.points[1], &ws.points[3], &ws.points[2] };
+    ws.bConvex = true;
+    for (int i = 0; i < 4; i++) {
+        const olc::vd2d &p0 = *pEdgePts[i];
+        const olc::vd2d &p1 = *pEdgePts[(i + 1) % 4];
+        const olc::vd2d &p2 = *pEdgePts[(i + 2) % 4];
+        olc::vd2d d = p1 - p0;
+        double dLen = d.mag();
+        if (d.cross( p2 - p1 ) >= 0.0 || dLen < NEAR_ZERO) {
+            ws.bConvex = false;
+            break;
+        }
+        ws.aEdges[i][0] =  d.y / dLen;
+        ws.aEdges[i][1] = -d.x / dLen;
+        ws.aEdges[i][2] = (d.x * p0.y - d.y * p0.x) / dLen;
+    }
+
+    // the float back-end starts from the double values, so that it only rounds once
+    ws.fb1    = ws.b1;
+    ws.fb2    = ws.b2;
+    ws.fb3    = ws.b3;
+    ws.fA4    = float( ws.A4    );
+    ws.fInv2A = float( ws.Inv2A );
+    ws.fdB    = float( ws.dB    );
+    ws.fdC    = float( ws.dC    );
+}
+
+// The texels to sample from. This is either a whole sprite, or a rectangular part of one for the partial draw
+// functions. nStride is the width of the sprite the texels are in, so that a part is sampled in place, without
+// copying it into a sprite of its own.
+struct TextureCache;
+struct OpacityIndex;
+
+struct WarpTexture {
+    const olc::Pixel *pTexels = nullptr;    // the upper left texel
+    int nWidth  = 0;                        // size of the (part of the) sprite
+    int nHeight = 0;
+    int nStride = 0;                        // nr of texels from one row to the next
+    const TextureCache *pCache = nullptr;   // the cached mip chain and / or tiled copy of the sprite, if enabled (see GetCachedTexture())
+    const olc::Pixel *pTiled = nullptr;     // the texels in tiled layout (see TiledIndex()), if enabled
+    const OpacityIndex *pOpacity = nullptr; // where the opaque texels are, if transparent texels may be skipped (see RenderQuad())
+    int nTilesX = 0;                        // nr of tiles per row of the tiled layout
+    // for trilinear filtering: the next (smaller) mip level, its weight in [0, 256], and the ratio of its size to
+    // the size of this level in 16.16 fixed point
+    const WarpTexture *pNext = nullptr;
+    uint32_t nNextWeight = 0;
+    int32_t  nNextScaleX = 0, nNextScaleY = 0;
+};
+
+// returns the texture for the whole of pSprite
+static WarpTexture GetSpriteTexture( const olc::Sprite *pSprite ) {
+    WarpTexture tex;
+    if (pSprite != nullptr) {
+        tex.pTexels = pSprite->pColData.data();
+        tex.nWidth  = pSprite->width;
+        tex.nHeight = pSprite->height;
+        tex.nStride = pSprite->width;
+    }
+    return tex;
+}
+
+// Gets the texture for the part of pSprite at source_pos with size source_size (both are truncated to whole texels,
+// as Sprite::Duplicate() does). Returns false if the part doesn't lie within the sprite completely.
+static bool GetPartialTexture( const olc::Sprite *pSprite, const olc::vi2d &source_pos, const olc::vi2d &source_size, WarpTexture &tex ) {
+    if (pSprite == nullptr || source_pos.x < 0 || source_pos.y < 0 || source_size.x <= 0 || source_size.y <= 0 ||
+        source_pos.x + source_size.x > pSprite->width || source_pos.y + source_size.y > pSprite->height) {
+        return false;
+    }
+    tex.pTexels = pSprite->pColData.data() + source_pos.y * pSprite->width + source_pos.x;
+    tex.nWidth  = source_size.x;
+    tex.nHeight = source_size.y;
+    tex.nStride = pSprite->width;
+    return true;
+}
+
+// The values of the bilinear interpolation analysis at the start of a span. The span kernels below work out the
+// values for pixel i of the span as B = B0 + dB * i etc, so that each pixel can be evaluated independently of the
+// others. This makes the scalar and the SIMD kernels produce exactly the same results.
+struct WarpSpanParams {
+    double qx0 = 0.0;           // q at the start of the span
+    double qy  = 0.0;
+    double B0  = 0.0;           // B and C at the start of the span
+    double C0  = 0.0;
+    int nOffset = 0;            // index of the first pixel to process, relative to the span start
+    int nCount  = 0;            // nr of pixels to process
+};
 
-    int x_strt = std::max( UpperLeft.x, nClipLeft );
-    int x_stop = std::min( LowerRight.x, nClipRight );
+// A span kernel evaluates the bilinear inverse for sp.nCount pixels and reads the texels for the covered ones.
+// Per pixel it sets pCovered[i] to 1 (covered) or 0 (not covered), and for the covered pixels it sets pColours[i].
+// If pU and pV are not nullptr, the kernel passes back u and v for the covered pixels instead of reading the texels
+// (this is used for sampling modes other than nearest). All arrays must be padded to a multiple of MAX_KERNEL_LANES entries.
+typedef void (*WarpKernelFunc)( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV );
 
-    // iterate all pixels within the bounding box of the quad...
-    for (int x = x_strt; x <= x_stop; x++) {
-        for (int y = UpperLeft.y; y <= LowerRight.y; y++) {
-            // ... and render them if sampling produces valid pixel
-            olc::Pixel pix2render;
-            olc::vd2d q = Get_q( localCornerPoints, { (double)x, (double)y } );
+#define MAX_KERNEL_LANES    8
 
-            if (WarpedSample( q, b1, b2, b3, pSprite, pix2render )) {
-                gfx->Draw( x, y, pix2render * fShadeFactor );
+// This is the reference kernel - the SIMD kernels must produce the same coverage and texels
+static void WarpKernel_Scalar( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV ) {
+    const olc::vd2d &b1 = ws.b1;
+    const olc::vd2d &b2 = ws.b2;
+    const olc::vd2d &b3 = ws.b3;
+    // the texels are read directly from the sprite data, which is safe since u and v are checked to be in range
+    const olc::Pixel *pTexels = tex.pTexels;
+    double dW = double( tex.nWidth  );
+    double dH = double( tex.nHeight );
+
+    for (int i = 0; i < sp.nCount; i++) {
+        pCovered[i] = 0;
+        double di = double( sp.nOffset + i );
+        double qx = sp.qx0 + di;
+        double B  = sp.B0 + ws.dB * di;
+        double C  = sp.C0 + ws.dC * di;
+        // Solve for v
+        double v;
+        if (ws.bLinear) {
+            // Linear form
+            if (fabs( B ) < NEAR_ZERO) {
+                continue;
+            }
+            v = -C / B;
+        } else {
+            // Quadratic form: Take positive root for CCW winding with V-up
+            double D = B * B - ws.A4 * C;
+            if (D <= 0.0) {     // if discriminant <= 0, then the point is not inside the quad
+                continue;
+            }
+            v = (sqrt( D ) - B) * ws.Inv2A;
+        }
+        if (v < 0.0 || v > 1.0) {
+            continue;
+        }
+        // Solve for u, using largest magnitude component
+        double denom_x = b1.x + b3.x * v;
+        double denom_y = b1.y + b3.y * v;
+        double u;
+        if (fabs( denom_x ) > fabs( denom_y )) {
+            if (fabs( denom_x ) < NEAR_ZERO) {
+                continue;
+            }
+            u = (qx - b2.x * v) / denom_x;
+        } else {
+            if (fabs( denom_y ) < NEAR_ZERO) {
+                continue;
             }
+            u = (sp.qy - b2.y * v) / denom_y;
+        }
+        if (u < 0.0 || u > 1.0) {
+            continue;
+        }
+        pCovered[i] = 1;
+        if (pU != nullptr) {
+            pU[i] = u;
+            pV[i] = v;
+            continue;
         }
+        // Note that vertical texel coord is mirrored because the algorithm assumes positive y to go up
+        int sx = int( std::min( u * dW, dW - 1.0 ));
+        int sy = int( std::min( (1.0 - v) * dH, dH - 1.0 ));
+        pColours[i] = pTexels[sy * tex.nStride + sx];
     }
 }
 
-// Draws a sprite with 4 arbitrary points, warping the texture to look "correct"
-void olc::DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const olc::vf2d(&pos)[4] ) {
-    std::array<olc::vf2d, 4> localPoints;
-    for (int i = 0; i < 4; i++) {
-        localPoints[i] = pos[i];
+// Same as WarpKernel_Scalar(), but in single precision (the float back-end, see SetWarpPrecision()). The span values
+// are rounded from the double ones, so the error doesn't build up along the span.
+static void WarpKernel_FloatScalar( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV ) {
+    const olc::vf2d &b1 = ws.fb1;
+    const olc::vf2d &b2 = ws.fb2;
+    const olc::vf2d &b3 = ws.fb3;
+    const olc::Pixel *pTexels = tex.pTexels;
+    const float fNearZero = float( NEAR_ZERO );
+    float fW  = float( tex.nWidth  );
+    float fH  = float( tex.nHeight );
+    float qx0 = float( sp.qx0 );
+    float qy  = float( sp.qy  );
+    float B0  = float( sp.B0  );
+    float C0  = float( sp.C0  );
+
+    for (int i = 0; i < sp.nCount; i++) {
+        pCovered[i] = 0;
+        float di = float( sp.nOffset + i );
+        float qx = qx0 + di;
+        float B  = B0 + ws.fdB * di;
+        float C  = C0 + ws.fdC * di;
+        // Solve for v
+        float v;
+        if (ws.bLinear) {
+            if (fabsf( B ) < fNearZero) {
+                continue;
+            }
+            v = -C / B;
+        } else {
+            float D = B * B - ws.fA4 * C;
+            if (D <= 0.0f) {
+                continue;
+            }
+            // For (near) parallelograms A is tiny, and sqrt( D ) - B cancels out if B is positive, which loses all
+            // significant digits in single precision. The same root is then worked out as 2C / (-B - sqrt( D )).
+            float sq = sqrtf( D );
+            v = (B >= 0.0f) ? (C + C) / (-B - sq) : (sq - B) * ws.fInv2A;
+        }
+        if (v < 0.0f || v > 1.0f) {
+            continue;
+        }
+        // Solve for u, using largest magnitude component
+        float denom_x = b1.x + b3.x * v;
+        float denom_y = b1.y + b3.y * v;
+        float u;
+        if (fabsf( denom_x ) > fabsf( denom_y )) {
+            if (fabsf( denom_x ) < fNearZero) {
+                continue;
+            }
+            u = (qx - b2.x * v) / denom_x;
+        } else {
+            if (fabsf( denom_y ) < fNearZero) {
+                continue;
+            }
+            u = (qy - b2.y * v) / denom_y;
+        }
+        if (u < 0.0f || u > 1.0f) {
+            continue;
+        }
+        pCovered[i] = 1;
+        if (pU != nullptr) {
+            pU[i] = u;
+            pV[i] = v;
+            continue;
+        }
+        int sx = int( std::min( u * fW, fW - 1.0f ));
+        int sy = int( std::min( (1.0f - v) * fH, fH - 1.0f ));
+        pColours[i] = pTexels[sy * tex.nStride + sx];
     }
-    DrawWarpedSprite( gfx, pSprite, localPoints );
 }
 
-// Draws a sprite with 4 arbitrary points, warping the texture to look "correct"
-void olc::DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const olc::vf2d *pos ) {
-    std::array<olc::vf2d, 4> localPoints;
-    for (int i = 0; i < 4; i++) {
-        localPoints[i] = pos[i];
+// SIMD kernels
+// ------------
+// The SIMD kernels evaluate 2 (SSE2, SSE4.1) or 4 (AVX2) pixels per iteration in double precision, using exactly
+// the same operations as WarpKernel_Scalar(), and are selected at runtime depending on the CPU capabilities.
+// NOTE: if the module is compiled with FMA contraction enabled (e.g. -march=native with gcc), the scalar kernel
+//       may round slightly differently, which can affect the coverage of individual pixels on the quad edges.
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+    #define WARP_SIMD_X86
+#endif
+
+#ifdef WARP_SIMD_X86
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+    #include <intrin.h>
+    #define WARP_TARGET( x )
+#else
+    #define WARP_TARGET( x ) __attribute__(( target( x )))
+#endif
+
+WARP_TARGET( "sse2" )
+static void WarpKernel_SSE2( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV ) {
+    const olc::Pixel *pTexels = tex.pTexels;
+    const __m128d vAbs   = _mm_castsi128_pd( _mm_set1_epi64x( 0x7FFFFFFFFFFFFFFFLL ));
+    const __m128d vSign  = _mm_castsi128_pd( _mm_set1_epi64x( (long long)0x8000000000000000ULL ));
+    const __m128d vNZ    = _mm_set1_pd( NEAR_ZERO );
+    const __m128d vZero  = _mm_setzero_pd();
+    const __m128d vOne   = _mm_set1_pd( 1.0 );
+    const __m128d vB0    = _mm_set1_pd( sp.B0  ), vdB = _mm_set1_pd( ws.dB );
+    const __m128d vC0    = _mm_set1_pd( sp.C0  ), vdC = _mm_set1_pd( ws.dC );
+    const __m128d vqx0   = _mm_set1_pd( sp.qx0 ), vqy = _mm_set1_pd( sp.qy );
+    const __m128d vA4    = _mm_set1_pd( ws.A4 ), vInv2A = _mm_set1_pd( ws.Inv2A );
+    const __m128d vb1x   = _mm_set1_pd( ws.b1.x ), vb1y = _mm_set1_pd( ws.b1.y );
+    const __m128d vb2x   = _mm_set1_pd( ws.b2.x ), vb2y = _mm_set1_pd( ws.b2.y );
+    const __m128d vb3x   = _mm_set1_pd( ws.b3.x ), vb3y = _mm_set1_pd( ws.b3.y );
+    const __m128d vW     = _mm_set1_pd( double( tex.nWidth  )), vW1 = _mm_set1_pd( double( tex.nWidth  - 1 ));
+    const __m128d vH     = _mm_set1_pd( double( tex.nHeight )), vH1 = _mm_set1_pd( double( tex.nHeight - 1 ));
+    const __m128d vStride = _mm_set1_pd( double( tex.nStride ));
+    // select between a and b using mask (all bits set selects a)
+    auto Select = []( __m128d mask, __m128d a, __m128d b ) { return _mm_or_pd( _mm_and_pd( mask, a ), _mm_andnot_pd( mask, b )); };
+
+    __m128d vIdx = _mm_set_pd( double( sp.nOffset + 1 ), double( sp.nOffset ));
+    const __m128d vStep = _mm_set1_pd( 2.0 );
+    for (int i = 0; i < sp.nCount; i += 2, vIdx = _mm_add_pd( vIdx, vStep )) {
+        __m128d B  = _mm_add_pd( vB0, _mm_mul_pd( vdB, vIdx ));
+        __m128d C  = _mm_add_pd( vC0, _mm_mul_pd( vdC, vIdx ));
+        __m128d qx = _mm_add_pd( vqx0, vIdx );
+        // Solve for v
+        __m128d v, vAccept;
+        if (ws.bLinear) {
+            vAccept = _mm_cmpge_pd( _mm_and_pd( B, vAbs ), vNZ );
+            v = _mm_div_pd( _mm_xor_pd( C, vSign ), B );
+        } else {
+            __m128d D = _mm_sub_pd( _mm_mul_pd( B, B ), _mm_mul_pd( vA4, C ));
+            vAccept = _mm_cmpgt_pd( D, vZero );
+            v = _mm_mul_pd( _mm_sub_pd( _mm_sqrt_pd( D ), B ), vInv2A );
+        }
+        vAccept = _mm_and_pd( vAccept, _mm_and_pd( _mm_cmpge_pd( v, vZero ), _mm_cmple_pd( v, vOne )));
+        // Solve for u, using largest magnitude component
+        __m128d dx  = _mm_add_pd( vb1x, _mm_mul_pd( vb3x, v ));
+        __m128d dy  = _mm_add_pd( vb1y, _mm_mul_pd( vb3y, v ));
+        __m128d adx = _mm_and_pd( dx, vAbs );
+        __m128d ady = _mm_and_pd( dy, vAbs );
+        __m128d sel = _mm_cmpgt_pd( adx, ady );
+        __m128d num = Select( sel, _mm_sub_pd( qx, _mm_mul_pd( vb2x, v )), _mm_sub_pd( vqy, _mm_mul_pd( vb2y, v )));
+        __m128d den = Select( sel, dx , dy  );
+        vAccept = _mm_and_pd( vAccept, _mm_cmpge_pd( Select( sel, adx, ady ), vNZ ));
+        __m128d u = _mm_div_pd( num, den );
+        vAccept = _mm_and_pd( vAccept, _mm_and_pd( _mm_cmpge_pd( u, vZero ), _mm_cmple_pd( u, vOne )));
+        // work out the texel index as sy * stride + sx - all values are integers, so this is exact in double
+        __m128d sx = _mm_cvtepi32_pd( _mm_cvttpd_epi32( _mm_min_pd( _mm_mul_pd( u, vW ), vW1 )));
+        __m128d sy = _mm_cvtepi32_pd( _mm_cvttpd_epi32( _mm_min_pd( _mm_mul_pd( _mm_sub_pd( vOne, v ), vH ), vH1 )));
+        __m128i idx = _mm_cvttpd_epi32( _mm_add_pd( _mm_mul_pd( sy, vStride ), sx ));
+
+        int nMask = _mm_movemask_pd( vAccept );
+        pCovered[i    ] = (nMask     ) & 1;
+        pCovered[i + 1] = (nMask >> 1) & 1;
+        if (pU != nullptr) {
+            _mm_storeu_pd( pU + i, u );
+            _mm_storeu_pd( pV + i, v );
+            continue;
+        }
+        if (nMask & 1) pColours[i    ] = pTexels[_mm_cvtsi128_si32( idx )];
+        if (nMask & 2) pColours[i + 1] = pTexels[_mm_cvtsi128_si32( _mm_srli_si128( idx, 4 ))];
     }
-    DrawWarpedSprite( gfx, pSprite, localPoints );
 }
 
-// calculates new coordinates for each of the quadPoints, by rotating them with dAngle around centerPoint
-void olc::RotateQuadPoints( std::array<olc::vd2d, 4> &quadPoints, double dAngle, olc::vd2d centerPoint ) {
-    double dCosTheta = cos( dAngle );
-    double dSinTheta = sin( dAngle );
-    // iterate quad points
-    for (int i = 0; i < 4; i++) {
-        // first translate point so that center point aligns with origin
-        quadPoints[i] -= centerPoint;
-        // rotate point - because x component is altered and used for calculating y component
-        // a cache is applied
-        olc::vd2d cachePoint = quadPoints[i];
-        quadPoints[i].x = cachePoint.x * dCosTheta - cachePoint.y * dSinTheta;
-        quadPoints[i].y = cachePoint.x * dSinTheta + cachePoint.y * dCosTheta;
-        // translate back
-        quadPoints[i] += centerPoint;
+WARP_TARGET( "sse4.1" )
+static void WarpKernel_SSE41( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV ) {
+    const olc::Pixel *pTexels = tex.pTexels;
+    const __m128d vAbs   = _mm_castsi128_pd( _mm_set1_epi64x( 0x7FFFFFFFFFFFFFFFLL ));
+    const __m128d vSign  = _mm_castsi128_pd( _mm_set1_epi64x( (long long)0x8000000000000000ULL ));
+    const __m128d vNZ    = _mm_set1_pd( NEAR_ZERO );
+    const __m128d vZero  = _mm_setzero_pd();
+    const __m128d vOne   = _mm_set1_pd( 1.0 );
+    const __m128d vB0    = _mm_set1_pd( sp.B0  ), vdB = _mm_set1_pd( ws.dB );
+    const __m128d vC0    = _mm_set1_pd( sp.C0  ), vdC = _mm_set1_pd( ws.dC );
+    const __m128d vqx0   = _mm_set1_pd( sp.qx0 ), vqy = _mm_set1_pd( sp.qy );
+    const __m128d vA4    = _mm_set1_pd( ws.A4 ), vInv2A = _mm_set1_pd( ws.Inv2A );
+    const __m128d vb1x   = _mm_set1_pd( ws.b1.x ), vb1y = _mm_set1_pd( ws.b1.y );
+    const __m128d vb2x   = _mm_set1_pd( ws.b2.x ), vb2y = _mm_set1_pd( ws.b2.y );
+    const __m128d vb3x   = _mm_set1_pd( ws.b3.x ), vb3y = _mm_set1_pd( ws.b3.y );
+    const __m128d vW     = _mm_set1_pd( double( tex.nWidth  )), vW1 = _mm_set1_pd( double( tex.nWidth  - 1 ));
+    const __m128d vH     = _mm_set1_pd( double( tex.nHeight )), vH1 = _mm_set1_pd( double( tex.nHeight - 1 ));
+    const __m128i vWi    = _mm_set1_epi32( tex.nStride );
+
+    __m128d vIdx = _mm_set_pd( double( sp.nOffset + 1 ), double( sp.nOffset ));
+    const __m128d vStep = _mm_set1_pd( 2.0 );
+    for (int i = 0; i < sp.nCount; i += 2, vIdx = _mm_add_pd( vIdx, vStep )) {
+        __m128d B  = _mm_add_pd( vB0, _mm_mul_pd( vdB, vIdx ));
+        __m128d C  = _mm_add_pd( vC0, _mm_mul_pd( vdC, vIdx ));
+        __m128d qx = _mm_add_pd( vqx0, vIdx );
+        // Solve for v
+        __m128d v, vAccept;
+        if (ws.bLinear) {
+            vAccept = _mm_cmpge_pd( _mm_and_pd( B, vAbs ), vNZ );
+            v = _mm_div_pd( _mm_xor_pd( C, vSign ), B );
+        } else {
+            __m128d D = _mm_sub_pd( _mm_mul_pd( B, B ), _mm_mul_pd( vA4, C ));
+            vAccept = _mm_cmpgt_pd( D, vZero );
+            v = _mm_mul_pd( _mm_sub_pd( _mm_sqrt_pd( D ), B ), vInv2A );
+        }
+        vAccept = _mm_and_pd( vAccept, _mm_and_pd( _mm_cmpge_pd( v, vZero ), _mm_cmple_pd( v, vOne )));
+        // Solve for u, using largest magnitude component
+        __m128d dx  = _mm_add_pd( vb1x, _mm_mul_pd( vb3x, v ));
+        __m128d dy  = _mm_add_pd( vb1y, _mm_mul_pd( vb3y, v ));
+        __m128d adx = _mm_and_pd( dx, vAbs );
+        __m128d ady = _mm_and_pd( dy, vAbs );
+        __m128d sel = _mm_cmpgt_pd( adx, ady );
+        __m128d num = _mm_blendv_pd( _mm_sub_pd( vqy, _mm_mul_pd( vb2y, v )), _mm_sub_pd( qx, _mm_mul_pd( vb2x, v )), sel );
+        __m128d den = _mm_blendv_pd( dy , dx , sel );
+        vAccept = _mm_and_pd( vAccept, _mm_cmpge_pd( _mm_blendv_pd( ady, adx, sel ), vNZ ));
+        __m128d u = _mm_div_pd( num, den );
+        vAccept = _mm_and_pd( vAccept, _mm_and_pd( _mm_cmpge_pd( u, vZero ), _mm_cmple_pd( u, vOne )));
+        // work out the texel index as sy * width + sx
+        __m128i sx  = _mm_cvttpd_epi32( _mm_min_pd( _mm_mul_pd( u, vW ), vW1 ));
+        __m128i sy  = _mm_cvttpd_epi32( _mm_min_pd( _mm_mul_pd( _mm_sub_pd( vOne, v ), vH ), vH1 ));
+        __m128i idx = _mm_add_epi32( _mm_mullo_epi32( sy, vWi ), sx );
+
+        int nMask = _mm_movemask_pd( vAccept );
+        pCovered[i    ] = (nMask     ) & 1;
+        pCovered[i + 1] = (nMask >> 1) & 1;
+        if (pU != nullptr) {
+            _mm_storeu_pd( pU + i, u );
+            _mm_storeu_pd( pV + i, v );
+            continue;
+        }
+        if (nMask & 1) pColours[i    ] = pTexels[_mm_extract_epi32( idx, 0 )];
+        if (nMask & 2) pColours[i + 1] = pTexels[_mm_extract_epi32( idx, 1 )];
     }
 }
 
-// Draws a sprite rotated to specified angle, with point of rotation offset
-void olc::DrawRotatedSprite( PixelGameEngine *gfx, const olc::vf2d& pos, olc::Sprite *pSprite, const float fAngle, const olc::vf2d& center, const olc::vf2d& scale ) {
-    // prepare call to RotateQuadPoints()
-    std::array<olc::vd2d, 4> localPoints;
-    olc::vd2d ul = pos;
-    olc::vd2d lr = pos + olc::vd2d( pSprite->width * scale.x, pSprite->height * scale.y );
-    localPoints[0] = olc::vd2d( ul.x, ul.y );
-    localPoints[1] = olc::vd2d( ul.x, lr.y );
-    localPoints[2] = olc::vd2d( lr.x, lr.y );
-    localPoints[3] = olc::vd2d( lr.x, ul.y );
-    olc::vd2d dCenterPoint = olc::vd2d( double( center.x ), double( center.y ));
-    // rotate the points
-    RotateQuadPoints( localPoints, double( fAngle ), dCenterPoint );
-    // convert back to float type
-    std::array<olc::vf2d, 4> renderPoints;
-    for (int i = 0; i < 4; i++) {
-        renderPoints[i] = localPoints[i];
+WARP_TARGET( "avx2" )
+static void WarpKernel_AVX2( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV ) {
+    const int *pTexels = (const int *)tex.pTexels;
+    const __m256d vAbs   = _mm256_castsi256_pd( _mm256_set1_epi64x( 0x7FFFFFFFFFFFFFFFLL ));
+    const __m256d vSign  = _mm256_castsi256_pd( _mm256_set1_epi64x( (long long)0x8000000000000000ULL ));
+    const __m256d vNZ    = _mm256_set1_pd( NEAR_ZERO );
+    const __m256d vZero  = _mm256_setzero_pd();
+    const __m256d vOne   = _mm256_set1_pd( 1.0 );
+    const __m256d vB0    = _mm256_set1_pd( sp.B0  ), vdB = _mm256_set1_pd( ws.dB );
+    const __m256d vC0    = _mm256_set1_pd( sp.C0  ), vdC = _mm256_set1_pd( ws.dC );
+    const __m256d vqx0   = _mm256_set1_pd( sp.qx0 ), vqy = _mm256_set1_pd( sp.qy );
+    const __m256d vA4    = _mm256_set1_pd( ws.A4 ), vInv2A = _mm256_set1_pd( ws.Inv2A );
+    const __m256d vb1x   = _mm256_set1_pd( ws.b1.x ), vb1y = _mm256_set1_pd( ws.b1.y );
+    const __m256d vb2x   = _mm256_set1_pd( ws.b2.x ), vb2y = _mm256_set1_pd( ws.b2.y );
+    const __m256d vb3x   = _mm256_set1_pd( ws.b3.x ), vb3y = _mm256_set1_pd( ws.b3.y );
+    const __m256d vW     = _mm256_set1_pd( double( tex.nWidth  )), vW1 = _mm256_set1_pd( double( tex.nWidth  - 1 ));
+    const __m256d vH     = _mm256_set1_pd( double( tex.nHeight )), vH1 = _mm256_set1_pd( double( tex.nHeight - 1 ));
+    const __m128i vWi    = _mm_set1_epi32( tex.nStride );
+    // gathers the lower 32 bits of each 64 bit lane into the lower 128 bits
+    const __m256i vPack  = _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 );
+
+    double dOffset = double( sp.nOffset );
+    __m256d vIdx = _mm256_setr_pd( dOffset, dOffset + 1.0, dOffset + 2.0, dOffset + 3.0 );
+    const __m256d vStep = _mm256_set1_pd( 4.0 );
+    for (int i = 0; i < sp.nCount; i += 4, vIdx = _mm256_add_pd( vIdx, vStep )) {
+        __m256d B  = _mm256_add_pd( vB0, _mm256_mul_pd( vdB, vIdx ));
+        __m256d C  = _mm256_add_pd( vC0, _mm256_mul_pd( vdC, vIdx ));
+        __m256d qx = _mm256_add_pd( vqx0, vIdx );
+        // Solve for v
+        __m256d v, vAccept;
+        if (ws.bLinear) {
+            vAccept = _mm256_cmp_pd( _mm256_and_pd( B, vAbs ), vNZ, _CMP_GE_OQ );
+            v = _mm256_div_pd( _mm256_xor_pd( C, vSign ), B );
+        } else {
+            __m256d D = _mm256_sub_pd( _mm256_mul_pd( B, B ), _mm256_mul_pd( vA4, C ));
+            vAccept = _mm256_cmp_pd( D, vZero, _CMP_GT_OQ );
+            v = _mm256_mul_pd( _mm256_sub_pd( _mm256_sqrt_pd( D ), B ), vInv2A );
+        }
+        vAccept = _mm256_and_pd( vAccept, _mm256_and_pd( _mm256_cmp_pd( v, vZero, _CMP_GE_OQ ), _mm256_cmp_pd( v, vOne, _CMP_LE_OQ )));
+        // Solve for u, using largest magnitude component
+        __m256d dx  = _mm256_add_pd( vb1x, _mm256_mul_pd( vb3x, v ));
+        __m256d dy  = _mm256_add_pd( vb1y, _mm256_mul_pd( vb3y, v ));
+        __m256d adx = _mm256_and_pd( dx, vAbs );
+        __m256d ady = _mm256_and_pd( dy, vAbs );
+        __m256d sel = _mm256_cmp_pd( adx, ady, _CMP_GT_OQ );
+        __m256d num = _mm256_blendv_pd( _mm256_sub_pd( vqy, _mm256_mul_pd( vb2y, v )), _mm256_sub_pd( qx, _mm256_mul_pd( vb2x, v )), sel );
+        __m256d den = _mm256_blendv_pd( dy , dx , sel );
+        vAccept = _mm256_and_pd( vAccept, _mm256_cmp_pd( _mm256_blendv_pd( ady, adx, sel ), vNZ, _CMP_GE_OQ ));
+        __m256d u = _mm256_div_pd( num, den );
+        vAccept = _mm256_and_pd( vAccept, _mm256_and_pd( _mm256_cmp_pd( u, vZero, _CMP_GE_OQ ), _mm256_cmp_pd( u, vOne, _CMP_LE_OQ )));
+        int nMask = _mm256_movemask_pd( vAccept );
+        pCovered[i    ] = (nMask     ) & 1;
+        pCovered[i + 1] = (nMask >> 1) & 1;
+        pCovered[i + 2] = (nMask >> 2) & 1;
+        pCovered[i + 3] = (nMask >> 3) & 1;
+        if (pU != nullptr) {
+            _mm256_storeu_pd( pU + i, u );
+            _mm256_storeu_pd( pV + i, v );
+            continue;
+        }
+        // work out the texel index as sy * width + sx
+        __m128i sx  = _mm256_cvttpd_epi32( _mm256_min_pd( _mm256_mul_pd( u, vW ), vW1 ));
+        __m128i sy  = _mm256_cvttpd_epi32( _mm256_min_pd( _mm256_mul_pd( _mm256_sub_pd( vOne, v ), vH ), vH1 ));
+        __m128i idx = _mm_add_epi32( _mm_mullo_epi32( sy, vWi ), sx );
+        // gather the texels, using index 0 for lanes that are not covered
+        __m128i vMask32 = _mm256_castsi256_si128( _mm256_permutevar8x32_epi32( _mm256_castpd_si256( vAccept ), vPack ));
+        __m128i vTexels = _mm_i32gather_epi32( pTexels, _mm_and_si128( idx, vMask32 ), 4 );
+        _mm_storeu_si128( (__m128i *)( pColours + i ), vTexels );
     }
-    // render sprite using the rotated cornerpoints
-    DrawWarpedSprite( gfx, pSprite, renderPoints );
 }
 
-// renders a warped sprite that is rotated around centerPoint by fAngle
-void olc::DrawWarpedRotatedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint ) {
-    // copy quad corner points
-    std::array<olc::vd2d, 4> rotatedPoints;
-    for (int i = 0; i < 4; i++) {
-        rotatedPoints[i] = cornerPoints[i];
+// Single precision variant of WarpKernel_AVX2(), that processes 8 pixels per iteration. Produces the same result
+// as WarpKernel_FloatScalar().
+WARP_TARGET( "avx2" )
+static void WarpKernel_FloatAVX2( const WarpSetup &ws, const WarpSpanParams &sp, const WarpTexture &tex, uint8_t *pCovered, olc::Pixel *pColours, double *pU, double *pV ) {
+    const int *pTexels = (const int *)tex.pTexels;
+    const __m256 vAbs   = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7FFFFFFF ));
+    const __m256 vSign  = _mm256_castsi256_ps( _mm256_set1_epi32( (int)0x80000000U ));
+    const __m256 vNZ    = _mm256_set1_ps( float( NEAR_ZERO ));
+    const __m256 vZero  = _mm256_setzero_ps();
+    const __m256 vOne   = _mm256_set1_ps( 1.0f );
+    const __m256 vB0    = _mm256_set1_ps( float( sp.B0  )), vdB = _mm256_set1_ps( ws.fdB );
+    const __m256 vC0    = _mm256_set1_ps( float( sp.C0  )), vdC = _mm256_set1_ps( ws.fdC );
+    const __m256 vqx0   = _mm256_set1_ps( float( sp.qx0 )), vqy = _mm256_set1_ps( float( sp.qy ));
+    const __m256 vA4    = _mm256_set1_ps( ws.fA4 ), vInv2A = _mm256_set1_ps( ws.fInv2A );
+    const __m256 vb1x   = _mm256_set1_ps( ws.fb1.x ), vb1y = _mm256_set1_ps( ws.fb1.y );
+    const __m256 vb2x   = _mm256_set1_ps( ws.fb2.x ), vb2y = _mm256_set1_ps( ws.fb2.y );
+    const __m256 vb3x   = _mm256_set1_ps( ws.fb3.x ), vb3y = _mm256_set1_ps( ws.fb3.y );
+    const __m256 vW     = _mm256_set1_ps( float( tex.nWidth  )), vW1 = _mm256_set1_ps( float( tex.nWidth  ) - 1.0f );
+    const __m256 vH     = _mm256_set1_ps( float( tex.nHeight )), vH1 = _mm256_set1_ps( float( tex.nHeight ) - 1.0f );
+    const __m256i vWi   = _mm256_set1_epi32( tex.nStride );
+
+    __m256 vIdx = _mm256_add_ps( _mm256_set1_ps( float( sp.nOffset )), _mm256_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f ));
+    const __m256 vStep = _mm256_set1_ps( 8.0f );
+    for (int i = 0; i < sp.nCount; i += 8, vIdx = _mm256_add_ps( vIdx, vStep )) {
+        __m256 B  = _mm256_add_ps( vB0, _mm256_mul_ps( vdB, vIdx ));
+        __m256 C  = _mm256_add_ps( vC0, _mm256_mul_ps( vdC, vIdx ));
+        __m256 qx = _mm256_add_ps( vqx0, vIdx );
+        // Solve for v
+        __m256 v, vAccept;
+        if (ws.bLinear) {
+            vAccept = _mm256_cmp_ps( _mm256_and_ps( B, vAbs ), vNZ, _CMP_GE_OQ );
+            v = _mm256_div_ps( _mm256_xor_ps( C, vSign ), B );
+        } else {
+            __m256 D = _mm256_sub_ps( _mm256_mul_ps( B, B ), _mm256_mul_ps( vA4, C ));
+            vAccept = _mm256_cmp_ps( D, vZero, _CMP_GT_OQ );
+            // the root without cancellation, as in WarpKernel_FloatScalar()
+            __m256 sq = _mm256_sqrt_ps( D );
+            __m256 vStable = _mm256_div_ps( _mm256_add_ps( C, C ), _mm256_sub_ps( _mm256_xor_ps( B, vSign ), sq ));
+            v = _mm256_blendv_ps( _mm256_mul_ps( _mm256_sub_ps( sq, B ), vInv2A ), vStable, _mm256_cmp_ps( B, vZero, _CMP_GE_OQ ));
+        }
+        vAccept = _mm256_and_ps( vAccept, _mm256_and_ps( _mm256_cmp_ps( v, vZero, _CMP_GE_OQ ), _mm256_cmp_ps( v, vOne, _CMP_LE_OQ )));
+        // Solve for u, using largest magnitude component
+        __m256 dx  = _mm256_add_ps( vb1x, _mm256_mul_ps( vb3x, v ));
+        __m256 dy  = _mm256_add_ps( vb1y, _mm256_mul_ps( vb3y, v ));
+        __m256 adx = _mm256_and_ps( dx, vAbs );
+        __m256 ady = _mm256_and_ps( dy, vAbs );
+        __m256 sel = _mm256_cmp_ps( adx, ady, _CMP_GT_OQ );
+        __m256 num = _mm256_blendv_ps( _mm256_sub_ps( vqy, _mm256_mul_ps( vb2y, v )), _mm256_sub_ps( qx, _mm256_mul_ps( vb2x, v )), sel );
+        __m256 den = _mm256_blendv_ps( dy , dx , sel );
+        vAccept = _mm256_and_ps( vAccept, _mm256_cmp_ps( _mm256_blendv_ps( ady, adx, sel ), vNZ, _CMP_GE_OQ ));
+        __m256 u = _mm256_div_ps( num, den );
+        vAccept = _mm256_and_ps( vAccept, _mm256_and_ps( _mm256_cmp_ps( u, vZero, _CMP_GE_OQ ), _mm256_cmp_ps( u, vOne, _CMP_LE_OQ )));
+        int nMask = _mm256_movemask_ps( vAccept );
+        for (int k = 0; k < 8; k++) {
+            pCovered[i + k] = (nMask >> k) & 1;
+        }
+        if (pU != nullptr) {
+            _mm256_storeu_pd( pU + i    , _mm256_cvtps_pd( _mm256_castps256_ps128( u )));
+            _mm256_storeu_pd( pU + i + 4, _mm256_cvtps_pd( _mm256_extractf128_ps( u, 1 )));
+            _mm256_storeu_pd( pV + i    , _mm256_cvtps_pd( _mm256_castps256_ps128( v )));
+            _mm256_storeu_pd( pV + i + 4, _mm256_cvtps_pd( _mm256_extractf128_ps( v, 1 )));
+            continue;
+        }
+        // work out the texel index as sy * width + sx
+        __m256i sx  = _mm256_cvttps_epi32( _mm256_min_ps( _mm256_mul_ps( u, vW ), vW1 ));
+        __m256i sy  = _mm256_cvttps_epi32( _mm256_min_ps( _mm256_mul_ps( _mm256_sub_ps( vOne, v ), vH ), vH1 ));
+        __m256i idx = _mm256_add_epi32( _mm256_mullo_epi32( sy, vWi ), sx );
+        // gather the texels, using index 0 for lanes that are not covered
+        __m256i vTexels = _mm256_i32gather_epi32( pTexels, _mm256_and_si256( idx, _mm256_castps_si256( vAccept )), 4 );
+        _mm256_storeu_si256( (__m256i *)( pColours + i ), vTexels );
     }
-    // convert float parameters to doubles
-    double dAngle = double( fAngle );
-    olc::vd2d dCenterPoint( centerPoint );
+}
 
-    // rotate them around center point
-    RotateQuadPoints( rotatedPoints, dAngle, dCenterPoint );
-    // convert back to correct type
-    std::array<olc::vf2d, 4> localPoints;
-    for (int i = 0; i < 4; i++) {
-        localPoints[i] = rotatedPoints[i];
+// returns the highest SIMD level that is supported by both the CPU and the OS
+static olc::WarpSimd DetectWarpSimd() {
+    bool bSSE2 = false, bSSE41 = false, bAVX2 = false;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid( info, 0 );
+    int nMaxLeaf = info[0];
+    __cpuid( info, 1 );
+    bSSE2  = (info[3] & (1 << 26)) != 0;
+    bSSE41 = (info[2] & (1 << 19)) != 0;
+    // AVX2 needs OS support for saving the ymm registers as well
+    bool bOSXSave = (info[2] & (1 << 27)) != 0;
+    if (nMaxLeaf >= 7 && bOSXSave && (_xgetbv( 0 ) & 6) == 6) {
+        __cpuidex( info, 7, 0 );
+        bAVX2 = (info[1] & (1 << 5)) != 0;
     }
-    // draw sprite using rotated cornerpoints
-    DrawWarpedSprite( gfx, pSprite, localPoints );
+#else
+    __builtin_cpu_init();
+    bSSE2  = __builtin_cpu_supports( "sse2"   );
+    bSSE41 = __builtin_cpu_supports( "sse4.1" );
+    bAVX2  = __builtin_cpu_supports( "avx2"   );
+#endif
+    if (bAVX2 ) return olc::WarpSimd::AVX2;
+    if (bSSE41) return olc::WarpSimd::SSE41;
+    if (bSSE2 ) return olc::WarpSimd::SSE2;
+    return olc::WarpSimd::SCALAR;
 }
 
-// Pretty much the same as DrawRotatedSprite(), but only a part of the sprite is rendered
-void olc::DrawPartialRotatedSprite(
-    PixelGameEngine *gfx,
-    const olc::vf2d& pos,           // location on screen for the (unrotated) sprite origin
-    olc::Sprite *pSprite,           // pointer to the sprite to draw
-    const float fAngle,             // angle and centerpoint to rotate around
-    const olc::vf2d& center,
-    const olc::vf2d& source_pos,    // origin and size of the part of the sprite to render
-    const olc::vf2d& source_size,
-    const olc::vf2d& scale          // scaling factors in two directions
-) {
+#else
 
-    // prepare call to RotateQuadPoints()
-    std::array<olc::vd2d, 4> localPoints;
-    olc::vd2d ul = pos;
-    olc::vd2d lr = pos + olc::vd2d( pSprite->width * scale.x, pSprite->height * scale.y );
-    localPoints[0] = olc::vd2d( ul.x, ul.y );
-    localPoints[1] = olc::vd2d( ul.x, lr.y );
-    localPoints[2] = olc::vd2d( lr.x, lr.y );
-    localPoints[3] = olc::vd2d( lr.x, ul.y );
-    olc::vd2d dCenterPoint = olc::vd2d( double( center.x ), double( center.y ));
-    // rotate the points
-    RotateQuadPoints( localPoints, double( fAngle ), dCenterPoint );
-    // convert back to float type
-    std::array<olc::vf2d, 4> renderPoints;
-    for (int i = 0; i < 4; i++) {
-        renderPoints[i] = localPoints[i];
+static olc::WarpSimd DetectWarpSimd() {
+    return olc::WarpSimd::SCALAR;
+}
+
+#endif // WARP_SIMD_X86
+
+// the highest supported SIMD level and the currently selected one
+static const olc::WarpSimd enWarpSimdMax = DetectWarpSimd();
+static       olc::WarpSimd enWarpSimd    = enWarpSimdMax;
+
+void olc::SetWarpSimd( olc::WarpSimd level ) {
+    enWarpSimd = std::min( level, enWarpSimdMax );
+}
+
+olc::WarpSimd olc::GetWarpSimd() {
+    return enWarpSimd;
+}
+
+// Precision modes
+// ---------------
+// the currently selected precision back-end
+static olc::WarpPrecision enWarpPrecision = olc::WarpPrecision::DOUBLE;
+
+void olc::SetWarpPrecision( olc::WarpPrecision precision ) {
+    enWarpPrecision = precision;
+}
+
+olc::WarpPrecision olc::GetWarpPrecision() {
+    return enWarpPrecision;
+}
+
+// returns the kernel for the currently selected SIMD level and the given precision
+static WarpKernelFunc GetWarpKernel( olc::WarpPrecision precision ) {
+    if (precision == olc::WarpPrecision::FLOAT) {
+#ifdef WARP_SIMD_X86
+        if (enWarpSimd == olc::WarpSimd::AVX2) {
+            return WarpKernel_FloatAVX2;
+        }
+#endif
+        return WarpKernel_FloatScalar;
+    }
+    switch (enWarpSimd) {
+#ifdef WARP_SIMD_X86
+        case olc::WarpSimd::AVX2 : return WarpKernel_AVX2;
+        case olc::WarpSimd::SSE41: return WarpKernel_SSE41;
+        case olc::WarpSimd::SSE2 : return WarpKernel_SSE2;
+#endif
+        default: break;
+    }
+    return WarpKernel_Scalar;
+}
+
+// Samplers
+// --------
+// The texel lookup is a compile time parameter of the renderer, so that each sampling mode gets its own inner loop.
+
+// the currently selected sampling mode
+static olc::WarpSampler enWarpSampler = olc::WarpSampler::NEAREST;
+
+void olc::SetWarpSampler( olc::WarpSampler sampler ) {
+    enWarpSampler = sampler;
+}
+
+olc::WarpSampler olc::GetWarpSampler() {
+    return enWarpSampler;
+}
+
+// linear interpolation between two pixels (all four channels), with weight w in [0, 256]
+// the red/blue and green/alpha channel pairs are interpolated in one multiply each
+static inline uint32_t LerpPixel( uint32_t a, uint32_t b, uint32_t w ) {
+    uint32_t rb = (( a       & 0x00FF00FF) * (256 - w) + ( b       & 0x00FF00FF) * w) >> 8;
+    uint32_t ga = (((a >> 8) & 0x00FF00FF) * (256 - w) + ((b >> 8) & 0x00FF00FF) * w);
+    return (rb & 0x00FF00FF) | (ga & 0xFF00FF00);
+}
+
+// Bilinear filtered texel lookup at texel coordinates (tx, ty), with clamping at the sprite borders, and fixed point
+// (8 bit) weights. The renderers sample at whole pixel coordinates, that map onto the texel origins for unscaled
+// sprites, so the texels are taken to be located at their origin (not their center). This way an unscaled sprite
+// is rendered exactly the same as with the nearest sampler.
+static inline olc::Pixel SampleBilinearLevel( const WarpTexture &tex, int32_t fx, int32_t fy ) {
+    // (fx, fy) are in 16.16 fixed point, the upper 8 bits of the fraction are the weights
+    int x0 = fx >> 16;
+    int y0 = fy >> 16;
+    uint32_t wx = (uint32_t( fx ) >> 8) & 0xFF;
+    uint32_t wy = (uint32_t( fy ) >> 8) & 0xFF;
+    int xa = std::max( 0, std::min( x0    , tex.nWidth  - 1 ));
+    int xb = std::max( 0, std::min( x0 + 1, tex.nWidth  - 1 ));
+    int ya = std::max( 0, std::min( y0    , tex.nHeight - 1 ));
+    int yb = std::max( 0, std::min( y0 + 1, tex.nHeight - 1 ));
+    const olc::Pixel *pRowA = tex.pTexels + ya * tex.nStride;
+    const olc::Pixel *pRowB = tex.pTexels + yb * tex.nStride;
+    uint32_t top = LerpPixel( pRowA[xa].n, pRowA[xb].n, wx );
+    uint32_t bot = LerpPixel( pRowB[xa].n, pRowB[xb].n, wx );
+    return olc::Pixel( LerpPixel( top, bot, wy ));
+}
+
+// Bilinear filtered texel lookup at 16.16 fixed point texel coordinates (fx, fy). If tex has a next mip level
+// (trilinear filtering), the samples from both levels are blended as well
+static inline olc::Pixel SampleBilinearFixed( const WarpTexture &tex, int32_t fx, int32_t fy ) {
+    olc::Pixel result = SampleBilinearLevel( tex, fx, fy );
+    if (tex.pNext != nullptr) {
+        int32_t nx = int32_t( (int64_t( fx ) * tex.nNextScaleX) >> 16 );
+        int32_t ny = int32_t( (int64_t( fy ) * tex.nNextScaleY) >> 16 );
+        result.n = LerpPixel( result.n, SampleBilinearLevel( *tex.pNext, nx, ny ).n, tex.nNextWeight );
+    }
+    return result;
+}
+
+// Same as SampleBilinearFixed(), for texel coordinates (tx, ty) in double
+static inline olc::Pixel SampleBilinear( const WarpTexture &tex, double tx, double ty ) {
+    return SampleBilinearFixed( tex, int32_t( floor( tx * 65536.0 )), int32_t( floor( ty * 65536.0 )));
+}
+
+// nr of texels read per sample, for the instrumentation
+template <olc::WarpSampler SAMPLER>
+static inline uint64_t TexelsPerSample( const WarpTexture &tex ) {
+    return (SAMPLER == olc::WarpSampler::NEAREST) ? 1 : ((tex.pNext != nullptr) ? 8 : 4);
+}
+
+// Texture cache
+// -------------
+// Two derived versions of a sprite can be built the first time it's drawn, and cached per sprite:
+//
+// Mip mapping - when a large sprite is drawn onto a small quad, each screen pixel skips many texels. This aliases,
+// and jumps all over the sprite in memory. The mip chain holds ever smaller versions of the sprite (each one half the
+// size of the previous one, made with a 2x2 box filter). The renderers pick the level from the texel footprint of a
+// pixel: per quad for the affine path, and per span for the bilinear path. The nearest sampler takes the nearest level,
+// the bilinear sampler blends the two nearest levels (trilinear filtering).
+//
+// Tiled layout - when a sprite is rotated by about 90 degrees, the affine path walks the sprite column wise, and with
+// the row major layout of the sprite each texel is in a different cache line. The tiled copy stores the texels in tiles
+// of 8 x 8 texels (each tile is 4 cache lines), so that the number of cache lines per span is about the same for all
+// angles. It's used by the nearest sampler of the affine path, for each mip level.
+//
+// Next to these, an opacity index can be built: it tells which blocks of 8 x 8 texels of the sprite hold at least one
+// opaque texel (alpha == 255). In Pixel::MASK mode the other texels are not drawn, so parts of a quad that map to
+// blocks without opaque texels can be skipped without solving the mapping for their pixels.
+
+#define TEXEL_TILE_SHIFT    3   // tiles are 8 x 8 texels
+#define TEXEL_TILE_MASK     ((1 << TEXEL_TILE_SHIFT) - 1)
+
+// index of texel (sx, sy) in the tiled copy of tex
+static inline int TiledIndex( const WarpTexture &tex, int sx, int sy ) {
+    return ((((sy >> TEXEL_TILE_SHIFT) * tex.nTilesX + (sx >> TEXEL_TILE_SHIFT)) << (2 * TEXEL_TILE_SHIFT)) +
+            ((sy & TEXEL_TILE_MASK) << TEXEL_TILE_SHIFT) + (sx & TEXEL_TILE_MASK));
+}
+
+#define OPACITY_BLOCK_SHIFT 3   // opacity blocks are 8 x 8 texels
+
+// The opacity index is a summed area table over the blocks: vSum holds, for each block corner, the nr of blocks with
+// an opaque texel above and left of it. So the nr of such blocks in any rectangle of blocks takes four lookups.
+struct OpacityIndex {
+    int nWidth   = 0;                                   // size of the sprite
+    int nHeight  = 0;
+    int nBlocksX = 0;
+    int nBlocksY = 0;
+    std::vector<int> vSum;                              // (nBlocksX + 1) x (nBlocksY + 1) entries
+
+    // returns true if any texel in [sx0, sx1] x [sy0, sy1] is opaque - or may be, since the blocks are tested as a whole.
+    // The coordinates are clamped to the sprite, like the samplers do
+    bool AnyOpaque( int sx0, int sy0, int sx1, int sy1 ) const {
+        sx0 = std::max( 0, std::min( sx0, nWidth  - 1 ));
+        sy0 = std::max( 0, std::min( sy0, nHeight - 1 ));
+        sx1 = std::max( sx0, std::min( sx1, nWidth  - 1 ));
+        sy1 = std::max( sy0, std::min( sy1, nHeight - 1 ));
+        int bx0 = sx0 >> OPACITY_BLOCK_SHIFT, bx1 = (sx1 >> OPACITY_BLOCK_SHIFT) + 1;
+        int by0 = sy0 >> OPACITY_BLOCK_SHIFT, by1 = (sy1 >> OPACITY_BLOCK_SHIFT) + 1;
+        int nStride = nBlocksX + 1;
+        return vSum[by1 * nStride + bx1] - vSum[by0 * nStride + bx1] - vSum[by1 * nStride + bx0] + vSum[by0 * nStride + bx0] > 0;
+    }
+};
+
+struct TextureCache {
+    const olc::Pixel *pSource = nullptr;                // sprite data and size the cache was built from, to detect changes
+    int nWidth  = 0;
+    int nHeight = 0;
+    bool bMips  = false;                                // what was built
+    bool bTiled = false;
+    bool bOpacity = false;
+    std::vector<std::vector<olc::Pixel>> vLevelData;    // the texels of mip levels 1 and up
+    std::vector<std::vector<olc::Pixel>> vTiledData;    // the tiled copies of all levels
+    std::vector<WarpTexture> vLevels;                   // all levels, level 0 is the sprite itself
+    OpacityIndex opacity;                               // for the sprite itself
+};
+
+static bool bWarpMipmaps = false;
+static bool bWarpTiled   = false;
+static bool bWarpOpacity = false;
+static std::unordered_map<const olc::Sprite *, std::shared_ptr<TextureCache>> mapTextureCache;
+static std::mutex mtxTextureCache;
+
+void olc::SetWarpMipmaps( bool bEnable ) {
+    bWarpMipmaps = bEnable;
+}
+
+bool olc::GetWarpMipmaps() {
+    return bWarpMipmaps;
+}
+
+void olc::SetWarpTiledTextures( bool bEnable ) {
+    bWarpTiled = bEnable;
+}
+
+bool olc::GetWarpTiledTextures() {
+    return bWarpTiled;
+}
+
+void olc::SetWarpOpacitySkipping( bool bEnable ) {
+    bWarpOpacity = bEnable;
+}
+
+bool olc::GetWarpOpacitySkipping() {
+    return bWarpOpacity;
+}
+
+static void InvalidateRotationCache( const olc::Sprite *pSprite );   // see Rotation cache
+
+void olc::InvalidateWarpTextureCache( const olc::Sprite *pSprite ) {
+    {
+        std::lock_guard<std::mutex> lock( mtxTextureCache );
+        if (pSprite == nullptr) {
+            mapTextureCache.clear();
+        } else {
+            mapTextureCache.erase( pSprite );
+        }
+    }
+    InvalidateRotationCache( pSprite );
+}
+
+// fills vDst with the next mip level for src, using a 2x2 box filter (odd rows and columns are clamped to the edge)
+static void BuildMipLevel( const WarpTexture &src, int nW, int nH, std::vector<olc::Pixel> &vDst ) {
+    vDst.resize( size_t( nW ) * nH );
+    for (int y = 0; y < nH; y++) {
+        const olc::Pixel *pRowA = src.pTexels + std::min( 2 * y    , src.nHeight - 1 ) * src.nStride;
+        const olc::Pixel *pRowB = src.pTexels + std::min( 2 * y + 1, src.nHeight - 1 ) * src.nStride;
+        for (int x = 0; x < nW; x++) {
+            int xa = std::min( 2 * x    , src.nWidth - 1 );
+            int xb = std::min( 2 * x + 1, src.nWidth - 1 );
+            olc::Pixel p[4] = { pRowA[xa], pRowA[xb], pRowB[xa], pRowB[xb] };
+            vDst[y * nW + x] = olc::Pixel(
+                uint8_t( (p[0].r + p[1].r + p[2].r + p[3].r + 2) >> 2 ),
+                uint8_t( (p[0].g + p[1].g + p[2].g + p[3].g + 2) >> 2 ),
+                uint8_t( (p[0].b + p[1].b + p[2].b + p[3].b + 2) >> 2 ),
+                uint8_t( (p[0].a + p[1].a + p[2].a + p[3].a + 2) >> 2 )
+            );
+        }
     }
-    // create duplicate from sprite part parameters
-    olc::Sprite *pPartialSprite = pSprite->Duplicate( source_pos, source_size );
-    // render the partial sprite using the rotated cornerpoints
-    DrawWarpedSprite( gfx, pPartialSprite, renderPoints );
-    // clean up duplicate to prevent memory leak
-    delete pPartialSprite;
 }
 
+// fills vDst with the tiled copy of level, and lets level refer to it. The tiles on the right and bottom edges are padded
+static void BuildTiledLevel( WarpTexture &level, std::vector<olc::Pixel> &vDst ) {
+    int nTileSize = 1 << TEXEL_TILE_SHIFT;
+    level.nTilesX = (level.nWidth + nTileSize - 1) >> TEXEL_TILE_SHIFT;
+    int nTilesY   = (level.nHeight + nTileSize - 1) >> TEXEL_TILE_SHIFT;
+    vDst.assign( size_t( level.nTilesX ) * nTilesY * nTileSize * nTileSize, olc::Pixel( 0, 0, 0, 0 ));
+    for (int y = 0; y < level.nHeight; y++) {
+        for (int x = 0; x < level.nWidth; x++) {
+            vDst[TiledIndex( level, x, y )] = level.pTexels[y * level.nStride + x];
+        }
+    }
+    level.pTiled = vDst.data();
+}
+
+// fills the opacity index for the texels of tex
+static void BuildOpacityIndex( const WarpTexture &tex, OpacityIndex &index ) {
+    int nBlockSize = 1 << OPACITY_BLOCK_SHIFT;
+    index.nWidth   = tex.nWidth;
+    index.nHeight  = tex.nHeight;
+    index.nBlocksX = (tex.nWidth  + nBlockSize - 1) >> OPACITY_BLOCK_SHIFT;
+    index.nBlocksY = (tex.nHeight + nBlockSize - 1) >> OPACITY_BLOCK_SHIFT;
+    int nStride = index.nBlocksX + 1;
+    index.vSum.assign( size_t( nStride ) * (index.nBlocksY + 1), 0 );
+    // first flag the blocks with an opaque texel (at their lower right corner), ...
+    for (int y = 0; y < tex.nHeight; y++) {
+        const olc::Pixel *pRow = tex.pTexels + y * tex.nStride;
+        for (int x = 0; x < tex.nWidth; x++) {
+            if (pRow[x].a == 255) {
+                index.vSum[((y >> OPACITY_BLOCK_SHIFT) + 1) * nStride + (x >> OPACITY_BLOCK_SHIFT) + 1] = 1;
+            }
+        }
+    }
+    // ... then sum them up
+    for (int by = 1; by <= index.nBlocksY; by++) {
+        for (int bx = 1; bx <= index.nBlocksX; bx++) {
+            index.vSum[by * nStride + bx] += index.vSum[(by - 1) * nStride + bx] + index.vSum[by * nStride + bx - 1] - index.vSum[(by - 1) * nStride + bx - 1];
+        }
+    }
+}
+
+// builds the cache for pSprite: the mip chain down to a 1 x 1 level if bMips is set, the tiled copies if bTiled is set,
+// and the opacity index if bOpacity is set
+static std::shared_ptr<TextureCache> BuildTextureCache( const olc::Sprite *pSprite, bool bMips, bool bTiled, bool bOpacity ) {
+    std::shared_ptr<TextureCache> pCache = std::make_shared<TextureCache>();
+    pCache->pSource = pSprite->pColData.data();
+    pCache->nWidth  = pSprite->width;
+    pCache->nHeight = pSprite->height;
+    pCache->bMips   = bMips;
+    pCache->bTiled  = bTiled;
+    pCache->bOpacity = bOpacity;
+    // first work out the sizes, so that the vectors don't reallocate while the levels point into them
+    std::vector<olc::vi2d> vSizes = { { pSprite->width, pSprite->height } };
+    while (bMips && (vSizes.back().x > 1 || vSizes.back().y > 1)) {
+        vSizes.push_back( { std::max( 1, vSizes.back().x / 2 ), std::max( 1, vSizes.back().y / 2 ) } );
+    }
+    pCache->vLevelData.resize( vSizes.size() - 1 );
+    pCache->vTiledData.resize( bTiled ? vSizes.size() : 0 );
+    pCache->vLevels.resize( vSizes.size() );
+    pCache->vLevels[0] = GetSpriteTexture( pSprite );
+    for (size_t l = 1; l < vSizes.size(); l++) {
+        BuildMipLevel( pCache->vLevels[l - 1], vSizes[l].x, vSizes[l].y, pCache->vLevelData[l - 1] );
+        WarpTexture &level = pCache->vLevels[l];
+        level.pTexels = pCache->vLevelData[l - 1].data();
+        level.nWidth  = vSizes[l].x;
+        level.nHeight = vSizes[l].y;
+        level.nStride = vSizes[l].x;
+    }
+    for (size_t l = 0; l < pCache->vTiledData.size(); l++) {
+        BuildTiledLevel( pCache->vLevels[l], pCache->vTiledData[l] );
+    }
+    if (bOpacity) {
+        BuildOpacityIndex( pCache->vLevels[0], pCache->opacity );
+    }
+    return pCache;
+}
+
+// Returns the texture for the whole of pSprite. If mip mapping, tiled textures or opacity skipping are enabled, the
+// texture refers to the cache for the sprite, which is built if it isn't there yet (or if the sprite changed size or
+// pixel buffer, or the settings changed). pHold keeps the cache alive while the texture is in use.
+// Note that the opacity index is not set in the texture, since it depends on the pixel mode (see RenderQuad()).
+static WarpTexture GetCachedTexture( const olc::Sprite *pSprite, std::shared_ptr<TextureCache> &pHold ) {
+    WARP_STATS_PHASE( WARP_STAT_TEXTURE_NS );
+    WarpTexture tex = GetSpriteTexture( pSprite );
+    bool bMips    = bWarpMipmaps;
+    bool bTiled   = bWarpTiled;
+    bool bOpacity = bWarpOpacity;
+    if ((!bMips && !bTiled && !bOpacity) || pSprite == nullptr || pSprite->width <= 0 || pSprite->height <= 0) {
+        return tex;
+    }
+    {
+        std::lock_guard<std::mutex> lock( mtxTextureCache );
+        std::shared_ptr<TextureCache> &pCache = mapTextureCache[pSprite];
+        if (pCache == nullptr || pCache->pSource != pSprite->pColData.data() || pCache->nWidth != pSprite->width || pCache->nHeight != pSprite->height ||
+            pCache->bMips != bMips || pCache->bTiled != bTiled || pCache->bOpacity != bOpacity) {
+            pCache = BuildTextureCache( pSprite, bMips, bTiled, bOpacity );
+        }
+        pHold = pCache;
+    }
+    tex.pCache = pHold.get();
+    return tex;
+}
+
+// Returns tex with its opacity index set, if it has one in the cache. This is only correct for renderers that don't
+// draw the texels that aren't opaque, i.e. in Pixel::MASK mode. Partial textures don't get it, since the index is for
+// the whole sprite
+static WarpTexture WithOpacityIndex( const WarpTexture &tex ) {
+    WarpTexture result = tex;
+    if (tex.pCache != nullptr && tex.pCache->bOpacity && tex.pTexels == tex.pCache->vLevels[0].pTexels &&
+        tex.nWidth == tex.pCache->opacity.nWidth && tex.nHeight == tex.pCache->opacity.nHeight) {
+        result.pOpacity = &tex.pCache->opacity;
+    }
+    return result;
+}
+
+// Returns the mip level of tex for level of detail fLod (log2 of the nr of texels per pixel), for SAMPLER
+template <olc::WarpSampler SAMPLER>
+static WarpTexture SelectMipLevel( const WarpTexture &tex, double fLod ) {
+    const std::vector<WarpTexture> &vLevels = tex.pCache->vLevels;
+    int nLast = int( vLevels.size() ) - 1;
+    if (!(fLod > 0.0)) {
+        return vLevels[0];
+    }
+    if (SAMPLER == olc::WarpSampler::NEAREST) {
+        return vLevels[std::min( nLast, int( fLod + 0.5 ))];
+    }
+    int nLevel = int( fLod );
+    if (nLevel >= nLast) {
+        return vLevels[nLast];
+    }
+    WarpTexture level = vLevels[nLevel];
+    const WarpTexture &next = vLevels[nLevel + 1];
+    level.pNext       = &next;
+    level.nNextWeight = uint32_t( (fLod - nLevel) * 256.0 );
+    level.nNextScaleX = int32_t( (int64_t( next.nWidth  ) << 16) / level.nWidth  );
+    level.nNextScaleY = int32_t( (int64_t( next.nHeight ) << 16) / level.nHeight );
+    return level;
+}
+
+// level of detail from the squared lengths of the texel footprint of a pixel in x and y direction
+static double GetLod( double dFootprintX2, double dFootprintY2 ) {
+    return 0.5 * log2( std::max( dFootprintX2, dFootprintY2 ));
+}
+
+// level of detail for the affine mapping of ws, which is the same for all pixels
+static double GetAffineLod( const WarpSetup &ws, const WarpTexture &tex ) {
+    double dW = double( tex.nWidth  ) * ws.InvW12;
+    double dH = double( tex.nHeight ) * ws.InvW12;
+    double dtxdx =  ws.b2.y * dW, dtydx = -ws.b1.y * dH;
+    double dtxdy = -ws.b2.x * dW, dtydy =  ws.b1.x * dH;
+    return GetLod( dtxdx * dtxdx + dtydx * dtydx, dtxdy * dtxdy + dtydy * dtydy );
+}
+
+// works out u and v for the screen position (x, y) with the bilinear inverse, without range checks
+static bool SolveWarpUV( const WarpSetup &ws, double x, double y, double &u, double &v ) {
+    olc::vd2d q = olc::vd2d( x, y ) - ws.points[0];
+    double B = (ws.b3.x * q.y - ws.b3.y * q.x) - ws.W12;
+    double C =  ws.b1.x * q.y - ws.b1.y * q.x;
+    if (ws.bLinear) {
+        if (fabs( B ) < NEAR_ZERO) {
+            return false;
+        }
+        v = -C / B;
+    } else {
+        double D = B * B - ws.A4 * C;
+        if (D < 0.0) {
+            return false;
+        }
+        v = (sqrt( D ) - B) * ws.Inv2A;
+    }
+    double denom_x = ws.b1.x + ws.b3.x * v;
+    double denom_y = ws.b1.y + ws.b3.y * v;
+    if (fabs( denom_x ) > fabs( denom_y )) {
+        if (fabs( denom_x ) < NEAR_ZERO) {
+            return false;
+        }
+        u = (q.x - ws.b2.x * v) / denom_x;
+    } else {
+        if (fabs( denom_y ) < NEAR_ZERO) {
+            return false;
+        }
+        u = (q.y - ws.b2.y * v) / denom_y;
+    }
+    return true;
+}
+
+// level of detail for row y of the bilinear mapping of ws, from the texel footprint in the middle of the (unclipped)
+// span of the quad on that row, so that it doesn't depend on clipping. If that can't be worked out, the average
+// over the quad is used
+static double GetSpanLod( const WarpSetup &ws, const WarpTexture &tex, int y ) {
+    int x_strt, x_stop;
+    bool bSpan = olc::GetQuadScanlineSpan( ws.points, y, ws.UpperLeft.x, ws.LowerRight.x, x_strt, x_stop );
+    double xm = 0.5 * double( x_strt + x_stop );
+    double u0, v0, u1, v1, u2, v2;
+    if (bSpan && SolveWarpUV( ws, xm, y, u0, v0 ) && SolveWarpUV( ws, xm + 1.0, y, u1, v1 ) && SolveWarpUV( ws, xm, y + 1.0, u2, v2 )) {
+        double dW = double( tex.nWidth  );
+        double dH = double( tex.nHeight );
+        double dtxdx = (u1 - u0) * dW, dtydx = (v1 - v0) * dH;
+        double dtxdy = (u2 - u0) * dW, dtydy = (v2 - v0) * dH;
+        return GetLod( dtxdx * dtxdx + dtydx * dtydx, dtxdy * dtxdy + dtydy * dtydy );
+    }
+    // area of the quad from its diagonals
+    olc::vd2d d1 = ws.points[3] - ws.points[0];
+    olc::vd2d d2 = ws.points[2] - ws.points[1];
+    double dArea = 0.5 * fabs( d1.x * d2.y - d1.y * d2.x );
+    return (dArea > 0.0) ? 0.5 * log2( double( tex.nWidth ) * tex.nHeight / dArea ) : 0.0;
+}
+
+// Hierarchical block classification
+// ---------------------------------
+// For convex quads, the clipping rectangle is classified against the four edges of the quad. If it lies outside the quad
+// completely, nothing is rendered at all. Otherwise each band of WARP_BLOCK_SIZE rows is split in blocks of
+// WARP_BLOCK_SIZE x WARP_BLOCK_SIZE pixels. Bands with only outside blocks are skipped, and for blocks that are inside
+// the coverage test is skipped. Within a band the outside blocks need no extra test, since the scanline spans exclude
+// them already. The real gain is in the inside blocks: the ones that map to a single texel (when the sprite is
+// magnified) or to transparent texels only are not evaluated at all (see MarkInteriorCells()).
+// To stay clear of rounding differences, a block is only inside or outside if all its pixels are at least
+// WARP_BLOCK_MARGIN pixels away from the edges.
+#define WARP_BLOCK_SHIFT    4
+#define WARP_BLOCK_SIZE     (1 << WARP_BLOCK_SHIFT)
+#define WARP_BLOCK_MARGIN   1.0
+
+enum class WarpBlock { OUTSIDE, EDGE, INSIDE };
+
+static bool bWarpClassify = true;
+
+void olc::SetWarpBlockClassification( bool bEnable ) {
+    bWarpClassify = bEnable;
+}
+
+bool olc::GetWarpBlockClassification() {
+    return bWarpClassify;
+}
+
+// Classifies the rectangle of pixels [x0, x1] x [y0, y1] against the (convex) quad of ws
+static WarpBlock ClassifyBlock( const WarpSetup &ws, int x0, int y0, int x1, int y1 ) {
+    if (!ws.bConvex) {
+        return WarpBlock::EDGE;
+    }
+    bool bInside = true;
+    double dW = double( x1 ) - double( x0 );
+    double dH = double( y1 ) - double( y0 );
+    for (int i = 0; i < 4; i++) {
+        const double *pEdge = ws.aEdges[i];
+        // the edge functions are linear, so the extremes over the block are in its corners
+        double dCorner = pEdge[0] * x0 + pEdge[1] * y0 + pEdge[2];
+        double dMin = dCorner + std::min( 0.0, pEdge[0] * dW ) + std::min( 0.0, pEdge[1] * dH );
+        double dMax = dCorner + std::max( 0.0, pEdge[0] * dW ) + std::max( 0.0, pEdge[1] * dH );
+        if (dMax < -WARP_BLOCK_MARGIN) {
+            return WarpBlock::OUTSIDE;
+        }
+        if (dMin < WARP_BLOCK_MARGIN) {
+            bInside = false;
+        }
+    }
+    return bInside ? WarpBlock::INSIDE : WarpBlock::EDGE;
+}
+
+// Classifies the blocks of the band of rows [y0, y1] within the columns [x0, x1]. The blocks are aligned to multiples of
+// WARP_BLOCK_SIZE. Passes back the columns of the blocks that are inside in [nInStrt, nInStop] (since the quad is
+// convex, these are consecutive). Returns false if all blocks are outside.
+static bool ClassifyBand( const WarpSetup &ws, int x0, int y0, int x1, int y1, int &nInStrt, int &nInStop ) {
+    nInStrt = INT_MAX;
+    nInStop = INT_MIN;
+    if (!ws.bConvex) {
+        return true;
+    }
+    bool bAny = false;
+    for (int bx = x0 & ~(WARP_BLOCK_SIZE - 1); bx <= x1; bx += WARP_BLOCK_SIZE) {
+        int bx0 = std::max( bx, x0 );
+        int bx1 = std::min( bx + WARP_BLOCK_SIZE - 1, x1 );
+        WarpBlock enBlock = ClassifyBlock( ws, bx0, y0, bx1, y1 );
+        if (enBlock == WarpBlock::OUTSIDE) {
+            continue;
+        }
+        bAny = true;
+        if (enBlock == WarpBlock::INSIDE) {
+            nInStrt = std::min( nInStrt, bx0 );
+            nInStop = bx1;
+        }
+    }
+    return bAny;
+}
+
+// The interior of a band is split in cells of WARP_CELL_SIZE x WARP_CELL_SIZE pixels, and for each cell it's worked
+// out how its pixels are found (see MarkInteriorCells())
+#define WARP_CELL_SHIFT     3
+#define WARP_CELL_SIZE      (1 << WARP_CELL_SHIFT)
+
+enum class WarpCell : uint8_t {
+    EVALUATE,       // the pixels are sampled by the span kernel
+    SKIP,           // the pixels only map to transparent texels, so they are not evaluated at all
+    FILL            // the pixels all map to the same texel, so they are drawn with its colour without evaluating them
+};
+
+// What is known about the interior of a band of rows (see ClassifyBand()): the columns x_in_strt through x_in_stop
+// are covered by the quad. If pCells is set, pCells[nCellRow * nCellsX + (x >> WARP_CELL_SHIFT) - nCellBase] tells for
+// each cell of these columns what to do with its pixels, with nCellRow = (y - y_strt) >> WARP_CELL_SHIFT. For the
+// cells that are filled, pFill holds the colour at the same index.
+struct WarpBandInterior {
+    int x_in_strt = INT_MAX;
+    int x_in_stop = INT_MIN;
+    int y_strt = 0;
+    const WarpCell *pCells = nullptr;
+    const olc::Pixel *pFill = nullptr;
+    int nCellBase = 0;
+    int nCellsX = 0;
+};
+
+// the margin (in texels) around the texels of a block, that covers the neighbours the bilinear sampler blends in
+#define OPACITY_TEXEL_MARGIN 2
+// the margin (in u and v) the corners of a cell must keep from the texel edges to be filled, so that the rounding of
+// the span kernels can't select another texel for any of its pixels
+#define FILL_MARGIN_DOUBLE   1e-9
+#define FILL_MARGIN_FLOAT    1e-4
+
+// u and v at a pixel within the (convex) quad, and the range of them over a rectangle of pixels. The lines of equal u
+// and those of equal v are straight, so the extremes over a rectangle are found in its corners.
+struct WarpUV {
+    double u = 0.0, v = 0.0;
+    bool bValid = false;
+
+    WarpUV() {}
+    WarpUV( const WarpSetup &ws, int x, int y ) { bValid = SolveWarpUV( ws, x, y, u, v ); }
+};
+
+struct WarpUVRange {
+    double uMin = DBL_MAX, uMax = -DBL_MAX, vMin = DBL_MAX, vMax = -DBL_MAX;
+    bool bValid = true;
+
+    WarpUVRange( std::initializer_list<WarpUV> corners ) {
+        for (const WarpUV &c : corners) {
+            bValid = bValid && c.bValid;
+            uMin = std::min( uMin, c.u ); uMax = std::max( uMax, c.u );
+            vMin = std::min( vMin, c.v ); vMax = std::max( vMax, c.v );
+        }
+    }
+    // passes back the range of texels [sx0, sx1] x [sy0, sy1] of the pixels, with u and v widened by dMargin
+    // Note that vertical texel coord is mirrored because the algorithm assumes positive y to go up
+    void GetTexels( const WarpTexture &tex, double dMargin, int &sx0, int &sy0, int &sx1, int &sy1 ) const {
+        sx0 = int( floor( (uMin - dMargin) * tex.nWidth  ));
+        sx1 = int( floor( (uMax + dMargin) * tex.nWidth  ));
+        sy0 = int( floor( (1.0 - vMax - dMargin) * tex.nHeight ));
+        sy1 = int( floor( (1.0 - vMin + dMargin) * tex.nHeight ));
+    }
+};
+
+// Works out what to do with the cells of the interior [bi.x_in_strt, bi.x_in_stop] of the band of rows [y0, y1], and
+// sets up bi to refer to the result in vCells and vFill. This is done per block of WARP_BLOCK_SIZE columns first:
+//  - if bOpacity is set, blocks that only map to texels that aren't opaque (see the opacity index of tex) are skipped
+//  - if bFill is set, blocks whose pixels all map to the same texel are filled with its colour. This happens when the
+//    sprite is magnified a lot. If the block spans at most two texels in both directions, it's tried per cell as well.
+// To keep the nr of solves per block low, the corners are shared with the neighbouring blocks and cells, so each block
+// and cell is tested one pixel wider (and a cell one pixel higher) than it is.
+static void MarkInteriorCells( const WarpSetup &ws, int y0, int y1, const WarpTexture &tex, olc::WarpPrecision precision, bool bOpacity, bool bFill,
+                               std::vector<WarpCell> &vCells, std::vector<olc::Pixel> &vFill, WarpBandInterior &bi ) {
+    bi.pCells = nullptr;
+    bOpacity = bOpacity && tex.pOpacity != nullptr;
+    if ((!bOpacity && !bFill) || bi.x_in_strt > bi.x_in_stop) {
+        return;
+    }
+    bi.y_strt    = y0;
+    bi.nCellBase = bi.x_in_strt >> WARP_CELL_SHIFT;
+    bi.nCellsX   = (bi.x_in_stop >> WARP_CELL_SHIFT) - bi.nCellBase + 1;
+    int nCellRows = ((y1 - y0) >> WARP_CELL_SHIFT) + 1;
+    vCells.assign( size_t( bi.nCellsX ) * nCellRows, WarpCell::EVALUATE );
+    vFill.resize( vCells.size() );
+    double dMargin = (precision == olc::WarpPrecision::FLOAT) ? FILL_MARGIN_FLOAT : FILL_MARGIN_DOUBLE;
+    // marks the cells of the columns [x0, x1] on the cell rows [r0, r1]
+    auto MarkCells = [&]( int x0, int x1, int r0, int r1, WarpCell enCell, olc::Pixel colour ) {
+        for (int r = r0; r <= r1; r++) {
+            for (int c = (x0 >> WARP_CELL_SHIFT) - bi.nCellBase; c <= (x1 >> WARP_CELL_SHIFT) - bi.nCellBase; c++) {
+                vCells[size_t( r ) * bi.nCellsX + c] = enCell;
+                vFill [size_t( r ) * bi.nCellsX + c] = colour;
+            }
+        }
+    };
+    // the row the two cell rows share (if there are two)
+    int ym = std::min( y0 + WARP_CELL_SIZE, y1 );
+    bool bAnyMarked = false;
+    int nBlockBase = bi.x_in_strt >> WARP_BLOCK_SHIFT;
+    int nBlocks = (bi.x_in_stop >> WARP_BLOCK_SHIFT) - nBlockBase + 1;
+    WarpUV ul, ll, ur, lr;
+    for (int b = 0; b < nBlocks; b++) {
+        int bx0 = std::max( (b + nBlockBase) << WARP_BLOCK_SHIFT, bi.x_in_strt );
+        int bx1 = std::min( ((b + nBlockBase) << WARP_BLOCK_SHIFT) + WARP_BLOCK_SIZE - 1, bi.x_in_stop );
+        // the right corners of this block are the left corners of the next one (or the last column of the interior)
+        int bxr = std::min( bx1 + 1, bi.x_in_stop );
+        if (b == 0) {
+            ul = WarpUV( ws, bx0, y0 );
+            ll = WarpUV( ws, bx0, y1 );
+        } else {
+            ul = ur;
+            ll = lr;
+        }
+        ur = WarpUV( ws, bxr, y0 );
+        lr = WarpUV( ws, bxr, y1 );
+        WarpUVRange block = { ul, ur, ll, lr };
+        if (!block.bValid) {
+            continue;
+        }
+        int sx0, sy0, sx1, sy1;
+        if (bOpacity) {
+            block.GetTexels( tex, 0.0, sx0, sy0, sx1, sy1 );
+            if (!tex.pOpacity->AnyOpaque( sx0 - OPACITY_TEXEL_MARGIN, sy0 - OPACITY_TEXEL_MARGIN, sx1 + OPACITY_TEXEL_MARGIN, sy1 + OPACITY_TEXEL_MARGIN )) {
+                MarkCells( bx0, bx1, 0, nCellRows - 1, WarpCell::SKIP, olc::BLANK );
+                bAnyMarked = true;
+                continue;
+            }
+        }
+        if (!bFill) {
+            continue;
+        }
+        block.GetTexels( tex, dMargin, sx0, sy0, sx1, sy1 );
+        if (sx0 == sx1 && sy0 == sy1) {
+            MarkCells( bx0, bx1, 0, nCellRows - 1, WarpCell::FILL, tex.pTexels[sy0 * tex.nStride + sx0] );
+            bAnyMarked = true;
+        } else if (sx1 - sx0 <= 1 && sy1 - sy0 <= 1) {
+            // the block holds at most 2 x 2 cells, on a grid of 3 x 3 corners
+            int xm = ((bx0 >> WARP_CELL_SHIFT) + 1) << WARP_CELL_SHIFT;
+            int nCellCols = (xm <= bx1) ? 2 : 1;
+            xm = std::min( xm, bxr );
+            WarpUV um = WarpUV( ws, xm, y0 ), lm = WarpUV( ws, xm, y1 );
+            WarpUV ml, mm, mr;
+            if (nCellRows > 1) {
+                ml = WarpUV( ws, bx0, ym );
+                mm = WarpUV( ws, xm , ym );
+                mr = WarpUV( ws, bxr, ym );
+            }
+            const WarpUV *aGrid[3][3] = { { &ul, &um, &ur }, { &ml, &mm, &mr }, { &ll, &lm, &lr } };
+            for (int r = 0; r < nCellRows; r++) {
+                // the corner rows of cell row r in the grid
+                int g0 = (r == 0) ? 0 : 1;
+                int g1 = (r == 0 && nCellRows > 1) ? 1 : 2;
+                for (int c = 0; c < nCellCols; c++) {
+                    WarpUVRange cell = { *aGrid[g0][c], *aGrid[g0][c + 1], *aGrid[g1][c], *aGrid[g1][c + 1] };
+                    if (!cell.bValid) {
+                        continue;
+                    }
+                    cell.GetTexels( tex, dMargin, sx0, sy0, sx1, sy1 );
+                    if (sx0 == sx1 && sy0 == sy1) {
+                        MarkCells( (c == 0) ? bx0 : xm, (c + 1 < nCellCols) ? xm - 1 : bx1, r, r, WarpCell::FILL, tex.pTexels[sy0 * tex.nStride + sx0] );
+                        bAnyMarked = true;
+                    }
+                }
+            }
+        }
+    }
+    if (bAnyMarked) {
+        bi.pCells = vCells.data();
+        bi.pFill  = vFill.data();
+    }
+}
+
+// Counts the results of a chunk of the span kernel for the instrumentation. For the pixels that are not covered, the
+// reason is worked out the same way as WarpKernel_Scalar() does
+static inline void CountWarpChunk( const WarpSetup &ws, const WarpSpanParams &sp, bool bInterior, const uint8_t *pCovered, uint64_t nTexelsPerSample ) {
+#ifdef WARP_STATS
+    uint64_t nCovered = 0;
+    for (int i = 0; i < sp.nCount; i++) {
+        if (bInterior || pCovered[i]) {
+            nCovered++;
+            continue;
+        }
+        double di = double( sp.nOffset + i );
+        double B  = sp.B0 + ws.dB * di;
+        double C  = sp.C0 + ws.dC * di;
+        double v;
+        if (ws.bLinear) {
+            if (fabs( B ) < NEAR_ZERO) {
+                WARP_STATS_ADD( WARP_STAT_DENOMINATOR, 1 );
+                continue;
+            }
+            v = -C / B;
+        } else {
+            double D = B * B - ws.A4 * C;
+            if (D <= 0.0) {
+                WARP_STATS_ADD( WARP_STAT_DISCRIMINANT, 1 );
+                continue;
+            }
+            v = (sqrt( D ) - B) * ws.Inv2A;
+        }
+        double denom_x = ws.b1.x + ws.b3.x * v;
+        double denom_y = ws.b1.y + ws.b3.y * v;
+        if (v >= 0.0 && v <= 1.0 && std::max( fabs( denom_x ), fabs( denom_y )) < NEAR_ZERO) {
+            WARP_STATS_ADD( WARP_STAT_DENOMINATOR, 1 );
+        } else {
+            // the others have u or v out of range
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, 1 );
+        }
+    }
+    WARP_STATS_ADD( WARP_STAT_TESTED, sp.nCount );
+    WARP_STATS_ADD( WARP_STAT_COVERED, nCovered );
+    WARP_STATS_ADD( WARP_STAT_TEXELS, nCovered * nTexelsPerSample );
+#else
+    (void)ws; (void)sp; (void)bInterior; (void)pCovered; (void)nTexelsPerSample;
+#endif
+}
+
+// Evaluates the bilinear inverse for the pixels x_strt through x_stop on scanline y, using the selected span kernel.
+// The span is processed in chunks, and for each pixel that produces a valid sample, DrawPixel( x, colour ) is called.
+// The pixels in the interior of the band (if any) are known to be covered (see ClassifyBlock()), so for these the
+// coverage isn't checked, and the cells that are marked as transparent or as filled are not evaluated at all.
+template <olc::WarpSampler SAMPLER, typename DrawFunc>
+static void WarpedSampleSpan( const WarpSetup &ws, int y, int x_strt, int x_stop, const WarpBandInterior &bi, const WarpTexture &tex, olc::WarpPrecision precision, DrawFunc &DrawPixel ) {
+    const int CHUNK_SIZE = 64;
+    uint8_t    aCovered[CHUNK_SIZE + MAX_KERNEL_LANES];
+    olc::Pixel aColours[CHUNK_SIZE + MAX_KERNEL_LANES];
+    double     aU[CHUNK_SIZE + MAX_KERNEL_LANES];
+    double     aV[CHUNK_SIZE + MAX_KERNEL_LANES];
+    // the nearest sampler lets the kernel read the texels, the other samplers need u and v
+    double *pU = (SAMPLER == olc::WarpSampler::NEAREST) ? nullptr : aU;
+    double *pV = (SAMPLER == olc::WarpSampler::NEAREST) ? nullptr : aV;
+    double dW = double( tex.nWidth  );
+    double dH = double( tex.nHeight );
+
+    // q, B and C at the start of the span
+    WarpSpanParams sp;
+    olc::vd2d q = olc::vd2d( double( x_strt ), double( y )) - ws.points[0];
+    sp.qx0 = q.x;
+    sp.qy  = q.y;
+    sp.B0  = (ws.b3.x * q.y - ws.b3.y * q.x) - ws.W12;
+    sp.C0  =  ws.b1.x * q.y - ws.b1.y * q.x;
+
+    WarpKernelFunc Kernel = GetWarpKernel( precision );
+    // the span is split in (at most) three parts: the edge part left of the interior, the interior and the edge part right of it.
+    // All of them are evaluated relative to the start of the span, so the split doesn't affect the result
+    int nSpanLen = x_stop - x_strt + 1;
+    int nInStrt = nSpanLen;
+    int nInStop = nSpanLen;
+    if (bi.x_in_strt <= bi.x_in_stop && bi.x_in_strt <= x_stop && bi.x_in_stop >= x_strt) {
+        nInStrt = std::max( bi.x_in_strt, x_strt ) - x_strt;
+        nInStop = std::min( bi.x_in_stop, x_stop ) - x_strt + 1;
+    }
+    const int aPartEnd[3] = { nInStrt, nInStop, nSpanLen };
+    // the cells of the interior on this row, if any are marked
+    const WarpCell   *pCells = (bi.pCells == nullptr) ? nullptr : bi.pCells + size_t( (y - bi.y_strt) >> WARP_CELL_SHIFT ) * bi.nCellsX;
+    const olc::Pixel *pFill  = (bi.pCells == nullptr) ? nullptr : bi.pFill  + size_t( (y - bi.y_strt) >> WARP_CELL_SHIFT ) * bi.nCellsX;
+    sp.nOffset = 0;
+    for (int nPart = 0; nPart < 3; nPart++) {
+        bool bInterior = (nPart == 1);
+        bool bCells = bInterior && pCells != nullptr;
+        int nRunEnd = bCells ? sp.nOffset : aPartEnd[nPart];
+        for (; sp.nOffset < aPartEnd[nPart]; sp.nOffset += sp.nCount) {
+            if (bCells && sp.nOffset >= nRunEnd) {
+                // at the start of a run of cells that are all evaluated or all skipped, or of a single cell that is filled
+                int nCell = ((x_strt + sp.nOffset) >> WARP_CELL_SHIFT) - bi.nCellBase;
+                WarpCell enCell = pCells[nCell];
+                int nNext = nCell + 1;
+                while (enCell != WarpCell::FILL && ((nNext + bi.nCellBase) << WARP_CELL_SHIFT) - x_strt < aPartEnd[nPart] && pCells[nNext] == enCell) {
+                    nNext++;
+                }
+                nRunEnd = ((nNext + bi.nCellBase) << WARP_CELL_SHIFT) - x_strt;
+                if (enCell != WarpCell::EVALUATE) {
+                    sp.nCount = std::min( nRunEnd, aPartEnd[nPart] ) - sp.nOffset;
+                    // the skipped pixels are covered, but map to transparent texels only, so nothing is drawn or fetched
+                    if (enCell == WarpCell::SKIP) {
+                        WARP_STATS_ADD( WARP_STAT_COVERED, sp.nCount );
+                    }
+                    if (enCell == WarpCell::FILL) {
+                        WARP_STATS_ADD( WARP_STAT_TESTED , sp.nCount );
+                        WARP_STATS_ADD( WARP_STAT_COVERED, sp.nCount );
+                        WARP_STATS_ADD( WARP_STAT_TEXELS , sp.nCount );
+                        for (int i = 0; i < sp.nCount; i++) {
+                            DrawPixel( x_strt + sp.nOffset + i, y, pFill[nCell] );
+                        }
+                    }
+                    continue;
+                }
+            }
+            sp.nCount = std::min( CHUNK_SIZE, std::min( nRunEnd, aPartEnd[nPart] ) - sp.nOffset );
+            Kernel( ws, sp, tex, aCovered, aColours, pU, pV );
+            CountWarpChunk( ws, sp, bInterior, aCovered, TexelsPerSample<SAMPLER>( tex ));
+            for (int i = 0; i < sp.nCount; i++) {
+                if (bInterior || aCovered[i]) {
+                    if (SAMPLER == olc::WarpSampler::NEAREST) {
+                        DrawPixel( x_strt + sp.nOffset + i, y, aColours[i] );
+                    } else {
+                        // Note that vertical texel coord is mirrored because the algorithm assumes positive y to go up
+                        DrawPixel( x_strt + sp.nOffset + i, y, SampleBilinear( tex, aU[i] * dW, (1.0 - aV[i]) * dH ));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Texel coordinates of the affine path that are less than this below a whole texel are snapped to it (see RenderAffine())
+#define AFFINE_SNAP_DOUBLE  0.000001
+#define AFFINE_SNAP_FLOAT   0.001f
+#define AFFINE_SNAP_FIXED   64          // 1/1024 texel in 16.16
+// Spans of the affine path that are clipped by up to this many pixels are walked from their unclipped start
+#define AFFINE_MAX_PRESTEP  4096
+
+// Renders a parallelogram quad (ws.bAffine) within the clipping rectangle [ClipUL, ClipLR].
+// Since the mapping is linear, the exact span where u and v are both in [0.0, 1.0] is worked out per row, and the
+// texel coordinates are walked incrementally along the span: one add per pixel for u and v, no sqrt and no divide.
+// For each covered pixel, DrawPixel( x, y, colour ) is called.
+template <olc::WarpSampler SAMPLER, typename DrawFunc>
+static void RenderAffine( const WarpSetup &ws, const olc::vi2d &ClipUL, const olc::vi2d &ClipLR, const WarpTexture &tex, olc::WarpPrecision precision, DrawFunc &DrawPixel ) {
+    int x_clip_strt = ClipUL.x;
+    int x_clip_stop = ClipLR.x;
+    // a degenerate (zero area) parallelogram covers no pixels
+    if (ws.InvW12 == 0.0) {
+        WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, int64_t( x_clip_stop - x_clip_strt + 1 ) * (ClipLR.y - ClipUL.y + 1) );
+        return;
+    }
+    // u and v are worked out from the column of the first corner point, rather than from the clipping boundary, so
+    // that the pixels don't depend on the clipping, and move along exactly when the quad is moved by whole pixels
+    int x_row_strt = int( floor( ws.points[0].x ));
+    const olc::vd2d &b1 = ws.b1;
+    const olc::vd2d &b2 = ws.b2;
+    // texel coordinates are stepped directly: tx = u * width, ty = (1 - v) * height
+    // Note that vertical texel coord is mirrored because the algorithm assumes positive y to go up
+    const olc::Pixel *pTexels = tex.pTexels;
+    double dW = double( tex.nWidth  );
+    double dH = double( tex.nHeight );
+    // derivatives of u and v with respect to x (per pixel)
+    double du = ( b2.y * ws.InvW12);
+    double dv = (-b1.y * ws.InvW12);
+    double dtx =  du * dW;
+    double dty = -dv * dH;
+
+    // returns the interval of x values (relative to the row start) where f0 + df * x is in [0.0, 1.0]
+    auto UnitInterval = []( double f0, double df, double &lo, double &hi ) {
+        if (df == 0.0) {
+            lo = (f0 >= 0.0 && f0 <= 1.0) ? -DBL_MAX :  DBL_MAX;
+            hi = (f0 >= 0.0 && f0 <= 1.0) ?  DBL_MAX : -DBL_MAX;
+        } else {
+            double x0 = (0.0 - f0) / df;
+            double x1 = (1.0 - f0) / df;
+            lo = std::min( x0, x1 );
+            hi = std::max( x0, x1 );
+        }
+    };
+
+    // the nearest sampler reads texel (sx, sy) from the row major or from the tiled layout
+    auto FetchLinear = [&]( int sx, int sy ) { return pTexels[sy * tex.nStride + sx];     };
+    auto FetchTiled  = [&]( int sx, int sy ) { return tex.pTiled[TiledIndex( tex, sx, sy )]; };
+
+    // Walks the texel coordinates (tx, ty) along the span [x_strt, x_stop] on row y, with increments (dtx, dty) per
+    // pixel, and draws the pixels from x_draw on (the pixels before it are clipped). T is the type of the coordinates:
+    // double, float or int32_t (16.16 fixed point). For the nearest sampler, coordinates that are just below a whole texel are snapped to it (by adding the snap margin at the span start): at
+    // a 1:1 scale the pixel corners fall exactly on texel edges, and the rounding errors of working out and stepping the
+    // coordinates would select the texel before it.
+    auto WalkAffineSpan = [&]( auto Fetch, int y, int x_strt, int x_draw, int x_stop, auto tx, auto ty, auto dtx, auto dty ) {
+        typedef decltype( tx ) T;
+        if (SAMPLER == olc::WarpSampler::NEAREST) {
+            T snap = std::is_same<T, int32_t>::value ? T( AFFINE_SNAP_FIXED ) : std::is_same<T, float>::value ? T( AFFINE_SNAP_FLOAT ) : T( AFFINE_SNAP_DOUBLE );
+            tx += snap;
+            ty += snap;
+        }
+        // step to the first pixel to draw - for fixed point in one go, since the multiply wraps around the same as the adds
+        if constexpr (std::is_same<T, int32_t>::value) {
+            tx = int32_t( uint32_t( tx ) + uint32_t( x_draw - x_strt ) * uint32_t( dtx ));
+            ty = int32_t( uint32_t( ty ) + uint32_t( x_draw - x_strt ) * uint32_t( dty ));
+        } else {
+            for (int x = x_strt; x < x_draw; x++) {
+                tx += dtx;
+                ty += dty;
+            }
+        }
+        for (int x = x_draw; x <= x_stop; x++, tx += dtx, ty += dty) {
+            if constexpr (std::is_same<T, int32_t>::value) {
+                if (SAMPLER == olc::WarpSampler::NEAREST) {
+                    int sx = std::max( 0, std::min( tx >> 16, tex.nWidth  - 1 ));
+                    int sy = std::max( 0, std::min( ty >> 16, tex.nHeight - 1 ));
+                    DrawPixel( x, y, Fetch( sx, sy ));
+                } else {
+                    DrawPixel( x, y, SampleBilinearFixed( tex, tx, ty ));
+                }
+            } else {
+                if (SAMPLER == olc::WarpSampler::NEAREST) {
+                    // clamp the texel coordinates, since rounding errors may put them just outside the sprite
+                    int sx = std::max( 0, std::min( int( tx ), tex.nWidth  - 1 ));
+                    int sy = std::max( 0, std::min( int( ty ), tex.nHeight - 1 ));
+                    DrawPixel( x, y, Fetch( sx, sy ));
+                } else {
+                    DrawPixel( x, y, SampleBilinear( tex, double( tx ), double( ty )));
+                }
+            }
+        }
+    };
+    auto WalkSpan = [&]( auto... args ) {
+        if (tex.pTiled != nullptr) {
+            WalkAffineSpan( FetchTiled , args... );
+        } else {
+            WalkAffineSpan( FetchLinear, args... );
+        }
+    };
+    // The fixed point back-end needs the texel coordinates to fit in 16.16, including the increment past the end of
+    // the span. The coordinates stay within the sprite, so this holds for sprites smaller than 16K x 16K and
+    // increments less than 16K texels. Otherwise the double back-end is used.
+    bool bFixed = precision == olc::WarpPrecision::FIXED &&
+                  tex.nWidth < 16384 && tex.nHeight < 16384 && fabs( dtx ) < 16384.0 && fabs( dty ) < 16384.0;
+    int32_t nFixedDtx = bFixed ? int32_t( lround( dtx * 65536.0 )) : 0;
+    int32_t nFixedDty = bFixed ? int32_t( lround( dty * 65536.0 )) : 0;
+
+    for (int y = ClipUL.y; y <= ClipLR.y; y++) {
+        // u and v at the start of the row
+        olc::vd2d q = olc::vd2d( double( x_row_strt ), double( y )) - ws.points[0];
+        double u0 = (q.x * b2.y - q.y * b2.x) * ws.InvW12;
+        double v0 = (b1.x * q.y - b1.y * q.x) * ws.InvW12;
+        // work out the span on this row where both u and v are within range
+        double ulo, uhi, vlo, vhi;
+        UnitInterval( u0, du, ulo, uhi );
+        UnitInterval( v0, dv, vlo, vhi );
+        double lo = std::max( ulo, vlo );
+        double hi = std::min( uhi, vhi );
+        if (lo > hi) {
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, x_clip_stop - x_clip_strt + 1 );
+            continue;
+        }
+        // convert to pixel coordinates, clamped to the clipping range - the comparisons are done in double to prevent int overflow
+        int x_strt = int( std::max( double( x_clip_strt ), x_row_strt + ceil(  lo )));
+        int x_stop = int( std::min( double( x_clip_stop ), x_row_strt + floor( hi )));
+        if (x_strt > x_stop) {
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, x_clip_stop - x_clip_strt + 1 );
+            continue;
+        }
+        // the rest of the row is outside of the span
+        WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, (x_clip_stop - x_clip_strt) - (x_stop - x_strt));
+        WARP_STATS_ADD( WARP_STAT_TESTED , x_stop - x_strt + 1 );
+        WARP_STATS_ADD( WARP_STAT_COVERED, x_stop - x_strt + 1 );
+        WARP_STATS_ADD( WARP_STAT_TEXELS , (x_stop - x_strt + 1) * TexelsPerSample<SAMPLER>( tex ));
+        // walk the texel coordinates along the span, in the selected precision. The walk starts at the unclipped start of
+        // the span, so that its rounding doesn't depend on the clipping (unless the span is clipped by a lot)
+        int x_walk = int( std::max( double( x_strt - AFFINE_MAX_PRESTEP ), x_row_strt + ceil( lo )));
+        double offset = double( x_walk - x_row_strt );
+        double tx = (u0 + du * offset) * dW;
+        double ty = (1.0 - (v0 + dv * offset)) * dH;
+        if (bFixed) {
+            WalkSpan( y, x_walk, x_strt, x_stop, int32_t( floor( tx * 65536.0 )), int32_t( floor( ty * 65536.0 )), nFixedDtx, nFixedDty );
+        } else if (precision == olc::WarpPrecision::FLOAT) {
+            WalkSpan( y, x_walk, x_strt, x_stop, float( tx ), float( ty ), float( dtx ), float( dty ));
+        } else {
+            WalkSpan( y, x_walk, x_strt, x_stop, tx, ty, dtx, dty );
+        }
+    }
+}
+
+// Renders the quad described by ws within the clipping rectangle [ClipUL, ClipLR], using the affine path for
+// parallelograms and the incremental bilinear inverse otherwise. For each covered pixel, DrawPixel( x, y, colour ) is called.
+template <olc::WarpSampler SAMPLER, typename DrawFunc>
+static void RenderWarp( const WarpSetup &ws, olc::vi2d ClipUL, olc::vi2d ClipLR, const WarpTexture &tex, olc::WarpPrecision precision, DrawFunc &DrawPixel ) {
+    if (tex.pTexels == nullptr || tex.nWidth <= 0 || tex.nHeight <= 0) {
+        return;
+    }
+    // clip the bounding box of the quad once, so that no clipping is needed per pixel
+    ClipUL = ClipUL.max( ws.UpperLeft  );
+    ClipLR = ClipLR.min( ws.LowerRight );
+    if (ClipUL.x > ClipLR.x || ClipUL.y > ClipLR.y) {
+        return;
+    }
+    int x_clip_strt = ClipUL.x;
+    int x_clip_stop = ClipLR.x;
+    if (ws.bAffine) {
+        if (tex.pCache != nullptr) {
+            RenderAffine<SAMPLER>( ws, ClipUL, ClipLR, tex.pCache->bMips ? SelectMipLevel<SAMPLER>( tex, GetAffineLod( ws, tex )) : tex.pCache->vLevels[0], precision, DrawPixel );
+        } else {
+            RenderAffine<SAMPLER>( ws, ClipUL, ClipLR, tex, precision, DrawPixel );
+        }
+        return;
+    }
+    // reject the quad if the clipped bounding box is outside of it as a whole
+    bool bClassify = bWarpClassify;
+    if (bClassify && ClassifyBlock( ws, ClipUL.x, ClipUL.y, ClipLR.x, ClipLR.y ) == WarpBlock::OUTSIDE) {
+        WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, int64_t( x_clip_stop - x_clip_strt + 1 ) * (ClipLR.y - ClipUL.y + 1) );
+        return;
+    }
+    // the opacity index only applies to the sprite itself, not to its mip levels. The same holds for the filled cells,
+    // which can only be used with the nearest sampler
+    bool bOpacity = tex.pOpacity != nullptr && (tex.pCache == nullptr || !tex.pCache->bMips);
+    bool bFill = SAMPLER == olc::WarpSampler::NEAREST && (tex.pCache == nullptr || !tex.pCache->bMips);
+    std::vector<WarpCell>   vCells;
+    std::vector<olc::Pixel> vFill;
+    // iterate all bands of rows within the (clipped) bounding box of the quad...
+    for (int y_band = ClipUL.y; y_band <= ClipLR.y; y_band = (y_band | (WARP_BLOCK_SIZE - 1)) + 1) {
+        int y_band_stop = std::min( y_band | (WARP_BLOCK_SIZE - 1), ClipLR.y );
+        // ... skipping the bands that are outside the quad ...
+        WarpBandInterior bi;
+        if (bClassify && !ClassifyBand( ws, x_clip_strt, y_band, x_clip_stop, y_band_stop, bi.x_in_strt, bi.x_in_stop )) {
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, int64_t( x_clip_stop - x_clip_strt + 1 ) * (y_band_stop - y_band + 1) );
+            continue;
+        }
+        // ... and the cells that map to transparent texels only, or to a single texel ...
+        MarkInteriorCells( ws, y_band, y_band_stop, tex, precision, bOpacity, bFill, vCells, vFill, bi );
+        for (int y = y_band; y <= y_band_stop; y++) {
+            // ... and only the part of the row that is spanned by the quad and lies within the clipping boundaries
+            int x_strt, x_stop;
+            if (ws.pSpans != nullptr) {
+                // the spans are precomputed for the whole bounding box, so only clip them
+                const int *pSpan = ws.pSpans + 2 * (y - ws.UpperLeft.y);
+                x_strt = std::max( pSpan[0], x_clip_strt );
+                x_stop = std::min( pSpan[1], x_clip_stop );
+                if (x_strt > x_stop) {
+                    WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, x_clip_stop - x_clip_strt + 1 );
+                    continue;
+                }
+            } else if (!olc::GetQuadScanlineSpan( ws.points, y, x_clip_strt, x_clip_stop, x_strt, x_stop )) {
+                WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, x_clip_stop - x_clip_strt + 1 );
+                continue;
+            }
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, (x_clip_stop - x_clip_strt) - (x_stop - x_strt));
+            // ... and render the pixels for which sampling produces a valid pixel
+            if (tex.pCache != nullptr && tex.pCache->bMips) {
+                WarpedSampleSpan<SAMPLER>( ws, y, x_strt, x_stop, bi, SelectMipLevel<SAMPLER>( tex, GetSpanLod( ws, tex, y )), precision, DrawPixel );
+            } else {
+                WarpedSampleSpan<SAMPLER>( ws, y, x_strt, x_stop, bi, tex, precision, DrawPixel );
+            }
+        }
+    }
+}
+
+// The blend factor for Pixel::ALPHA mode. The PGE doesn't expose its own blend factor, so Pixel::ALPHA mode is passed
+// on to PixelGameEngine::Draw() (which uses it), unless the caller has mirrored it here with SetWarpPixelBlend()
+static float fWarpPixelBlend = 1.0f;
+static bool  bWarpPixelBlend = false;
+
+void olc::SetWarpPixelBlend( float fBlend ) {
+    fWarpPixelBlend = fBlend;
+    bWarpPixelBlend = true;
+}
+
+// Span output layer: the covered pixels are written straight into the pixel data of the current draw target,
+// instead of calling PixelGameEngine::Draw() per pixel. The draw target and pixel mode are picked up from the PGE
+// at construction, so SetDrawTarget() is honoured. Clipping against the draw target is done once per span by the
+// renderer (using ClipUL and ClipLR), so the pixel writers below don't need to check bounds.
+struct SpanWriter {
+    SpanWriter( olc::PixelGameEngine *gfx ) : gfx( gfx ) {
+        olc::Sprite *pTarget = gfx->GetDrawTarget();
+        if (pTarget != nullptr) {
+            pData   = pTarget->GetData();
+            nWidth  = pTarget->width;
+            ClipLR  = { pTarget->width - 1, pTarget->height - 1 };
+        }
+        mode = gfx->GetPixelMode();
+    }
+
+    // Pixel::CUSTOM mode calls the user function via PixelGameEngine::Draw(), which may not be thread safe. In
+    // Pixel::ALPHA mode, Draw() only reads and writes the pixel itself, so the bands can be drawn in parallel
+    bool IsThreadSafe() const { return mode != olc::Pixel::CUSTOM; }
+
+    olc::PixelGameEngine *gfx = nullptr;
+    olc::Pixel *pData  = nullptr;
+    int nWidth = 0;
+    olc::Pixel::Mode mode = olc::Pixel::NORMAL;
+    // the draw target area, to clip against
+    olc::vi2d ClipUL = { 0, 0 };
+    olc::vi2d ClipLR = { -1, -1 };
+};
+
+// Shading is a compile time parameter of the pixel writer as well
+enum class WarpShade {
+    NONE,           // pixels are written as sampled
+    CONSTANT,       // all pixels are multiplied by the same shade factor - done with a lookup table
+    GRADIENT        // the shade factor is interpolated linearly over x
+};
+
+struct ShadeParams {
+    uint8_t aLookup[256];       // CONSTANT: channel value multiplied by the shade factor, as Pixel::operator*() does
+    float fShadeStart = 1.0f;   // GRADIENT: shade factor at x == nStartX
+    float fShadeDelta = 0.0f;   //           and delta of the shade factor per pixel
+    int   nStartX     = 0;
+
+    void SetConstant( float fShade ) {
+        for (int i = 0; i < 256; i++) {
+            aLookup[i] = uint8_t( std::min( 255.0f, std::max( 0.0f, float( i ) * fShade )));
+        }
+    }
+};
+
+// Writes pixels to the draw target for a specific pixel mode and shading. Since both are compile time parameters,
+// each combination gets its own branch free inner loop. Pixel::CUSTOM mode is passed on to PixelGameEngine::Draw()
+// since its function can't be inlined, and so is Pixel::ALPHA mode if its blend factor isn't known (see SetWarpPixelBlend()).
+template <olc::Pixel::Mode MODE, WarpShade SHADE>
+class PixelWriter {
+public:
+    PixelWriter( const SpanWriter &sw, const ShadeParams &sp ) : sw( sw ), sp( sp ) {}
+
+    inline void operator()( int x, int y, olc::Pixel pix ) const {
+        if constexpr (SHADE == WarpShade::CONSTANT) {
+            pix = olc::Pixel( sp.aLookup[pix.r], sp.aLookup[pix.g], sp.aLookup[pix.b], pix.a );
+        } else if constexpr (SHADE == WarpShade::GRADIENT) {
+            pix = pix * (sp.fShadeStart + sp.fShadeDelta * float( x - sp.nStartX ));
+        }
+        olc::Pixel &dst = sw.pData[y * sw.nWidth + x];
+        WARP_STATS_ADD( WARP_STAT_DRAWN, (MODE != olc::Pixel::MASK) || (pix.a == 255) );
+        if constexpr (MODE == olc::Pixel::NORMAL) {
+            dst = pix;
+        } else if constexpr (MODE == olc::Pixel::MASK) {
+            dst = (pix.a == 255) ? pix : dst;
+        } else if constexpr (MODE == olc::Pixel::ALPHA) {
+            // same blending as PixelGameEngine::Draw()
+            float a = (float)(pix.a / 255.0f) * fWarpPixelBlend;
+            float c = 1.0f - a;
+            float r = a * (float)pix.r + c * (float)dst.r;
+            float g = a * (float)pix.g + c * (float)dst.g;
+            float b = a * (float)pix.b + c * (float)dst.b;
+            dst = olc::Pixel( (uint8_t)r, (uint8_t)g, (uint8_t)b );
+        } else {
+            // Pixel::CUSTOM mode, or Pixel::ALPHA mode with the blend factor of the PGE
+            sw.gfx->Draw( x, y, pix );
+        }
+    }
+
+private:
+    const SpanWriter  &sw;
+    const ShadeParams &sp;
+};
+
+// Calls Render( writer ) with the pixel writer that is specialised for the pixel mode of sw and for SHADE
+template <WarpShade SHADE, typename RenderFunc>
+static void DispatchPixelMode( const SpanWriter &sw, const ShadeParams &sp, RenderFunc &Render ) {
+    switch (sw.mode) {
+        case olc::Pixel::NORMAL: Render( PixelWriter<olc::Pixel::NORMAL, SHADE>( sw, sp )); break;
+        case olc::Pixel::MASK  : Render( PixelWriter<olc::Pixel::MASK  , SHADE>( sw, sp )); break;
+        case olc::Pixel::ALPHA :
+            if (bWarpPixelBlend) {
+                Render( PixelWriter<olc::Pixel::ALPHA , SHADE>( sw, sp ));
+            } else {
+                Render( PixelWriter<olc::Pixel::CUSTOM, SHADE>( sw, sp ));
+            }
+            break;
+        default                : Render( PixelWriter<olc::Pixel::CUSTOM, SHADE>( sw, sp )); break;
+    }
+}
+
+// Calls Render( writer ) with the pixel writer that is specialised for the pixel mode of sw and for enShade
+template <typename RenderFunc>
+static void DispatchPixelWriter( const SpanWriter &sw, WarpShade enShade, const ShadeParams &sp, RenderFunc Render ) {
+    switch (enShade) {
+        case WarpShade::NONE    : DispatchPixelMode<WarpShade::NONE    >( sw, sp, Render ); break;
+        case WarpShade::CONSTANT: DispatchPixelMode<WarpShade::CONSTANT>( sw, sp, Render ); break;
+        case WarpShade::GRADIENT: DispatchPixelMode<WarpShade::GRADIENT>( sw, sp, Render ); break;
+    }
+}
+
+// Thread pool for the parallel rendering mode
+// -------------------------------------------
+// The pool is persistent, so that threads are not created and destroyed per draw call. ParallelFor() distributes
+// the tasks round robin over per thread queues, and the calling thread participates as well. Each thread pops
+// tasks from the front of its own queue, and when that is empty it steals from the back of the other queues, so
+// that uneven workloads (e.g. row bands with different coverage) are balanced over the threads.
+class WarpThreadPool {
+public:
+    ~WarpThreadPool() {
+        Resize( 1 );
+    }
+
+    // sets the total nr of threads (including the calling thread), 1 means serial
+    void Resize( int nThreads ) {
+        std::lock_guard<std::mutex> callLock( mtxCall );
+        // stop and join the current worker threads
+        {
+            std::lock_guard<std::mutex> lock( mtx );
+            bQuit = true;
+        }
+        cvWork.notify_all();
+        for (auto &t : vWorkers) {
+            t.join();
+        }
+        vWorkers.clear();
+        bQuit = false;
+        // create the queues (one per thread) and start the new worker threads
+        vQueues.clear();
+        for (int i = 0; i < std::max( 1, nThreads ); i++) {
+            vQueues.push_back( std::unique_ptr<TaskQueue>( new TaskQueue ));
+        }
+        for (int i = 1; i < nThreads; i++) {
+            vWorkers.push_back( std::thread( &WarpThreadPool::WorkerLoop, this, i, nGeneration ));
+        }
+    }
+
+    int Size() const { return int( vQueues.size() ); }
+
+    // Runs Task( i ) for i in [0, nTasks) on the pool threads, and returns when all tasks are done.
+    // If the pool is busy (i.e. ParallelFor() is called from within a task or from another thread), the tasks
+    // are run serially on the calling thread.
+    template <typename TaskFunc>
+    void ParallelFor( int nTasks, TaskFunc Task ) {
+        std::unique_lock<std::mutex> callLock( mtxCall, std::try_to_lock );
+        if (!callLock.owns_lock() || vWorkers.empty() || nTasks <= 1) {
+            for (int i = 0; i < nTasks; i++) {
+                Task( i );
+            }
+            return;
+        }
+        // distribute the tasks over the queues
+        for (int i = 0; i < nTasks; i++) {
+            vQueues[i % vQueues.size()]->tasks.push_back( i );
+        }
+        std::function<void( int )> func = Task;
+        {
+            std::lock_guard<std::mutex> lock( mtx );
+            pTask = &func;
+            nStatsEntry = WARP_STATS_CURRENT_ENTRY();
+            nBusy = int( vWorkers.size() );
+            nGeneration++;
+        }
+        cvWork.notify_all();
+        // the calling thread does its share, and then waits for the workers to finish
+        RunTasks( 0 );
+        std::unique_lock<std::mutex> lock( mtx );
+        cvDone.wait( lock, [this] { return nBusy == 0; } );
+        pTask = nullptr;
+    }
+
+private:
+    struct TaskQueue {
+        std::mutex mtx;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::thread> vWorkers;
+    std::vector<std::unique_ptr<TaskQueue>> vQueues;
+    std::mutex mtxCall;                     // serializes ParallelFor() and Resize()
+    std::mutex mtx;                         // guards the members below
+    std::condition_variable cvWork, cvDone;
+    const std::function<void( int )> *pTask = nullptr;
+    int  nStatsEntry = -1;                  // the entry point of the caller, which the workers count for (see GetWarpStats())
+    uint64_t nGeneration = 0;
+    int  nBusy = 0;
+    bool bQuit = false;
+
+    // pops a task from the front of the own queue, or steals one from the back of another queue
+    bool GetTask( int nThread, int &nTask ) {
+        {
+            TaskQueue &own = *vQueues[nThread];
+            std::lock_guard<std::mutex> lock( own.mtx );
+            if (!own.tasks.empty()) {
+                nTask = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < vQueues.size(); i++) {
+            TaskQueue &victim = *vQueues[(nThread + i) % vQueues.size()];
+            std::lock_guard<std::mutex> lock( victim.mtx );
+            if (!victim.tasks.empty()) {
+                nTask = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void RunTasks( int nThread ) {
+        int nTask;
+        while (GetTask( nThread, nTask )) {
+            (*pTask)( nTask );
+        }
+    }
+
+    // nSeenGeneration is passed in at creation, since a new thread may start running after the first job was posted
+    void WorkerLoop( int nThread, uint64_t nSeenGeneration ) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock( mtx );
+                cvWork.wait( lock, [&] { return bQuit || nGeneration != nSeenGeneration; } );
+                if (bQuit) {
+                    return;
+                }
+                nSeenGeneration = nGeneration;
+            }
+            RunTasks( nThread );
+            WARP_STATS_FLUSH( nStatsEntry );
+            {
+                std::lock_guard<std::mutex> lock( mtx );
+                nBusy--;
+            }
+            cvDone.notify_one();
+        }
+    }
+};
+
+static WarpThreadPool warpThreadPool;
+
+void olc::SetWarpThreads( int nThreads ) {
+    if (nThreads <= 0) {
+        nThreads = std::max( 1, int( std::thread::hardware_concurrency() ));
+    }
+    if (nThreads != warpThreadPool.Size()) {
+        warpThreadPool.Resize( nThreads );
+    }
+}
+
+int olc::GetWarpThreads() {
+    return std::max( 1, warpThreadPool.Size() );
+}
+
+// quads with fewer pixels in their (clipped) bounding box than this are always rendered serially
+#define PARALLEL_MIN_PIXELS   16384
+
+// Splits the clipping rectangle [ClipUL, ClipLR] in bands of rows, and calls Render( BandUL, BandLR ) for them in
+// parallel on the thread pool. Small rectangles, or renders for which bThreadSafe is false, are done in one call to
+// Render() on the calling thread.
+template <typename RenderFunc>
+static void RenderInBands( olc::vi2d ClipUL, olc::vi2d ClipLR, bool bThreadSafe, RenderFunc Render ) {
+    int nRows = ClipLR.y - ClipUL.y + 1;
+    int nCols = ClipLR.x - ClipUL.x + 1;
+    int nThreads = warpThreadPool.Size();
+    if (!bThreadSafe || nThreads <= 1 || nRows <= 1 || nCols <= 0 || double( nRows ) * nCols < PARALLEL_MIN_PIXELS) {
+        Render( ClipUL, ClipLR );
+        return;
+    }
+    // make about 4 bands per thread, so that there's something left to steal for threads that finish early
+    int nBandHeight = std::max( 4, nRows / (nThreads * 4) );
+    int nBands = (nRows + nBandHeight - 1) / nBandHeight;
+    warpThreadPool.ParallelFor( nBands, [&]( int nBand ) {
+        olc::vi2d BandUL = { ClipUL.x, ClipUL.y + nBand * nBandHeight };
+        olc::vi2d BandLR = { ClipLR.x, std::min( ClipLR.y, BandUL.y + nBandHeight - 1 ) };
+        Render( BandUL, BandLR );
+    });
+}
+
+// Renders the quad described by ws like RenderWarp(), but splits the clipping rectangle in bands of rows that are
+// rendered in parallel on the thread pool. Since each pixel is evaluated independently of the others, the output is
+// identical to that of RenderWarp(). Set bThreadSafe to false if DrawPixel() must not be called concurrently.
+template <olc::WarpSampler SAMPLER, typename DrawFunc>
+static void RenderWarpParallel( const WarpSetup &ws, olc::vi2d ClipUL, olc::vi2d ClipLR, const WarpTexture &tex, olc::WarpPrecision precision, bool bThreadSafe, DrawFunc &DrawPixel ) {
+    ClipUL = ClipUL.max( ws.UpperLeft  );
+    ClipLR = ClipLR.min( ws.LowerRight );
+    RenderInBands( ClipUL, ClipLR, bThreadSafe, [&]( const olc::vi2d &BandUL, const olc::vi2d &BandLR ) {
+        RenderWarp<SAMPLER>( ws, BandUL, BandLR, tex, precision, DrawPixel );
+    });
+}
+
+// Common part of the draw functions: renders the quad described by ws into the draw target of gfx, clipped to the
+// columns [nClipLeft, nClipRight]. The renderer is picked once per quad, specialised for the current sampler, pixel
+// mode and the shading.
+static void RenderQuad( olc::PixelGameEngine *gfx, const WarpSetup &ws, const WarpTexture &tex, int nClipLeft, int nClipRight, WarpShade enShade, const ShadeParams &sp ) {
+    WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+    SpanWriter sw( gfx );
+    olc::vi2d ClipUL = { std::max( sw.ClipUL.x, nClipLeft  ), sw.ClipUL.y };
+    olc::vi2d ClipLR = { std::min( sw.ClipLR.x, nClipRight ), sw.ClipLR.y };
+    CountQuadBox( ws.UpperLeft, ws.LowerRight, ClipUL, ClipLR );
+    // in Pixel::MASK mode the transparent parts of the sprite can be skipped
+    const WarpTexture texDraw = (sw.mode == olc::Pixel::MASK) ? WithOpacityIndex( tex ) : tex;
+    DispatchPixelWriter( sw, enShade, sp, [&]( auto DrawPixel ) {
+        if (enWarpSampler == olc::WarpSampler::BILINEAR) {
+            RenderWarpParallel<olc::WarpSampler::BILINEAR>( ws, ClipUL, ClipLR, texDraw, enWarpPrecision, sw.IsThreadSafe(), DrawPixel );
+        } else {
+            RenderWarpParallel<olc::WarpSampler::NEAREST >( ws, ClipUL, ClipLR, texDraw, enWarpPrecision, sw.IsThreadSafe(), DrawPixel );
+        }
+    });
+}
+
+// converts float quad corner points to double ones
+static std::array<olc::vd2d, 4> ToDoublePoints( const std::array<olc::vf2d, 4> &points ) {
+    std::array<olc::vd2d, 4> result;
+    for (int i = 0; i < 4; i++) {
+        result[i] = points[i];
+    }
+    return result;
+}
+
+void olc::DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints ) {
+    WARP_STATS_ENTRY( DRAW_WARPED );
+
+    // work out the per quad constants
+    WarpSetup ws;
+    SetupWarp( ToDoublePoints( cornerPoints ), ws );
+
+    // render the pixels for which sampling produces a valid pixel
+    std::shared_ptr<TextureCache> pCache;
+    RenderQuad( gfx, ws, GetCachedTexture( pSprite, pCache ), INT_MIN, INT_MAX, WarpShade::NONE, ShadeParams() );
+}
+
+// I created a variant that allows for clipping left and right of the warped sprite, and takes a shading factor in [0.0f, 1.0f] for pixel rendering
+void olc::DrawWarpedSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeFactor ) {
+    WARP_STATS_ENTRY( DRAW_WARPED_CLIPPED );
+
+    // work out the per quad constants
+    WarpSetup ws;
+    SetupWarp( ToDoublePoints( cornerPoints ), ws );
+
+    // render the pixels within the clipping boundaries for which sampling produces a valid pixel
+    // a shade factor of 1.0f leaves the pixels as they are, so it doesn't need the shading code
+    ShadeParams sp;
+    sp.SetConstant( fShadeFactor );
+    std::shared_ptr<TextureCache> pCache;
+    RenderQuad( gfx, ws, GetCachedTexture( pSprite, pCache ), nClipLeft, nClipRight, (fShadeFactor == 1.0f) ? WarpShade::NONE : WarpShade::CONSTANT, sp );
+}
+
+// Same as DrawWarpedSpriteClipped(), but the shading factor runs linearly from fShadeLeft at the left side of the
+// bounding box of the quad to fShadeRight at the right side
+void olc::DrawWarpedSpriteShaded( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeLeft, float fShadeRight ) {
+    WARP_STATS_ENTRY( DRAW_WARPED_SHADED );
+
+    // work out the per quad constants
+    WarpSetup ws;
+    SetupWarp( ToDoublePoints( cornerPoints ), ws );
+
+    // set up the shade gradient over the width of the bounding box
+    ShadeParams sp;
+    int nBoxWidth = ws.LowerRight.x - ws.UpperLeft.x;
+    sp.nStartX     = ws.UpperLeft.x;
+    sp.fShadeStart = fShadeLeft;
+    sp.fShadeDelta = (nBoxWidth > 0) ? (fShadeRight - fShadeLeft) / float( nBoxWidth ) : 0.0f;
+    std::shared_ptr<TextureCache> pCache;
+    RenderQuad( gfx, ws, GetCachedTexture( pSprite, pCache ), nClipLeft, nClipRight, WarpShade::GRADIENT, sp );
+}
+
+// Calls Render( tex ) with the texture for the part of pSprite at source_pos with size source_size. The part is
+// sampled in place, unless it sticks out of the sprite. In that case it is duplicated, so that the texels outside
+// the sprite are blank (as they are for Sprite::Duplicate())
+template <typename RenderFunc>
+static void WithPartialTexture( olc::Sprite *pSprite, const olc::vi2d &source_pos, const olc::vi2d &source_size, RenderFunc Render ) {
+    WarpTexture tex;
+    if (GetPartialTexture( pSprite, source_pos, source_size, tex )) {
+        Render( tex );
+    } else if (pSprite != nullptr) {
+        olc::Sprite *pPartialSprite;
+        {
+            WARP_STATS_PHASE( WARP_STAT_TEXTURE_NS );
+            pPartialSprite = pSprite->Duplicate( source_pos, source_size );
+        }
+        Render( GetSpriteTexture( pPartialSprite ));
+        delete pPartialSprite;
+    }
+}
+
+// Same as DrawWarpedSprite(), but only a part of the sprite is rendered onto the quad
+void olc::DrawPartialWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size ) {
+    WARP_STATS_ENTRY( DRAW_PARTIAL_WARPED );
+    DrawPartialWarpedSpriteClipped( gfx, pSprite, cornerPoints, source_pos, source_size, INT_MIN, INT_MAX );
+}
+
+// Same as DrawWarpedSpriteClipped(), but only a part of the sprite is rendered onto the quad
+void olc::DrawPartialWarpedSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size, int nClipLeft, int nClipRight, float fShadeFactor ) {
+    WARP_STATS_ENTRY( DRAW_PARTIAL_WARPED );
+
+    // work out the per quad constants
+    WarpSetup ws;
+    SetupWarp( ToDoublePoints( cornerPoints ), ws );
+
+    ShadeParams sp;
+    sp.SetConstant( fShadeFactor );
+    WithPartialTexture( pSprite, source_pos, source_size, [&]( const WarpTexture &tex ) {
+        RenderQuad( gfx, ws, tex, nClipLeft, nClipRight, (fShadeFactor == 1.0f) ? WarpShade::NONE : WarpShade::CONSTANT, sp );
+    });
+}
+
+// Renders the quad twice, with the double back-end and with the selected one, and compares the coverage and the
+// texel indices per pixel. To get the texel indices, a sprite of the same size is rendered in which each texel
+// holds its own index.
+void olc::MeasureWarpPrecision( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, WarpPrecision precision, WarpPrecisionReport &report ) {
+    report = WarpPrecisionReport();
+    if (pSprite == nullptr || pSprite->width <= 0 || pSprite->height <= 0) {
+        return;
+    }
+    olc::Sprite indexSprite( pSprite->width, pSprite->height );
+    for (size_t i = 0; i < indexSprite.pColData.size(); i++) {
+        indexSprite.pColData[i] = olc::Pixel( uint32_t( i ));
+    }
+    WarpSetup ws;
+    SetupWarp( ToDoublePoints( cornerPoints ), ws );
+    int nBoxWidth  = ws.LowerRight.x - ws.UpperLeft.x + 1;
+    int nBoxHeight = ws.LowerRight.y - ws.UpperLeft.y + 1;
+    if (nBoxWidth <= 0 || nBoxHeight <= 0) {
+        return;
+    }
+    // renders the texel indices of the quad into vIndices (-1 for pixels that are not covered)
+    auto RenderIndices = [&]( olc::WarpPrecision renderPrecision, std::vector<int64_t> &vIndices ) {
+        vIndices.assign( size_t( nBoxWidth ) * nBoxHeight, -1 );
+        auto DrawPixel = [&]( int x, int y, const olc::Pixel &pix ) {
+            vIndices[size_t( y - ws.UpperLeft.y ) * nBoxWidth + (x - ws.UpperLeft.x)] = int64_t( pix.n );
+        };
+        RenderWarp<olc::WarpSampler::NEAREST>( ws, ws.UpperLeft, ws.LowerRight, GetSpriteTexture( &indexSprite ), renderPrecision, DrawPixel );
+    };
+    std::vector<int64_t> vReference, vMeasured;
+    RenderIndices( olc::WarpPrecision::DOUBLE, vReference );
+    RenderIndices( precision, vMeasured );
+    // compare them
+    for (size_t i = 0; i < vReference.size(); i++) {
+        if (vReference[i] >= 0) {
+            report.nCovered += 1;
+        }
+        if ((vReference[i] >= 0) != (vMeasured[i] >= 0)) {
+            report.nCoverageDiff += 1;
+        } else if (vReference[i] != vMeasured[i]) {
+            report.nTexelDiff += 1;
+            int nDistX = abs( int( vReference[i] % pSprite->width ) - int( vMeasured[i] % pSprite->width ));
+            int nDistY = abs( int( vReference[i] / pSprite->width ) - int( vMeasured[i] / pSprite->width ));
+            report.nMaxTexelDist = std::max( report.nMaxTexelDist, std::max( nDistX, nDistY ));
+        }
+    }
+}
+
+// Works out the per quad constants for a parallelogram, for the affine path
+static void SetupAffine( const std::array<olc::vd2d, 4> &cornerPoints, WarpSetup &ws ) {
+    // make the quad an exact parallelogram by deriving the fourth corner point from the other three
+    std::array<olc::vd2d, 4> localPoints = cornerPoints;
+    localPoints[3] = localPoints[0] + localPoints[2] - localPoints[1];
+    SetupWarp( localPoints, ws );
+    ws.bAffine = true;
+}
+
+// Draws a sprite onto a parallelogram, using the affine fast path
+void olc::DrawAffineSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vd2d, 4> &cornerPoints ) {
+    WARP_STATS_ENTRY( DRAW_AFFINE );
+
+    // work out the per quad constants
+    WarpSetup ws;
+    SetupAffine( cornerPoints, ws );
+
+    // render the pixels covered by the parallelogram
+    std::shared_ptr<TextureCache> pCache;
+    RenderQuad( gfx, ws, GetCachedTexture( pSprite, pCache ), INT_MIN, INT_MAX, WarpShade::NONE, ShadeParams() );
+}
+
+// Draws a sprite with 4 arbitrary points, warping the texture to look "correct"
+void olc::DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const olc::vf2d(&pos)[4] ) {
+    WARP_STATS_ENTRY( DRAW_WARPED );
+    std::array<olc::vf2d, 4> localPoints;
+    for (int i = 0; i < 4; i++) {
+        localPoints[i] = pos[i];
+    }
+    DrawWarpedSprite( gfx, pSprite, localPoints );
+}
+
+// Draws a sprite with 4 arbitrary points, warping the texture to look "correct"
+void olc::DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const olc::vf2d *pos ) {
+    WARP_STATS_ENTRY( DRAW_WARPED );
+    std::array<olc::vf2d, 4> localPoints;
+    for (int i = 0; i < 4; i++) {
+        localPoints[i] = pos[i];
+    }
+    DrawWarpedSprite( gfx, pSprite, localPoints );
+}
+
+// calculates new coordinates for each of the quadPoints, by rotating them with dAngle around centerPoint
+void olc::RotateQuadPoints( std::array<olc::vd2d, 4> &quadPoints, double dAngle, olc::vd2d centerPoint ) {
+    double dCosTheta = cos( dAngle );
+    double dSinTheta = sin( dAngle );
+    // iterate quad points
+    for (int i = 0; i < 4; i++) {
+        // first translate point so that center point aligns with origin
+        quadPoints[i] -= centerPoint;
+        // rotate point - because x component is altered and used for calculating y component
+        // a cache is applied
+        olc::vd2d cachePoint = quadPoints[i];
+        quadPoints[i].x = cachePoint.x * dCosTheta - cachePoint.y * dSinTheta;
+        quadPoints[i].y = cachePoint.x * dSinTheta + cachePoint.y * dCosTheta;
+        // translate back
+        quadPoints[i] += centerPoint;
+    }
+}
+
+// Works out the corner points (ul, ll, lr, ur) of a sprite of nWidth x nHeight pixels at screen location pos,
+// that is scaled and then rotated around center by fAngle
+static std::array<olc::vd2d, 4> GetRotatedSpritePoints( const olc::vf2d& pos, int nWidth, int nHeight, const float fAngle, const olc::vf2d& center, const olc::vf2d& scale ) {
+    // prepare call to RotateQuadPoints(). The points are worked out relative to the center, and the rotated offsets are
+    // snapped to multiples of 2^-32 pixel, so that adding the center back is exact: a sprite that is moved by whole
+    // pixels then gets exactly the same pixels (which the rotation cache relies on)
+    std::array<olc::vd2d, 4> localPoints;
+    olc::vd2d dCenterPoint = olc::vd2d( double( center.x ), double( center.y ));
+    olc::vd2d ul = olc::vd2d( double( pos.x ), double( pos.y )) - dCenterPoint;
+    olc::vd2d lr = ul + olc::vd2d( nWidth * scale.x, nHeight * scale.y );
+    localPoints[0] = olc::vd2d( ul.x, ul.y );
+    localPoints[1] = olc::vd2d( ul.x, lr.y );
+    localPoints[2] = olc::vd2d( lr.x, lr.y );
+    localPoints[3] = olc::vd2d( lr.x, ul.y );
+    // rotate the points around the center
+    olc::RotateQuadPoints( localPoints, double( fAngle ), olc::vd2d( 0.0, 0.0 ));
+    for (int i = 0; i < 4; i++) {
+        localPoints[i].x = std::round( localPoints[i].x * 4294967296.0 ) / 4294967296.0 + dCenterPoint.x;
+        localPoints[i].y = std::round( localPoints[i].y * 4294967296.0 ) / 4294967296.0 + dCenterPoint.y;
+    }
+    return localPoints;
+}
+
+// Rotation cache
+// --------------
+// The cache holds rendered bitmaps of rotated sprites. A bitmap is rendered with the pivot (center) at its sub pixel
+// offset from the origin, so it can be drawn at any whole pixel offset from there. Since the corner points are
+// translated exactly (see GetRotatedSpritePoints()), this gives the same pixels as rendering the sprite in place.
+// Since a rotated rectangle is convex, the pixels it covers on a row are consecutive, so a span per row tells which
+// pixels of the bitmap are to be drawn. The entries are kept in a list in LRU order (most recently used first), and
+// the map refers to them by key.
+struct RotationKey {
+    const olc::Sprite *pSprite = nullptr;
+    const olc::Pixel *pSource = nullptr;    // sprite data and size, to detect changes
+    int nWidth = 0, nHeight = 0;
+    int nStep = 0;                          // the quantised angle
+    float fScaleX = 0.0f, fScaleY = 0.0f;
+    int nOffsetX = 0, nOffsetY = 0;         // pos - center, in 1/16 pixels
+    int nSubX = 0, nSubY = 0;               // the sub pixel part of center, in 1/16 pixels
+    int nSettings = 0;                      // the sampler, precision and mip mapping, which all affect the bitmap
+
+    bool operator == ( const RotationKey &other ) const {
+        return pSprite == other.pSprite && pSource == other.pSource && nWidth == other.nWidth && nHeight == other.nHeight &&
+            nStep == other.nStep && fScaleX == other.fScaleX && fScaleY == other.fScaleY &&
+            nOffsetX == other.nOffsetX && nOffsetY == other.nOffsetY && nSubX == other.nSubX && nSubY == other.nSubY && nSettings == other.nSettings;
+    }
+};
+
+struct RotationKeyHash {
+    size_t operator () ( const RotationKey &key ) const {
+        size_t h = std::hash<const void *>()( key.pSprite );
+        auto Combine = [&]( size_t v ) { h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2); };
+        Combine( std::hash<const void *>()( key.pSource ));
+        Combine( size_t( key.nWidth ) * 31 + size_t( key.nHeight ));
+        Combine( size_t( key.nStep ));
+        Combine( std::hash<float>()( key.fScaleX ));
+        Combine( std::hash<float>()( key.fScaleY ));
+        Combine( size_t( key.nOffsetX ) * 131 + size_t( key.nOffsetY ));
+        Combine( size_t( key.nSubX ) * 16 + size_t( key.nSubY ));
+        Combine( size_t( key.nSettings ));
+        return h;
+    }
+};
+
+struct RotatedBitmap {
+    olc::vi2d offset;                   // position of the upper left pixel relative to the whole pixel part of the pivot
+    int nWidth  = 0;
+    int nHeight = 0;
+    std::vector<olc::Pixel> vPixels;
+    std::vector<int> vSpans;            // first and last covered column per row (last < first if none)
+    size_t nBytes = 0;
+};
+
+struct RotationEntry {
+    RotationKey key;
+    std::shared_ptr<RotatedBitmap> pBitmap;
+};
+
+static std::mutex mtxRotationCache;
+static size_t nRotationBudget = 0;
+static int    nRotationSteps  = 256;
+static std::list<RotationEntry> lstRotationCache;
+static std::unordered_map<RotationKey, std::list<RotationEntry>::iterator, RotationKeyHash> mapRotationCache;
+static olc::WarpRotationCacheReport rotationReport;
+
+void olc::SetWarpRotationCache( size_t nBudgetBytes, int nAngleSteps ) {
+    std::lock_guard<std::mutex> lock( mtxRotationCache );
+    nRotationBudget = nBudgetBytes;
+    nRotationSteps  = std::max( 1, nAngleSteps );
+    lstRotationCache.clear();
+    mapRotationCache.clear();
+    rotationReport = olc::WarpRotationCacheReport();
+}
+
+olc::WarpRotationCacheReport olc::GetWarpRotationCacheReport() {
+    std::lock_guard<std::mutex> lock( mtxRotationCache );
+    return rotationReport;
+}
+
+// drops the bitmaps of pSprite, or all of them if pSprite is nullptr
+static void InvalidateRotationCache( const olc::Sprite *pSprite ) {
+    std::lock_guard<std::mutex> lock( mtxRotationCache );
+    for (auto iter = lstRotationCache.begin(); iter != lstRotationCache.end(); ) {
+        if (pSprite == nullptr || iter->key.pSprite == pSprite) {
+            rotationReport.nBytes -= iter->pBitmap->nBytes;
+            rotationReport.nEntries--;
+            mapRotationCache.erase( iter->key );
+            iter = lstRotationCache.erase( iter );
+        } else {
+            iter++;
+        }
+    }
+}
+
+// renders the quad of ws (with the pivot at the origin) into a bitmap, with the current sampler and precision
+static std::shared_ptr<RotatedBitmap> RenderRotatedBitmap( const WarpSetup &ws, const WarpTexture &tex ) {
+    std::shared_ptr<RotatedBitmap> pBitmap = std::make_shared<RotatedBitmap>();
+    pBitmap->offset  = ws.UpperLeft;
+    pBitmap->nWidth  = ws.LowerRight.x - ws.UpperLeft.x + 1;
+    pBitmap->nHeight = ws.LowerRight.y - ws.UpperLeft.y + 1;
+    pBitmap->vPixels.assign( size_t( pBitmap->nWidth ) * pBitmap->nHeight, olc::BLANK );
+    pBitmap->vSpans.resize( 2 * size_t( pBitmap->nHeight ));
+    for (int r = 0; r < pBitmap->nHeight; r++) {
+        pBitmap->vSpans[2 * r    ] = pBitmap->nWidth;
+        pBitmap->vSpans[2 * r + 1] = -1;
+    }
+    auto DrawPixel = [&]( int x, int y, olc::Pixel pix ) {
+        int c = x - pBitmap->offset.x;
+        int r = y - pBitmap->offset.y;
+        pBitmap->vPixels[size_t( r ) * pBitmap->nWidth + c] = pix;
+        pBitmap->vSpans[2 * r    ] = std::min( pBitmap->vSpans[2 * r    ], c );
+        pBitmap->vSpans[2 * r + 1] = std::max( pBitmap->vSpans[2 * r + 1], c );
+    };
+    // the time counts as rendering, but the pixels are counted when the bitmap is drawn
+    WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+    WARP_STATS_SUSPEND();
+    if (enWarpSampler == olc::WarpSampler::BILINEAR) {
+        RenderWarp<olc::WarpSampler::BILINEAR>( ws, ws.UpperLeft, ws.LowerRight, tex, enWarpPrecision, DrawPixel );
+    } else {
+        RenderWarp<olc::WarpSampler::NEAREST >( ws, ws.UpperLeft, ws.LowerRight, tex, enWarpPrecision, DrawPixel );
+    }
+    pBitmap->nBytes = sizeof( RotatedBitmap ) + pBitmap->vPixels.size() * sizeof( olc::Pixel ) + pBitmap->vSpans.size() * sizeof( int );
+    return pBitmap;
+}
+
+// draws the bitmap with the whole pixel part of its pivot at pivot, honouring the pixel mode
+static void DrawRotatedBitmap( olc::PixelGameEngine *gfx, const RotatedBitmap &bitmap, const olc::vi2d &pivot ) {
+    WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+    SpanWriter sw( gfx );
+    olc::vi2d origin = pivot + bitmap.offset;
+    CountQuadBox( origin, origin + olc::vi2d( bitmap.nWidth - 1, bitmap.nHeight - 1 ), sw.ClipUL, sw.ClipLR );
+    DispatchPixelWriter( sw, WarpShade::NONE, ShadeParams(), [&]( auto DrawPixel ) {
+        int r_strt = std::max( 0, sw.ClipUL.y - origin.y );
+        int r_stop = std::min( bitmap.nHeight - 1, sw.ClipLR.y - origin.y );
+        int c_clip_strt = std::max( 0, sw.ClipUL.x - origin.x );
+        int c_clip_stop = std::min( bitmap.nWidth - 1, sw.ClipLR.x - origin.x );
+        for (int r = r_strt; r <= r_stop && c_clip_strt <= c_clip_stop; r++) {
+            int c_strt = std::max( bitmap.vSpans[2 * r    ], c_clip_strt );
+            int c_stop = std::min( bitmap.vSpans[2 * r + 1], c_clip_stop );
+            const olc::Pixel *pRow = bitmap.vPixels.data() + size_t( r ) * bitmap.nWidth;
+            // the pixels of the row outside of the span were found to be outside the quad when the bitmap was rendered
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, (c_clip_stop - c_clip_strt + 1) - std::max( 0, c_stop - c_strt + 1 ));
+            WARP_STATS_ADD( WARP_STAT_TESTED , std::max( 0, c_stop - c_strt + 1 ));
+            WARP_STATS_ADD( WARP_STAT_COVERED, std::max( 0, c_stop - c_strt + 1 ));
+            WARP_STATS_ADD( WARP_STAT_TEXELS , std::max( 0, c_stop - c_strt + 1 ));
+            for (int c = c_strt; c <= c_stop; c++) {
+                DrawPixel( origin.x + c, origin.y + r, pRow[c] );
+            }
+        }
+    });
+}
+
+// Draws the rotated sprite via the rotation cache. Returns false if the cache is disabled, or if the bitmap doesn't fit
+// in the budget (in which case nothing is drawn)
+static bool DrawRotatedCached( olc::PixelGameEngine *gfx, const olc::vf2d& pos, olc::Sprite *pSprite, const float fAngle, const olc::vf2d& center, const olc::vf2d& scale ) {
+    size_t nBudget;
+    int nSteps;
+    {
+        std::lock_guard<std::mutex> lock( mtxRotationCache );
+        nBudget = nRotationBudget;
+        nSteps  = nRotationSteps;
+    }
+    if (nBudget == 0 || pSprite == nullptr || pSprite->width <= 0 || pSprite->height <= 0) {
+        return false;
+    }
+    // quantise the angle, the position of the sprite relative to the pivot, and the pivot itself
+    const double TWO_PI = 6.283185307179586;
+    double dTurns = double( fAngle ) / TWO_PI;
+    int nStep = int( std::lround( (dTurns - floor( dTurns )) * nSteps )) % nSteps;
+    RotationKey key;
+    key.pSprite   = pSprite;
+    key.pSource   = pSprite->pColData.data();
+    key.nWidth    = pSprite->width;
+    key.nHeight   = pSprite->height;
+    key.nStep     = nStep;
+    key.fScaleX   = scale.x;
+    key.fScaleY   = scale.y;
+    key.nOffsetX  = int( std::lround( (double( pos.x ) - double( center.x )) * 16.0 ));
+    key.nOffsetY  = int( std::lround( (double( pos.y ) - double( center.y )) * 16.0 ));
+    key.nSettings = int( enWarpSampler ) | (int( enWarpPrecision ) << 2) | (int( bWarpMipmaps ) << 4);
+    // the whole pixel part of the pivot is the translation of the bitmap, the sub pixel part is in the key
+    long nCenterX = std::lround( double( center.x ) * 16.0 );
+    long nCenterY = std::lround( double( center.y ) * 16.0 );
+    olc::vi2d pivot = { int( floor( nCenterX / 16.0 )), int( floor( nCenterY / 16.0 )) };
+    key.nSubX = int( nCenterX - 16L * pivot.x );
+    key.nSubY = int( nCenterY - 16L * pivot.y );
+
+    std::shared_ptr<RotatedBitmap> pBitmap;
+    {
+        std::lock_guard<std::mutex> lock( mtxRotationCache );
+        auto iter = mapRotationCache.find( key );
+        if (iter != mapRotationCache.end()) {
+            // move the entry to the front of the LRU order
+            lstRotationCache.splice( lstRotationCache.begin(), lstRotationCache, iter->second );
+            pBitmap = iter->second->pBitmap;
+            rotationReport.nHits++;
+        }
+    }
+    if (pBitmap == nullptr) {
+        // render the bitmap around the sub pixel part of the pivot with the quantised parameters
+        olc::vf2d sub = { float( key.nSubX ) / 16.0f, float( key.nSubY ) / 16.0f };
+        olc::vf2d offset = { float( key.nOffsetX ) / 16.0f, float( key.nOffsetY ) / 16.0f };
+        float fQuantAngle = float( TWO_PI * nStep / nSteps );
+        // the pivot is moved by nShift whole pixels, to keep all coordinates positive: the bounding box of the quad is
+        // then rounded the same way as that of a sprite that is rendered in place
+        int nShift = int( ceil( fabs( offset.x ) + fabs( offset.y ) + pSprite->width * fabs( scale.x ) + pSprite->height * fabs( scale.y ))) + 1;
+        sub += olc::vf2d( float( nShift ), float( nShift ));
+        WarpSetup ws;
+        SetupAffine( GetRotatedSpritePoints( sub + offset, pSprite->width, pSprite->height, fQuantAngle, sub, scale ), ws );
+        int64_t nArea = int64_t( ws.LowerRight.x - ws.UpperLeft.x + 1 ) * (ws.LowerRight.y - ws.UpperLeft.y + 1);
+        if (nArea * int64_t( sizeof( olc::Pixel )) > int64_t( std::min( nBudget, size_t( INT64_MAX ))) ) {
+            return false;
+        }
+        std::shared_ptr<TextureCache> pCache;
+        pBitmap = RenderRotatedBitmap( ws, GetCachedTexture( pSprite, pCache ));
+        pBitmap->offset -= olc::vi2d( nShift, nShift );
+
+        std::lock_guard<std::mutex> lock( mtxRotationCache );
+        rotationReport.nMisses++;
+        // another thread may have added it in the mean time, or the budget may have changed
+        if (mapRotationCache.find( key ) == mapRotationCache.end() && pBitmap->nBytes <= nRotationBudget) {
+            lstRotationCache.push_front( { key, pBitmap } );
+            mapRotationCache[key] = lstRotationCache.begin();
+            rotationReport.nEntries++;
+            rotationReport.nBytes += pBitmap->nBytes;
+            // evict the least recently used bitmaps (but not the new one)
+            while (rotationReport.nBytes > nRotationBudget && lstRotationCache.size() > 1) {
+                RotationEntry &last = lstRotationCache.back();
+                rotationReport.nBytes -= last.pBitmap->nBytes;
+                rotationReport.nEntries--;
+                rotationReport.nEvictions++;
+                mapRotationCache.erase( last.key );
+                lstRotationCache.pop_back();
+            }
+        }
+    }
+    DrawRotatedBitmap( gfx, *pBitmap, pivot );
+    return true;
+}
+
+// Draws a sprite rotated to specified angle, with point of rotation offset
+void olc::DrawRotatedSprite( PixelGameEngine *gfx, const olc::vf2d& pos, olc::Sprite *pSprite, const float fAngle, const olc::vf2d& center, const olc::vf2d& scale ) {
+    WARP_STATS_ENTRY( DRAW_ROTATED );
+    if (DrawRotatedCached( gfx, pos, pSprite, fAngle, center, scale )) {
+        return;
+    }
+    std::array<olc::vd2d, 4> localPoints = GetRotatedSpritePoints( pos, pSprite->width, pSprite->height, fAngle, center, scale );
+    // a rotated rectangle is a parallelogram, so render sprite using the rotated cornerpoints on the affine path
+    DrawAffineSprite( gfx, pSprite, localPoints );
+}
+
+// renders a warped sprite that is rotated around centerPoint by fAngle
+void olc::DrawWarpedRotatedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint ) {
+    WARP_STATS_ENTRY( DRAW_WARPED_ROTATED );
+    // copy quad corner points
+    std::array<olc::vd2d, 4> rotatedPoints;
+    for (int i = 0; i < 4; i++) {
+        rotatedPoints[i] = cornerPoints[i];
+    }
+    // convert float parameters to doubles
+    double dAngle = double( fAngle );
+    olc::vd2d dCenterPoint( centerPoint );
+
+    // rotate them around center point
+    RotateQuadPoints( rotatedPoints, dAngle, dCenterPoint );
+    // rotation preserves parallelograms, so if the input quad is one, the affine path can be used
+    olc::vf2d b3 = cornerPoints[1] - cornerPoints[2] - cornerPoints[0] + cornerPoints[3];
+    if (b3.x == 0.0f && b3.y == 0.0f) {
+        DrawAffineSprite( gfx, pSprite, rotatedPoints );
+        return;
+    }
+    // convert back to correct type
+    std::array<olc::vf2d, 4> localPoints;
+    for (int i = 0; i < 4; i++) {
+        localPoints[i] = rotatedPoints[i];
+    }
+    // draw sprite using rotated cornerpoints
+    DrawWarpedSprite( gfx, pSprite, localPoints );
+}
+
+// Pretty much the same as DrawRotatedSprite(), but only a part of the sprite is rendered
+void olc::DrawPartialRotatedSprite(
+    PixelGameEngine *gfx,
+    const olc::vf2d& pos,           // location on screen for the (unrotated) sprite origin
+    olc::Sprite *pSprite,           // pointer to the sprite to draw
+    const float fAngle,             // angle and centerpoint to rotate around
+    const olc::vf2d& center,
+    const olc::vf2d& source_pos,    // origin and size of the part of the sprite to render
+    const olc::vf2d& source_size,
+    const olc::vf2d& scale          // scaling factors in two directions
+) {
+    WARP_STATS_ENTRY( DRAW_PARTIAL_ROTATED );
+
+    // note that the size of the whole sprite is used for the quad, not the size of the part
+    std::array<olc::vd2d, 4> localPoints = GetRotatedSpritePoints( pos, pSprite->width, pSprite->height, fAngle, center, scale );
+    WarpSetup ws;
+    SetupAffine( localPoints, ws );
+    // render the part of the sprite using the rotated cornerpoints on the affine path - the part is sampled in place,
+    // so there's no need to duplicate it anymore
+    WithPartialTexture( pSprite, source_pos, source_size, [&]( const WarpTexture &tex ) {
+        RenderQuad( gfx, ws, tex, INT_MIN, INT_MAX, WarpShade::NONE, ShadeParams() );
+    });
+}
+
+// Projective warps
+// ----------------
+// The projective mapping maps the unit square onto the quad with a 3x3 homography (the square to quad construction from
+// Paul Heckbert's "Fundamentals of Texture Mapping and Image Warping"). Its inverse maps a screen pixel (x, y) to
+// (S, T, W), with texel coordinates s = S / W and t = T / W. Since S, T and W are linear in x, they are worked out once
+// per span, and each pixel costs a multiply-add for each and one reciprocal - no sqrt, and no branches other than the
+// coverage test.
+
+// This struct holds the per quad constants of the projective mapping
+struct ProjectiveSetup {
+    std::array<olc::vd2d, 4> points;    // quad corner points (in any order - they are only used for the spans)
+    double aInv[3][3];                  // inverse homography: (S, T, W) = aInv * (x, y, 1)
+    double dSign = 1.0;                 // sign of W for pixels at the visible side of the horizon of the quad
+    bool   bValid = false;              // false if the quad is degenerate
+    olc::vi2d UpperLeft, LowerRight;    // bounding box around the quad
+};
+
+// Works out the inverse homography for the corner points (in the order ul, ll, lr, ur). The upper left corner of the
+// sprite maps to ul, the upper right corner to ur, etc.
+static void SetupProjective( const std::array<olc::vd2d, 4> &cornerPoints, ProjectiveSetup &ps ) {
+    WARP_STATS_PHASE( WARP_STAT_SETUP_NS );
+    ps.points = cornerPoints;
+    olc::GetQuadBoundingBox( ps.points, ps.UpperLeft, ps.LowerRight );
+
+    // the square to quad mapping for (0, 0) -> ul, (1, 0) -> ur, (1, 1) -> lr and (0, 1) -> ll
+    const olc::vd2d &p0 = cornerPoints[0];
+    const olc::vd2d &p1 = cornerPoints[3];
+    const olc::vd2d &p2 = cornerPoints[2];
+    const olc::vd2d &p3 = cornerPoints[1];
+    olc::vd2d sum = p0 - p1 + p2 - p3;
+    double a, b, c, d, e, f, g, h;
+    if (sum.x == 0.0 && sum.y == 0.0) {
+        // parallelogram - the mapping is affine
+        a = p1.x - p0.x; b = p2.x - p1.x; c = p0.x;
+        d = p1.y - p0.y; e = p2.y - p1.y; f = p0.y;
+        g = 0.0;         h = 0.0;
+    } else {
+        olc::vd2d d1 = p1 - p2;
+        olc::vd2d d2 = p3 - p2;
+        double den = d1.x * d2.y - d2.x * d1.y;
+        if (fabs( den ) < NEAR_ZERO) {
+            ps.bValid = false;
+            return;
+        }
+        g = (sum.x * d2.y - d2.x * sum.y) / den;
+        h = (d1.x * sum.y - sum.x * d1.y) / den;
+        a = p1.x - p0.x + g * p1.x; b = p3.x - p0.x + h * p3.x; c = p0.x;
+        d = p1.y - p0.y + g * p1.y; e = p3.y - p0.y + h * p3.y; f = p0.y;
+    }
+    // the inverse is the adjugate - the missing factor 1 / determinant cancels out in S / W and T / W
+    double det = a * (e - f * h) - b * (d - f * g) + c * (d * h - e * g);
+    if (fabs( det ) < NEAR_ZERO) {
+        ps.bValid = false;
+        return;
+    }
+    ps.aInv[0][0] = e - f * h; ps.aInv[0][1] = c * h - b; ps.aInv[0][2] = b * f - c * e;
+    ps.aInv[1][0] = f * g - d; ps.aInv[1][1] = a - c * g; ps.aInv[1][2] = c * d - a * f;
+    ps.aInv[2][0] = d * h - e * g; ps.aInv[2][1] = b * g - a * h; ps.aInv[2][2] = a * e - b * d;
+    // W = det / w, where w (the homogeneous coordinate of the forward mapping) is positive within the quad
+    ps.dSign  = (det > 0.0) ? 1.0 : -1.0;
+    ps.bValid = true;
+}
+
+// Renders the quad described by ps within the clipping rectangle [ClipUL, ClipLR]. For each covered pixel,
+// DrawPixel( x, y, colour ) is called.
+template <olc::WarpSampler SAMPLER, typename DrawFunc>
+static void RenderProjective( const ProjectiveSetup &ps, olc::vi2d ClipUL, olc::vi2d ClipLR, const WarpTexture &tex, DrawFunc &DrawPixel ) {
+    if (!ps.bValid || tex.pTexels == nullptr || tex.nWidth <= 0 || tex.nHeight <= 0) {
+        return;
+    }
+    ClipUL = ClipUL.max( ps.UpperLeft  );
+    ClipLR = ClipLR.min( ps.LowerRight );
+    double dW = double( tex.nWidth  );
+    double dH = double( tex.nHeight );
+    const double (&M)[3][3] = ps.aInv;
+    for (int y = ClipUL.y; y <= ClipLR.y; y++) {
+        int x_strt, x_stop;
+        if (!olc::GetQuadScanlineSpan( ps.points, y, ClipUL.x, ClipLR.x, x_strt, x_stop )) {
+            WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, ClipLR.x - ClipUL.x + 1 );
+            continue;
+        }
+        WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, (ClipLR.x - ClipUL.x) - (x_stop - x_strt));
+        WARP_STATS_ADD( WARP_STAT_TESTED, x_stop - x_strt + 1 );
+        // S, T and W at the start of the span
+        double S0 = M[0][0] * x_strt + M[0][1] * y + M[0][2];
+        double T0 = M[1][0] * x_strt + M[1][1] * y + M[1][2];
+        double W0 = M[2][0] * x_strt + M[2][1] * y + M[2][2];
+        for (int i = 0; i <= x_stop - x_strt; i++) {
+            double di = double( i );
+            double W = W0 + M[2][0] * di;
+            if (W * ps.dSign <= 0.0) {
+                WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, 1 );
+                continue;
+            }
+            double r = 1.0 / W;
+            double s = (S0 + M[0][0] * di) * r;
+            double t = (T0 + M[1][0] * di) * r;
+            if (s < 0.0 || s > 1.0 || t < 0.0 || t > 1.0) {
+                WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, 1 );
+                continue;
+            }
+            WARP_STATS_ADD( WARP_STAT_COVERED, 1 );
+            WARP_STATS_ADD( WARP_STAT_TEXELS, TexelsPerSample<SAMPLER>( tex ));
+            if (SAMPLER == olc::WarpSampler::NEAREST) {
+                int sx = int( std::min( s * dW, dW - 1.0 ));
+                int sy = int( std::min( t * dH, dH - 1.0 ));
+                DrawPixel( x_strt + i, y, tex.pTexels[sy * tex.nStride + sx] );
+            } else {
+                DrawPixel( x_strt + i, y, SampleBilinear( tex, s * dW, t * dH ));
+            }
+        }
+    }
+}
+
+// Same as RenderQuad(), for the projective mapping
+static void RenderProjectiveQuad( olc::PixelGameEngine *gfx, const ProjectiveSetup &ps, const WarpTexture &tex, int nClipLeft, int nClipRight, WarpShade enShade, const ShadeParams &sp ) {
+    WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+    SpanWriter sw( gfx );
+    if (ps.bValid) {
+        CountQuadBox( ps.UpperLeft, ps.LowerRight, { std::max( sw.ClipUL.x, nClipLeft ), sw.ClipUL.y }, { std::min( sw.ClipLR.x, nClipRight ), sw.ClipLR.y } );
+    }
+    olc::vi2d ClipUL = olc::vi2d( std::max( sw.ClipUL.x, nClipLeft  ), sw.ClipUL.y ).max( ps.UpperLeft  );
+    olc::vi2d ClipLR = olc::vi2d( std::min( sw.ClipLR.x, nClipRight ), sw.ClipLR.y ).min( ps.LowerRight );
+    if (!ps.bValid || ClipUL.x > ClipLR.x || ClipUL.y > ClipLR.y) {
+        return;
+    }
+    DispatchPixelWriter( sw, enShade, sp, [&]( auto DrawPixel ) {
+        RenderInBands( ClipUL, ClipLR, sw.IsThreadSafe(), [&]( const olc::vi2d &BandUL, const olc::vi2d &BandLR ) {
+            if (enWarpSampler == olc::WarpSampler::BILINEAR) {
+                RenderProjective<olc::WarpSampler::BILINEAR>( ps, BandUL, BandLR, tex, DrawPixel );
+            } else {
+                RenderProjective<olc::WarpSampler::NEAREST >( ps, BandUL, BandLR, tex, DrawPixel );
+            }
+        });
+    });
+}
+
+void olc::DrawProjectiveSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints ) {
+    WARP_STATS_ENTRY( DRAW_PROJECTIVE );
+    DrawProjectiveSpriteClipped( gfx, pSprite, cornerPoints, INT_MIN, INT_MAX );
+}
+
+void olc::DrawProjectiveSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeFactor ) {
+    WARP_STATS_ENTRY( DRAW_PROJECTIVE );
+    ProjectiveSetup ps;
+    SetupProjective( ToDoublePoints( cornerPoints ), ps );
+
+    ShadeParams sp;
+    sp.SetConstant( fShadeFactor );
+    RenderProjectiveQuad( gfx, ps, GetSpriteTexture( pSprite ), nClipLeft, nClipRight, (fShadeFactor == 1.0f) ? WarpShade::NONE : WarpShade::CONSTANT, sp );
+}
+
+void olc::DrawProjectiveSpriteShaded( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeLeft, float fShadeRight ) {
+    WARP_STATS_ENTRY( DRAW_PROJECTIVE );
+    ProjectiveSetup ps;
+    SetupProjective( ToDoublePoints( cornerPoints ), ps );
+
+    // set up the shade gradient over the width of the bounding box
+    ShadeParams sp;
+    int nBoxWidth = ps.LowerRight.x - ps.UpperLeft.x;
+    sp.nStartX     = ps.UpperLeft.x;
+    sp.fShadeStart = fShadeLeft;
+    sp.fShadeDelta = (nBoxWidth > 0) ? (fShadeRight - fShadeLeft) / float( nBoxWidth ) : 0.0f;
+    RenderProjectiveQuad( gfx, ps, GetSpriteTexture( pSprite ), nClipLeft, nClipRight, WarpShade::GRADIENT, sp );
+}
+
+void olc::DrawPartialProjectiveSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size ) {
+    WARP_STATS_ENTRY( DRAW_PROJECTIVE );
+    DrawPartialProjectiveSpriteClipped( gfx, pSprite, cornerPoints, source_pos, source_size, INT_MIN, INT_MAX );
+}
+
+void olc::DrawPartialProjectiveSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size, int nClipLeft, int nClipRight, float fShadeFactor ) {
+    WARP_STATS_ENTRY( DRAW_PROJECTIVE );
+    ProjectiveSetup ps;
+    SetupProjective( ToDoublePoints( cornerPoints ), ps );
+
+    ShadeParams sp;
+    sp.SetConstant( fShadeFactor );
+    WithPartialTexture( pSprite, source_pos, source_size, [&]( const WarpTexture &tex ) {
+        RenderProjectiveQuad( gfx, ps, tex, nClipLeft, nClipRight, (fShadeFactor == 1.0f) ? WarpShade::NONE : WarpShade::CONSTANT, sp );
+    });
+}
+
+// Warp plans
+// ----------
+// A plan holds the per quad constants and the (unclipped) span of the quad on each row of its bounding box, so that
+// drawing it only has to clip the spans and sample.
+
+// bounding boxes higher than this don't get precomputed spans, to keep the memory use of a plan within limits
+#define PLAN_MAX_SPAN_ROWS   16384
+
+// The UV map of a plan: the covered pixels as runs of consecutive pixels on a row, and per covered pixel the texel
+// coordinates (sx, sy) as a pair of int16's. Drawing from the map is a pure gather.
+struct UVRun {
+    int y, x;           // first pixel of the run
+    int nCount;         // nr of pixels in the run
+    int nOffset;        // index of the texel coordinates of the first pixel in vTexels (divided by 2)
+};
+
+struct UVMap {
+    olc::vi2d spriteSize;           // size of the sprites the map is valid for
+    olc::vi2d ClipUL, ClipLR;       // the part of the quad box that was within the draw target when the map was baked
+    std::vector<UVRun>   vRuns;     // in the order they were rendered (rows top to bottom, left to right within a row)
+    std::vector<int16_t> vTexels;   // sx, sy per covered pixel
+};
+
+struct olc::WarpPlanData {
+    WarpSetup ws;
+    std::vector<int> vSpans;            // start and stop x per row of the bounding box
+    std::unique_ptr<UVMap> pUVMap;      // the baked UV map, if any
+};
+
+// Works out the spans of the (non parallelogram) quad of data.ws, and lets the setup refer to them
+static void PrepareSpans( olc::WarpPlanData &data ) {
+    WarpSetup &ws = data.ws;
+    int nRows = ws.LowerRight.y - ws.UpperLeft.y + 1;
+    // the affine path works out its spans from the mapping itself
+    if (ws.bAffine || nRows <= 0 || nRows > PLAN_MAX_SPAN_ROWS) {
+        return;
+    }
+    data.vSpans.resize( 2 * size_t( nRows ));
+    for (int r = 0; r < nRows; r++) {
+        int *pSpan = &data.vSpans[2 * r];
+        if (!olc::GetQuadScanlineSpan( ws.points, ws.UpperLeft.y + r, ws.UpperLeft.x, ws.LowerRight.x, pSpan[0], pSpan[1] )) {
+            pSpan[0] = 0;
+            pSpan[1] = -1;
+        }
+    }
+    ws.pSpans = data.vSpans.data();
+}
+
+void olc::WarpPlan::SetWarped( const std::array<olc::vf2d, 4> &cornerPoints ) {
+    std::shared_ptr<WarpPlanData> pNew = std::make_shared<WarpPlanData>();
+    SetupWarp( ToDoublePoints( cornerPoints ), pNew->ws );
+    PrepareSpans( *pNew );
+    pData = pNew;
+}
+
+void olc::WarpPlan::SetAffine( const std::array<olc::vd2d, 4> &cornerPoints ) {
+    std::shared_ptr<WarpPlanData> pNew = std::make_shared<WarpPlanData>();
+    SetupAffine( cornerPoints, pNew->ws );
+    pData = pNew;
+}
+
+void olc::WarpPlan::SetWarpedRotated( const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint ) {
+    // same as DrawWarpedRotatedSprite()
+    std::array<olc::vd2d, 4> rotatedPoints = ToDoublePoints( cornerPoints );
+    RotateQuadPoints( rotatedPoints, double( fAngle ), centerPoint );
+    olc::vf2d b3 = cornerPoints[1] - cornerPoints[2] - cornerPoints[0] + cornerPoints[3];
+    if (b3.x == 0.0f && b3.y == 0.0f) {
+        SetAffine( rotatedPoints );
+        return;
+    }
+    std::array<olc::vf2d, 4> localPoints;
+    for (int i = 0; i < 4; i++) {
+        localPoints[i] = rotatedPoints[i];
+    }
+    SetWarped( localPoints );
+}
+
+void olc::WarpPlan::SetRotated( const olc::vf2d& pos, const olc::vi2d& spriteSize, const float fAngle, const olc::vf2d& center, const olc::vf2d& scale ) {
+    SetAffine( GetRotatedSpritePoints( pos, spriteSize.x, spriteSize.y, fAngle, center, scale ));
+}
+
+void olc::WarpPlan::Clear() {
+    pData.reset();
+}
+
+// Renders the UV map using the texels of tex, clipped to the columns [nClipLeft, nClipRight]
+static void RenderUVMap( olc::PixelGameEngine *gfx, const UVMap &map, const WarpTexture &tex, int nClipLeft, int nClipRight, WarpShade enShade, const ShadeParams &sp ) {
+    SpanWriter sw( gfx );
+    olc::vi2d ClipUL = { std::max( sw.ClipUL.x, nClipLeft  ), sw.ClipUL.y };
+    olc::vi2d ClipLR = { std::min( sw.ClipLR.x, nClipRight ), sw.ClipLR.y };
+    if (ClipUL.x > ClipLR.x || ClipUL.y > ClipLR.y) {
+        return;
+    }
+#ifdef WARP_STATS
+    // the pixels of the (clipped) bounding box that the map doesn't hold were found to be outside the quad when it was
+    // baked. The map holds all pixels of the box within the clipping range (see UVMapCoversClip())
+    {
+        olc::vi2d BoxUL = ClipUL.max( map.ClipUL );
+        olc::vi2d BoxLR = ClipLR.min( map.ClipLR );
+        int64_t nOutside = (BoxUL.x > BoxLR.x || BoxUL.y > BoxLR.y) ? 0 : int64_t( BoxLR.x - BoxUL.x + 1 ) * (BoxLR.y - BoxUL.y + 1);
+        for (const UVRun &run : map.vRuns) {
+            if (run.y >= ClipUL.y && run.y <= ClipLR.y) {
+                nOutside -= std::max( 0, std::min( run.x + run.nCount - 1, ClipLR.x ) - std::max( run.x, ClipUL.x ) + 1 );
+            }
+        }
+        WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, nOutside );
+    }
+#endif
+    DispatchPixelWriter( sw, enShade, sp, [&]( auto DrawPixel ) {
+        // renders the runs [nFirst, nLast)
+        auto RenderRuns = [&]( size_t nFirst, size_t nLast ) {
+            for (size_t r = nFirst; r < nLast; r++) {
+                const UVRun &run = map.vRuns[r];
+                if (run.y < ClipUL.y || run.y > ClipLR.y) {
+                    continue;
+                }
+                int x_strt = std::max( run.x, ClipUL.x );
+                int x_stop = std::min( run.x + run.nCount - 1, ClipLR.x );
+                WARP_STATS_ADD( WARP_STAT_TESTED , std::max( 0, x_stop - x_strt + 1 ));
+                WARP_STATS_ADD( WARP_STAT_COVERED, std::max( 0, x_stop - x_strt + 1 ));
+                WARP_STATS_ADD( WARP_STAT_TEXELS , std::max( 0, x_stop - x_strt + 1 ));
+                const int16_t *pCoords = map.vTexels.data() + 2 * (run.nOffset + x_strt - run.x);
+                for (int x = x_strt; x <= x_stop; x++, pCoords += 2) {
+                    DrawPixel( x, run.y, tex.pTexels[pCoords[1] * tex.nStride + pCoords[0]] );
+                }
+            }
+        };
+        // split the runs in chunks for the thread pool, if it's worth it
+        size_t nRuns = map.vRuns.size();
+        int nChunks = warpThreadPool.Size() * 4;
+        if (!sw.IsThreadSafe() || nChunks <= 4 || map.vTexels.size() / 2 < PARALLEL_MIN_PIXELS) {
+            RenderRuns( 0, nRuns );
+        } else {
+            warpThreadPool.ParallelFor( nChunks, [&]( int nChunk ) {
+                RenderRuns( nRuns * nChunk / nChunks, nRuns * (nChunk + 1) / nChunks );
+            });
+        }
+    });
+}
+
+// Returns whether the UV map holds all pixels of the quad that are within the current draw target and the columns
+// [nClipLeft, nClipRight]. The map only holds the pixels that were within the draw target at the time of baking, so
+// after a switch to a larger (or other) draw target, or with a smaller one that is partly off the baked area, it can't
+// be used.
+static bool UVMapCoversClip( olc::PixelGameEngine *gfx, const olc::WarpPlanData &data, const UVMap &map, int nClipLeft, int nClipRight ) {
+    SpanWriter sw( gfx );
+    olc::vi2d ClipUL = { std::max( { sw.ClipUL.x, nClipLeft , data.ws.UpperLeft.x  } ), std::max( sw.ClipUL.y, data.ws.UpperLeft.y  ) };
+    olc::vi2d ClipLR = { std::min( { sw.ClipLR.x, nClipRight, data.ws.LowerRight.x } ), std::min( sw.ClipLR.y, data.ws.LowerRight.y ) };
+    if (ClipUL.x > ClipLR.x || ClipUL.y > ClipLR.y) {
+        return true;    // nothing to draw
+    }
+    return ClipUL.x >= map.ClipUL.x && ClipUL.y >= map.ClipUL.y && ClipLR.x <= map.ClipLR.x && ClipLR.y <= map.ClipLR.y;
+}
+
+// Renders the plan with the texels of tex - from the UV map if there is one that fits, otherwise with the regular renderers
+static void RenderPlan( olc::PixelGameEngine *gfx, const olc::WarpPlanData &data, const WarpTexture &tex, int nClipLeft, int nClipRight, WarpShade enShade, const ShadeParams &sp ) {
+    const UVMap *pMap = data.pUVMap.get();
+    // the map holds the texels the nearest sampler reads from the sprite itself, so it can't be used for other samplers or for mip mapping
+    if (pMap != nullptr && tex.pTexels != nullptr && tex.nWidth == pMap->spriteSize.x && tex.nHeight == pMap->spriteSize.y &&
+        enWarpSampler == olc::WarpSampler::NEAREST && (tex.pCache == nullptr || !tex.pCache->bMips) &&
+        UVMapCoversClip( gfx, data, *pMap, nClipLeft, nClipRight )) {
+        WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+        CountQuadBox( gfx, data.ws.UpperLeft, data.ws.LowerRight, nClipLeft, nClipRight );
+        RenderUVMap( gfx, *pMap, tex, nClipLeft, nClipRight, enShade, sp );
+    } else {
+        RenderQuad( gfx, data.ws, tex, nClipLeft, nClipRight, enShade, sp );
+    }
+}
+
+void olc::WarpPlan::Draw( PixelGameEngine *gfx, olc::Sprite *pSprite ) const {
+    WARP_STATS_ENTRY( PLAN_DRAW );
+    if (pData != nullptr) {
+        std::shared_ptr<TextureCache> pCache;
+        RenderPlan( gfx, *pData, GetCachedTexture( pSprite, pCache ), INT_MIN, INT_MAX, WarpShade::NONE, ShadeParams() );
+    }
+}
+
+void olc::WarpPlan::DrawClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, int nClipLeft, int nClipRight, float fShadeFactor ) const {
+    WARP_STATS_ENTRY( PLAN_DRAW );
+    if (pData != nullptr) {
+        ShadeParams sp;
+        sp.SetConstant( fShadeFactor );
+        std::shared_ptr<TextureCache> pCache;
+        RenderPlan( gfx, *pData, GetCachedTexture( pSprite, pCache ), nClipLeft, nClipRight, (fShadeFactor == 1.0f) ? WarpShade::NONE : WarpShade::CONSTANT, sp );
+    }
+}
+
+void olc::WarpPlan::DrawPartial( PixelGameEngine *gfx, olc::Sprite *pSprite, const olc::vf2d& source_pos, const olc::vf2d& source_size ) const {
+    WARP_STATS_ENTRY( PLAN_DRAW );
+    if (pData != nullptr) {
+        WithPartialTexture( pSprite, source_pos, source_size, [&]( const WarpTexture &tex ) {
+            RenderPlan( gfx, *pData, tex, INT_MIN, INT_MAX, WarpShade::NONE, ShadeParams() );
+        });
+    }
+}
+
+// Bakes the UV map by rendering the plan with a texture in which each texel holds its own coordinates
+void olc::WarpPlan::BakeUVMap( PixelGameEngine *gfx, const olc::vi2d &spriteSize ) {
+    if (pData == nullptr) {
+        return;
+    }
+    pData->pUVMap.reset();
+    // the texel coordinates are stored as int16's
+    if (spriteSize.x <= 0 || spriteSize.y <= 0 || spriteSize.x > 32767 || spriteSize.y > 32767) {
+        return;
+    }
+    std::vector<olc::Pixel> vCoords( size_t( spriteSize.x ) * spriteSize.y );
+    for (int y = 0; y < spriteSize.y; y++) {
+        for (int x = 0; x < spriteSize.x; x++) {
+            vCoords[size_t( y ) * spriteSize.x + x] = olc::Pixel( uint32_t( y << 16 ) | uint32_t( x ));
+        }
+    }
+    WarpTexture tex;
+    tex.pTexels = vCoords.data();
+    tex.nWidth  = spriteSize.x;
+    tex.nHeight = spriteSize.y;
+    tex.nStride = spriteSize.x;
+
+    std::unique_ptr<UVMap> pMap( new UVMap );
+    pMap->spriteSize = spriteSize;
+    // the renderers produce the pixels row by row, and left to right within a row, so the runs can be collected on the fly
+    auto AddPixel = [&]( int x, int y, const olc::Pixel &pix ) {
+        UVRun *pLast = pMap->vRuns.empty() ? nullptr : &pMap->vRuns.back();
+        if (pLast != nullptr && pLast->y == y && pLast->x + pLast->nCount == x) {
+            pLast->nCount += 1;
+        } else {
+            pMap->vRuns.push_back( { y, x, 1, int( pMap->vTexels.size() / 2 ) } );
+        }
+        pMap->vTexels.push_back( int16_t( pix.n & 0xFFFF ));
+        pMap->vTexels.push_back( int16_t( pix.n >> 16 ));
+    };
+    SpanWriter sw( gfx );
+    pMap->ClipUL = { std::max( sw.ClipUL.x, pData->ws.UpperLeft.x  ), std::max( sw.ClipUL.y, pData->ws.UpperLeft.y  ) };
+    pMap->ClipLR = { std::min( sw.ClipLR.x, pData->ws.LowerRight.x ), std::min( sw.ClipLR.y, pData->ws.LowerRight.y ) };
+    RenderWarp<olc::WarpSampler::NEAREST>( pData->ws, sw.ClipUL, sw.ClipLR, tex, enWarpPrecision, AddPixel );
+    pMap->vRuns.shrink_to_fit();
+    pMap->vTexels.shrink_to_fit();
+    pData->pUVMap = std::move( pMap );
+}
+
+void olc::WarpPlan::InvalidateUVMap() {
+    if (pData != nullptr) {
+        pData->pUVMap.reset();
+    }
+}
+
+olc::WarpUVMapReport olc::WarpPlan::GetUVMapReport() const {
+    WarpUVMapReport report;
+    if (pData != nullptr && pData->pUVMap != nullptr) {
+        const UVMap &map = *pData->pUVMap;
+        report.bBaked  = true;
+        report.nPixels = int( map.vTexels.size() / 2 );
+        report.nRuns   = int( map.vRuns.size() );
+        report.nBytes  = sizeof( UVMap ) + map.vRuns.capacity() * sizeof( UVRun ) + map.vTexels.capacity() * sizeof( int16_t );
+    }
+    return report;
+}
+
+// Batched drawing
+// ---------------
+// The batch records the quads, and draws them all at once. Drawing works out the per quad constants, and bins the
+// quads (in submission order) into screen tiles of TILE_SIZE x TILE_SIZE pixels. The tiles are rendered in parallel
+// on the thread pool, and within a tile the quads are rendered in submission order. Since each pixel belongs to
+// exactly one tile, the result is the same as drawing the quads one after another.
+
+#define TILE_SIZE   64
+
+void olc::WarpedSpriteBatch::Clear() {
+    vItems.clear();
+}
+
+void olc::WarpedSpriteBatch::AddWarped( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints ) {
+    BatchItem item;
+    item.pSprite = pSprite;
+    item.points  = ToDoublePoints( cornerPoints );
+    vItems.push_back( item );
+}
+
+void olc::WarpedSpriteBatch::AddWarpedRotated( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint ) {
+    BatchItem item;
+    item.pSprite = pSprite;
+    item.points  = ToDoublePoints( cornerPoints );
+    RotateQuadPoints( item.points, double( fAngle ), centerPoint );
+    // rotation preserves parallelograms, so if the input quad is one, the affine path can be used
+    olc::vf2d b3 = cornerPoints[1] - cornerPoints[2] - cornerPoints[0] + cornerPoints[3];
+    item.bAffine = (b3.x == 0.0f && b3.y == 0.0f);
+    if (!item.bAffine) {
+        // DrawWarpedRotatedSprite() passes the rotated points as floats, so round them the same way
+        for (int i = 0; i < 4; i++) {
+            item.points[i] = olc::vd2d( olc::vf2d( item.points[i] ));
+        }
+    }
+    vItems.push_back( item );
+}
+
+void olc::WarpedSpriteBatch::AddRotated( olc::Sprite *pSprite, const olc::vf2d& pos, const float fAngle, const olc::vf2d& center, const olc::vf2d& scale ) {
+    BatchItem item;
+    item.pSprite = pSprite;
+    item.points  = GetRotatedSpritePoints( pos, pSprite->width, pSprite->height, fAngle, center, scale );
+    item.bAffine = true;
+    vItems.push_back( item );
+}
+
+// Sets up item to render the part of pSprite at source_pos with size source_size. The part is sampled in place, unless
+// it sticks out of the sprite. In that case it is duplicated once, and the duplicate is owned by the batch.
+static void SetPartialItemSource( olc::Sprite *pSprite, const olc::vi2d &source_pos, const olc::vi2d &source_size, olc::Sprite *&pItemSprite, std::shared_ptr<olc::Sprite> &pPartial, olc::vi2d &itemPos, olc::vi2d &itemSize, bool &bPartial ) {
+    WarpTexture tex;
+    if (GetPartialTexture( pSprite, source_pos, source_size, tex )) {
+        pItemSprite = pSprite;
+        itemPos     = source_pos;
+        itemSize    = source_size;
+        bPartial    = true;
+    } else if (pSprite != nullptr) {
+        pPartial    = std::shared_ptr<olc::Sprite>( pSprite->Duplicate( source_pos, source_size ));
+        pItemSprite = pPartial.get();
+    }
+}
+
+void olc::WarpedSpriteBatch::AddPartialRotated( olc::Sprite *pSprite, const olc::vf2d& pos, const float fAngle, const olc::vf2d& center, const olc::vf2d& source_pos, const olc::vf2d& source_size, const olc::vf2d& scale ) {
+    BatchItem item;
+    SetPartialItemSource( pSprite, source_pos, source_size, item.pSprite, item.pPartial, item.source_pos, item.source_size, item.bPartial );
+    // note that the size of the whole sprite is used for the quad, not the size of the part
+    item.points   = GetRotatedSpritePoints( pos, pSprite->width, pSprite->height, fAngle, center, scale );
+    item.bAffine  = true;
+    vItems.push_back( item );
+}
+
+void olc::WarpedSpriteBatch::AddPartialWarped( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size ) {
+    BatchItem item;
+    SetPartialItemSource( pSprite, source_pos, source_size, item.pSprite, item.pPartial, item.source_pos, item.source_size, item.bPartial );
+    item.points   = ToDoublePoints( cornerPoints );
+    vItems.push_back( item );
+}
+
+void olc::WarpedSpriteBatch::AddPlan( olc::Sprite *pSprite, const olc::WarpPlan &plan ) {
+    BatchItem item;
+    item.pSprite = pSprite;
+    item.pPlan   = plan.pData;
+    if (item.pPlan != nullptr) {
+        vItems.push_back( item );
+    }
+}
+
+void olc::WarpedSpriteBatch::Draw( PixelGameEngine *gfx ) {
+    WARP_STATS_ENTRY( BATCH_DRAW );
+    SpanWriter sw( gfx );
+    if (vItems.empty() || sw.ClipUL.x > sw.ClipLR.x || sw.ClipUL.y > sw.ClipLR.y) {
+        return;
+    }
+    // work out the per quad constants and the textures once
+    std::vector<WarpSetup>   vSetups( vItems.size() );
+    std::vector<WarpTexture> vTextures( vItems.size() );
+    std::vector<std::shared_ptr<TextureCache>> vCaches( vItems.size() );
+    for (size_t i = 0; i < vItems.size(); i++) {
+        if (vItems[i].bPartial) {
+            GetPartialTexture( vItems[i].pSprite, vItems[i].source_pos, vItems[i].source_size, vTextures[i] );
+        } else {
+            vTextures[i] = GetCachedTexture( vItems[i].pSprite, vCaches[i] );
+            if (sw.mode == olc::Pixel::MASK) {
+                vTextures[i] = WithOpacityIndex( vTextures[i] );
+            }
+        }
+        if (vItems[i].pPlan != nullptr) {
+            // the per quad constants of a plan are ready to use
+            vSetups[i] = vItems[i].pPlan->ws;
+            continue;
+        }
+        std::array<olc::vd2d, 4> &points = vItems[i].points;
+        if (vItems[i].bAffine) {
+            // make the quad an exact parallelogram, as in DrawAffineSprite()
+            points[3] = points[0] + points[2] - points[1];
+        }
+        SetupWarp( points, vSetups[i] );
+        vSetups[i].bAffine |= vItems[i].bAffine;
+    }
+    // bin the quads into the tiles they overlap, in submission order
+    int nTilesX = (sw.ClipLR.x - sw.ClipUL.x) / TILE_SIZE + 1;
+    int nTilesY = (sw.ClipLR.y - sw.ClipUL.y) / TILE_SIZE + 1;
+    std::vector<std::vector<int>> vTiles( nTilesX * nTilesY );
+    for (size_t i = 0; i < vSetups.size(); i++) {
+        olc::vi2d UL = vSetups[i].UpperLeft.max( sw.ClipUL );
+        olc::vi2d LR = vSetups[i].LowerRight.min( sw.ClipLR );
+        if (UL.x > LR.x || UL.y > LR.y || vTextures[i].pTexels == nullptr) {
+            continue;
+        }
+        CountQuadBox( vSetups[i].UpperLeft, vSetups[i].LowerRight, sw.ClipUL, sw.ClipLR );
+        for (int ty = (UL.y - sw.ClipUL.y) / TILE_SIZE; ty <= (LR.y - sw.ClipUL.y) / TILE_SIZE; ty++) {
+            for (int tx = (UL.x - sw.ClipUL.x) / TILE_SIZE; tx <= (LR.x - sw.ClipUL.x) / TILE_SIZE; tx++) {
+                vTiles[ty * nTilesX + tx].push_back( int( i ));
+            }
+        }
+    }
+    // collect the non empty tiles
+    std::vector<int> vActiveTiles;
+    for (int t = 0; t < int( vTiles.size() ); t++) {
+        if (!vTiles[t].empty()) {
+            vActiveTiles.push_back( t );
+        }
+    }
+    // the pixel writer, sampler and precision are picked once for the whole batch
+    WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+    olc::WarpPrecision precision = enWarpPrecision;
+    DispatchPixelWriter( sw, WarpShade::NONE, ShadeParams(), [&]( auto DrawPixel ) {
+        // renders all quads of one tile, in submission order
+        auto RenderTile = [&]( int nActive ) {
+            int t = vActiveTiles[nActive];
+            olc::vi2d TileUL = sw.ClipUL + olc::vi2d( t % nTilesX, t / nTilesX ) * TILE_SIZE;
+            olc::vi2d TileLR = (TileUL + olc::vi2d( TILE_SIZE - 1, TILE_SIZE - 1 )).min( sw.ClipLR );
+            for (int i : vTiles[t]) {
+                if (enWarpSampler == olc::WarpSampler::BILINEAR) {
+                    RenderWarp<olc::WarpSampler::BILINEAR>( vSetups[i], TileUL, TileLR, vTextures[i], precision, DrawPixel );
+                } else {
+                    RenderWarp<olc::WarpSampler::NEAREST >( vSetups[i], TileUL, TileLR, vTextures[i], precision, DrawPixel );
+                }
+            }
+        };
+        if (sw.IsThreadSafe()) {
+            warpThreadPool.ParallelFor( int( vActiveTiles.size() ), RenderTile );
+        } else {
+            for (int i = 0; i < int( vActiveTiles.size() ); i++) {
+                RenderTile( i );
+            }
+        }
+    });
+}
+
+// Column renderer
+// ---------------
+// The items are sorted front to back (on their nearest depth), and the screen is split in strips of STRIP_WIDTH columns
+// that are rendered in parallel. Within a strip, each item works out its depth per column, and checks the depth buffer
+// over the rows the quad spans in that column. Columns where everything is nearer already are skipped, and the remaining
+// runs of columns are rendered row by row, with a depth test per pixel. Since the strips don't overlap, the result
+// doesn't depend on the nr of threads.
+
+#define STRIP_WIDTH         16
+#define SHADE_LEVELS        64
+
+void olc::WarpColumnRenderer::Clear() {
+    vItems.clear();
+}
+
+void olc::WarpColumnRenderer::AddWall( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fDepthLeft, float fDepthRight ) {
+    if (pSprite == nullptr || fDepthLeft <= 0.0f || fDepthRight <= 0.0f) {
+        return;
+    }
+    ColumnItem item;
+    item.pSprite        = pSprite;
+    item.points         = ToDoublePoints( cornerPoints );
+    item.nClipLeft      = nClipLeft;
+    item.nClipRight     = nClipRight;
+    item.bOpaque        = true;
+    item.fInvDepthLeft  = 1.0f / fDepthLeft;
+    item.fInvDepthRight = 1.0f / fDepthRight;
+    vItems.push_back( item );
+}
+
+void olc::WarpColumnRenderer::AddBillboard( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fDepth ) {
+    if (pSprite == nullptr || fDepth <= 0.0f) {
+        return;
+    }
+    ColumnItem item;
+    item.pSprite        = pSprite;
+    item.points         = ToDoublePoints( cornerPoints );
+    item.nClipLeft      = nClipLeft;
+    item.nClipRight     = nClipRight;
+    item.bOpaque        = false;
+    item.fInvDepthLeft  = 1.0f / fDepth;
+    item.fInvDepthRight = 1.0f / fDepth;
+    vItems.push_back( item );
+}
+
+// The shade table holds SHADE_LEVELS rows of 256 entries, one for each channel value. Level l is for depth
+// l / (SHADE_LEVELS - 1) * fMaxDepth
+void olc::WarpColumnRenderer::SetDepthShading( float fMaxDepth, float fMinShade ) {
+    fShadeMaxDepth = fMaxDepth;
+    vShadeTable.clear();
+    if (fMaxDepth <= 0.0f) {
+        return;
+    }
+    vShadeTable.resize( SHADE_LEVELS * 256 );
+    for (int l = 0; l < SHADE_LEVELS; l++) {
+        float fShade = std::max( fMinShade, 1.0f - float( l ) / float( SHADE_LEVELS - 1 ));
+        for (int i = 0; i < 256; i++) {
+            vShadeTable[l * 256 + i] = uint8_t( std::min( 255.0f, std::max( 0.0f, float( i ) * fShade )));
+        }
+    }
+}
+
+void olc::WarpColumnRenderer::Draw( PixelGameEngine *gfx ) {
+    WARP_STATS_ENTRY( COLUMN_DRAW );
+    WARP_STATS_PHASE( WARP_STAT_RENDER_NS );
+    SpanWriter sw( gfx );
+    if (vItems.empty() || sw.ClipUL.x > sw.ClipLR.x || sw.ClipUL.y > sw.ClipLR.y) {
+        return;
+    }
+    int nW = sw.ClipLR.x + 1;
+    int nH = sw.ClipLR.y + 1;
+    vDepthBuffer.assign( size_t( nW ) * nH, FLT_MAX );
+    // the strips are rendered on the thread pool, so the precision is picked here
+    olc::WarpPrecision precision = enWarpPrecision;
+
+    // work out the per quad constants and the textures once. For the vertical extent of a quad per column, the
+    // scanline span function is used on the quad with x and y swapped
+    size_t nItems = vItems.size();
+    std::vector<WarpSetup>   vSetups( nItems );
+    std::vector<WarpTexture> vTextures( nItems );
+    std::vector<std::shared_ptr<TextureCache>> vCaches( nItems );
+    std::vector<std::array<olc::vd2d, 4>> vSwapped( nItems );
+    std::vector<int> vOrder( nItems );
+    for (size_t i = 0; i < nItems; i++) {
+        SetupWarp( vItems[i].points, vSetups[i] );
+        CountQuadBox( vSetups[i].UpperLeft, vSetups[i].LowerRight, { std::max( 0, vItems[i].nClipLeft ), 0 }, { std::min( nW - 1, vItems[i].nClipRight ), nH - 1 } );
+        vTextures[i] = GetCachedTexture( vItems[i].pSprite, vCaches[i] );
+        // billboards don't draw their transparent texels, so these parts can be skipped
+        if (!vItems[i].bOpaque) {
+            vTextures[i] = WithOpacityIndex( vTextures[i] );
+        }
+        for (int j = 0; j < 4; j++) {
+            vSwapped[i][j] = { vItems[i].points[j].y, vItems[i].points[j].x };
+        }
+        vOrder[i] = int( i );
+    }
+    // front to back, on the nearest depth (i.e. the largest 1 / depth) of each item
+    std::stable_sort( vOrder.begin(), vOrder.end(), [&]( int a, int b ) {
+        return std::max( vItems[a].fInvDepthLeft, vItems[a].fInvDepthRight ) > std::max( vItems[b].fInvDepthLeft, vItems[b].fInvDepthRight );
+    });
+    const uint8_t *pShade = vShadeTable.empty() ? nullptr : vShadeTable.data();
+    float fLevelScale = pShade ? float( SHADE_LEVELS - 1 ) / fShadeMaxDepth : 0.0f;
+    float *pDepth = vDepthBuffer.data();
+
+    // per column, the longest run of rows that is known to be drawn with a depth of at most vSolidDepth. Items that
+    // lie behind it in a column, within these rows, are rejected without looking at the depth buffer
+    std::vector<int>   vSolidTop( nW, 0 ), vSolidBottom( nW, -1 );
+    std::vector<float> vSolidDepth( nW, 0.0f );
+
+    auto RenderStrip = [&]( int nStrip ) {
+        int nStripLeft  = nStrip * STRIP_WIDTH;
+        int nStripRight = std::min( nStripLeft + STRIP_WIDTH - 1, nW - 1 );
+        float   aDepth[STRIP_WIDTH];        // depth of the current item per column of the strip
+        const uint8_t *aShade[STRIP_WIDTH]; // and its shade table row
+        int     aTop[STRIP_WIDTH], aBottom[STRIP_WIDTH];  // and the rows the quad spans in the column
+        bool    aVisible[STRIP_WIDTH];
+        int     aMinY[STRIP_WIDTH], aMaxY[STRIP_WIDTH], aCount[STRIP_WIDTH];  // the rows drawn or found hidden per column
+        for (int i : vOrder) {
+            const ColumnItem &item = vItems[i];
+            const WarpSetup  &ws   = vSetups[i];
+            int nLeft  = std::max( { nStripLeft , ws.UpperLeft.x , item.nClipLeft  } );
+            int nRight = std::min( { nStripRight, ws.LowerRight.x, item.nClipRight } );
+            if (nLeft > nRight || vTextures[i].pTexels == nullptr) {
+                continue;
+            }
+            // work out the depth and the vertical extent per column, and reject the columns that are behind the solid run
+            int nBoxWidth = ws.LowerRight.x - ws.UpperLeft.x;
+            int nBoxRows  = std::min( ws.LowerRight.y, nH - 1 ) - std::max( ws.UpperLeft.y, 0 ) + 1;
+            (void)nBoxRows;     // only used for the instrumentation
+            int nTop = INT_MAX, nBottom = INT_MIN;
+            int nUnresolved = 0;       // the candidate columns that are not known to be visible yet
+            for (int x = nLeft; x <= nRight; x++) {
+                int c = x - nStripLeft;
+                float fT = (nBoxWidth > 0) ? float( x - ws.UpperLeft.x ) / float( nBoxWidth ) : 0.0f;
+                aDepth[c] = 1.0f / (item.fInvDepthLeft + (item.fInvDepthRight - item.fInvDepthLeft) * fT);
+                if (pShade != nullptr) {
+                    aShade[c] = pShade + 256 * int( std::min( float( SHADE_LEVELS - 1 ), aDepth[c] * fLevelScale + 0.5f ));
+                }
+                aVisible[c] = false;
+                aMinY[c]    = INT_MAX;
+                aMaxY[c]    = INT_MIN;
+                aCount[c]   = 0;
+                if (!olc::GetQuadScanlineSpan( vSwapped[i], x, 0, nH - 1, aTop[c], aBottom[c] )) {
+                    aTop[c] = INT_MAX;
+                    WARP_STATS_ADD( WARP_STAT_OUT_OF_RANGE, nBoxRows );
+                } else if (aTop[c] >= vSolidTop[x] && aBottom[c] <= vSolidBottom[x] && aDepth[c] >= vSolidDepth[x]) {
+                    // the column is hidden, which counts as clipped
+                    aTop[c] = INT_MAX;
+                    WARP_STATS_ADD( WARP_STAT_CLIPPED, nBoxRows );
+                } else {
+                    nTop    = std::min( nTop   , aTop[c]    );
+                    nBottom = std::max( nBottom, aBottom[c] );
+                    nUnresolved++;
+                }
+            }
+            // then check the depth buffer row by row (so it's read in the order it's stored), until each remaining column
+            // is known to have a pixel that is nearer than what's drawn already. The columns that don't are hidden completely
+            for (int y = nTop; y <= nBottom && nUnresolved > 0; y++) {
+                const float *pRow = pDepth + size_t( y ) * nW;
+                for (int x = nLeft; x <= nRight; x++) {
+                    int c = x - nStripLeft;
+                    if (!aVisible[c] && y >= aTop[c] && y <= aBottom[c] && aDepth[c] < pRow[x]) {
+                        aVisible[c] = true;
+                        nUnresolved--;
+                    }
+                }
+            }
+#ifdef WARP_STATS
+            for (int x = nLeft; x <= nRight && nUnresolved > 0; x++) {
+                int c = x - nStripLeft;
+                if (!aVisible[c] && aTop[c] != INT_MAX) {
+                    WARP_STATS_ADD( WARP_STAT_CLIPPED, nBoxRows );
+                }
+            }
+#endif
+            // the pixel writer does the depth test, the mask test for billboards, and the shading. It also keeps track of
+            // the rows that end up at this depth or nearer, to update the solid runs of opaque items
+            auto DrawPixel = [&]( int x, int y, olc::Pixel pix ) {
+                int c = x - nStripLeft;
+                float &fDepth = pDepth[size_t( y ) * nW + x];
+                if (aDepth[c] < fDepth) {
+                    if (!item.bOpaque && pix.a != 255) {
+                        return;
+                    }
+                    fDepth = aDepth[c];
+                    if (pShade != nullptr) {
+                        pix = olc::Pixel( aShade[c][pix.r], aShade[c][pix.g], aShade[c][pix.b], pix.a );
+                    }
+                    sw.pData[size_t( y ) * nW + x] = pix;
+                    WARP_STATS_ADD( WARP_STAT_DRAWN, 1 );
+                }
+                aMinY[c] = std::min( aMinY[c], y );
+                aMaxY[c] = std::max( aMaxY[c], y );
+                aCount[c]++;
+            };
+            // render the runs of visible columns
+            for (int x = nLeft; x <= nRight; x++) {
+                if (!aVisible[x - nStripLeft]) {
+                    continue;
+                }
+                int nRunLeft = x;
+                while (x < nRight && aVisible[x + 1 - nStripLeft]) {
+                    x++;
+                }
+                olc::vi2d ClipUL = { nRunLeft, 0 };
+                olc::vi2d ClipLR = { x, nH - 1 };
+                if (enWarpSampler == olc::WarpSampler::BILINEAR) {
+                    RenderWarp<olc::WarpSampler::BILINEAR>( ws, ClipUL, ClipLR, vTextures[i], precision, DrawPixel );
+                } else {
+                    RenderWarp<olc::WarpSampler::NEAREST >( ws, ClipUL, ClipLR, vTextures[i], precision, DrawPixel );
+                }
+            }
+            // if the rows an opaque item covers in a column have no gaps, they are solid at its depth. They are merged
+            // with the solid run of the column if they touch it, otherwise the longest of both is kept
+            if (!item.bOpaque) {
+                continue;
+            }
+            for (int x = nLeft; x <= nRight; x++) {
+                int c = x - nStripLeft;
+                if (!aVisible[c] || aCount[c] != aMaxY[c] - aMinY[c] + 1) {
+                    continue;
+                }
+                int &nSolidTop    = vSolidTop[x];
+                int &nSolidBottom = vSolidBottom[x];
+                if (aMinY[c] <= nSolidBottom + 1 && aMaxY[c] >= nSolidTop - 1) {
+                    nSolidTop      = std::min( nSolidTop   , aMinY[c] );
+                    nSolidBottom   = std::max( nSolidBottom, aMaxY[c] );
+                    vSolidDepth[x] = std::max( vSolidDepth[x], aDepth[c] );
+                } else if (aMaxY[c] - aMinY[c] > nSolidBottom - nSolidTop) {
+                    nSolidTop      = aMinY[c];
+                    nSolidBottom   = aMaxY[c];
+                    vSolidDepth[x] = aDepth[c];
+                }
+            }
+        }
+    };
+    warpThreadPool.ParallelFor( (nW + STRIP_WIDTH - 1) / STRIP_WIDTH, RenderStrip );
+}
+
+// Sprite scaling
+// --------------
+// The scaled sprite is written into the pixel buffer of the destination directly, a row at a time. Rows that are the
+// same as the previous one (when upscaling) are copied with memcpy() instead of being worked out again. The rows are
+// split in bands that are scaled in parallel on the thread pool, see RenderInBands().
+
+// Makes *ppDest a sprite of nWidth x nHeight pixels, reusing it if there is one. The pixel buffer keeps its capacity,
+// so that it's only reallocated when it has to grow. The pixels are left as they are
+static olc::Sprite *PrepareScaleDest( olc::Sprite **ppDest, int nWidth, int nHeight ) {
+    if (*ppDest == nullptr) {
+        *ppDest = new olc::Sprite( nWidth, nHeight );
+    } else if ((*ppDest)->width != nWidth || (*ppDest)->height != nHeight) {
+        (*ppDest)->width  = nWidth;
+        (*ppDest)->height = nHeight;
+        (*ppDest)->pColData.resize( size_t( nWidth ) * nHeight );
+    }
+    // the old cached textures (and rotated bitmaps) don't match the new pixels
+    olc::InvalidateWarpTextureCache( *ppDest );
+    return *ppDest;
+}
+
+// Calls Scale( pSource, pDest ) with the destination prepared for nWidth x nHeight pixels. If the source is the
+// destination as well, it's scaled from a copy
+template <typename ScaleFunc>
+static void ScaleInto( const olc::Sprite *pSource, olc::Sprite **ppDest, int nWidth, int nHeight, ScaleFunc Scale ) {
+    if (pSource == nullptr || ppDest == nullptr || pSource->width <= 0 || pSource->height <= 0 || nWidth <= 0 || nHeight <= 0) {
+        return;
+    }
+    if (pSource == *ppDest) {
+        olc::Sprite copy( pSource->width, pSource->height );
+        copy.pColData = pSource->pColData;
+        Scale( &copy, PrepareScaleDest( ppDest, nWidth, nHeight ));
+    } else {
+        Scale( pSource, PrepareScaleDest( ppDest, nWidth, nHeight ));
+    }
+}
+
+// Calls ScaleRow( y, pRow ) for each row y of pDest that differs from the previous one, and copies the other rows. nSourceRow( y )
+// tells which source row(s) row y is made of - rows with the same value are the same
+template <typename SourceRowFunc, typename ScaleRowFunc>
+static void ScaleRows( olc::Sprite *pDest, SourceRowFunc nSourceRow, ScaleRowFunc ScaleRow ) {
+    int nW = pDest->width;
+    RenderInBands( { 0, 0 }, { nW - 1, pDest->height - 1 }, true, [&]( const olc::vi2d &BandUL, const olc::vi2d &BandLR ) {
+        for (int y = BandUL.y; y <= BandLR.y; y++) {
+            olc::Pixel *pRow = pDest->pColData.data() + size_t( y ) * nW;
+            if (y > BandUL.y && nSourceRow( y ) == nSourceRow( y - 1 )) {
+                memcpy( pRow, pRow - nW, size_t( nW ) * sizeof( olc::Pixel ));
+            } else {
+                ScaleRow( y, pRow );
+            }
+        }
+    });
+}
+
+void olc::UpscaleSprite( const olc::Sprite *pSource, olc::Sprite **ppDest, int nFactor ) {
+    nFactor = std::max( 1, nFactor );
+    if (pSource == nullptr) {
+        return;
+    }
+    ScaleInto( pSource, ppDest, pSource->width * nFactor, pSource->height * nFactor, [&]( const olc::Sprite *pSrc, olc::Sprite *pDst ) {
+        ScaleRows( pDst, [&]( int y ) { return y / nFactor; }, [&]( int y, olc::Pixel *pRow ) {
+            const olc::Pixel *pSrcRow = pSrc->pColData.data() + size_t( y / nFactor ) * pSrc->width;
+            if (nFactor == 1) {
+                memcpy( pRow, pSrcRow, size_t( pSrc->width ) * sizeof( olc::Pixel ));
+                return;
+            }
+            for (int x = 0; x < pSrc->width; x++) {
+                std::fill_n( pRow + x * nFactor, nFactor, pSrcRow[x] );
+            }
+        });
+    });
+}
+
+void olc::DownscaleSprite( const olc::Sprite *pSource, olc::Sprite **ppDest, int nFactor ) {
+    nFactor = std::max( 1, nFactor );
+    if (pSource == nullptr) {
+        return;
+    }
+    int nW = (pSource->width  + nFactor - 1) / nFactor;
+    int nH = (pSource->height + nFactor - 1) / nFactor;
+    ScaleInto( pSource, ppDest, nW, nH, [&]( const olc::Sprite *pSrc, olc::Sprite *pDst ) {
+        ScaleRows( pDst, [&]( int y ) { return y; }, [&]( int y, olc::Pixel *pRow ) {
+            // sum the channels of the block rows per source column first, then the block columns per pixel
+            int nRowStrt = y * nFactor;
+            int nRowStop = std::min( nRowStrt + nFactor, pSrc->height );
+            std::vector<uint32_t> vSums( 4 * size_t( pSrc->width ), 0 );
+            for (int sy = nRowStrt; sy < nRowStop; sy++) {
+                // the channels are summed as a flat array of bytes, so that the compiler can vectorise the loop
+                const uint8_t *pSrcRow = reinterpret_cast<const uint8_t *>( pSrc->pColData.data() + size_t( sy ) * pSrc->width );
+                uint32_t *pSum = vSums.data();
+                for (size_t i = 0; i < vSums.size(); i++) {
+                    pSum[i] += pSrcRow[i];
+                }
+            }
+            // the averages are rounded. Dividing by nCount is done by multiplying with its reciprocal in 24.40 fixed point,
+            // which is exact for sums up to 2^40 / nCount, i.e. for nCount < 65536 (the sums are at most 256 * nCount)
+            uint64_t nCount = 0, nRecip = 0;
+            auto Average = [&]( uint32_t nSum ) {
+                uint64_t nRounded = nSum + nCount / 2;
+                return uint8_t( (nRecip != 0) ? ((nRounded * nRecip) >> 40) : (nRounded / nCount) );
+            };
+            for (int x = 0; x < pDst->width; x++) {
+                int nColStrt = x * nFactor;
+                int nColStop = std::min( nColStrt + nFactor, pSrc->width );
+                uint32_t aSum[4] = { 0, 0, 0, 0 };
+                for (int sx = nColStrt; sx < nColStop; sx++) {
+                    for (int c = 0; c < 4; c++) {
+                        aSum[c] += vSums[4 * size_t( sx ) + c];
+                    }
+                }
+                // the blocks at the right and bottom edges may have fewer texels
+                uint64_t nBlockCount = uint64_t( nColStop - nColStrt ) * (nRowStop - nRowStrt);
+                if (nBlockCount != nCount) {
+                    nCount = nBlockCount;
+                    nRecip = (nCount < 65536) ? ((uint64_t( 1 ) << 40) + nCount - 1) / nCount : 0;
+                }
+                pRow[x] = olc::Pixel( Average( aSum[0] ), Average( aSum[1] ), Average( aSum[2] ), Average( aSum[3] ));
+            }
+        });
+    });
+}
+
+void olc::ResizeSprite( const olc::Sprite *pSource, olc::Sprite **ppDest, int nWidth, int nHeight, olc::WarpSampler sampler ) {
+    ScaleInto( pSource, ppDest, nWidth, nHeight, [&]( const olc::Sprite *pSrc, olc::Sprite *pDst ) {
+        if (sampler == olc::WarpSampler::NEAREST) {
+            // the texel that holds the origin of the pixel, per column and row
+            std::vector<int> vCols( nWidth ), vRows( nHeight );
+            for (int x = 0; x < nWidth; x++) {
+                vCols[x] = int( int64_t( x ) * pSrc->width / nWidth );
+            }
+            for (int y = 0; y < nHeight; y++) {
+                vRows[y] = int( int64_t( y ) * pSrc->height / nHeight );
+            }
+            ScaleRows( pDst, [&]( int y ) { return vRows[y]; }, [&]( int y, olc::Pixel *pRow ) {
+                const olc::Pixel *pSrcRow = pSrc->pColData.data() + size_t( vRows[y] ) * pSrc->width;
+                for (int x = 0; x < nWidth; x++) {
+                    pRow[x] = pSrcRow[vCols[x]];
+                }
+            });
+        } else {
+            // the pixel centers are mapped onto the texel centers, in 16.16 fixed point. The sampler clamps at the borders
+            std::vector<int32_t> vFx( nWidth ), vFy( nHeight );
+            for (int x = 0; x < nWidth; x++) {
+                vFx[x] = int32_t( floor( ((x + 0.5) * pSrc->width / nWidth - 0.5) * 65536.0 ));
+            }
+            for (int y = 0; y < nHeight; y++) {
+                vFy[y] = int32_t( floor( ((y + 0.5) * pSrc->height / nHeight - 0.5) * 65536.0 ));
+            }
+            WarpTexture tex = GetSpriteTexture( pSrc );
+            ScaleRows( pDst, [&]( int y ) { return vFy[y]; }, [&]( int y, olc::Pixel *pRow ) {
+                for (int x = 0; x < nWidth; x++) {
+                    pRow[x] = SampleBilinearLevel( tex, vFx[x], vFy[y] );
+                }
+            });
+        }
+    });
+}
+
+// Tiled textures
+// --------------
+// File format (all numbers are 32 bit unsigned, little endian):
+//   header - magic ("MSTX"), version, width, height, tile size, nr of levels
+//   tiles  - per level (level 0 is the image itself, each next level is half the size of the previous one, rounded
+//            down, with a minimum of 1), the tiles in row major order. Each tile holds tile size x tile size texels in
+//            row major order, as r, g, b, a bytes. The tiles on the right and bottom edges are padded with blank texels.
+// The levels are built with the same 2x2 box filter as the mip chains of the texture cache.
+
+#define TILED_TEXTURE_MAGIC      0x5854534D     // "MSTX"
+#define TILED_TEXTURE_VERSION    1
+#define TILED_HEADER_SIZE        24
+// the window of texels is kept below this size (by picking a smaller mip level if needed)
+#define TILED_MAX_WINDOW         (size_t( 8 ) << 20)
+// nr of texels the window extends beyond the texels that the visible pixels map to
+#define TILED_WINDOW_MARGIN      2
+
+struct TiledLevel {
+    int nWidth = 0, nHeight = 0;
+    int nTilesX = 0, nTilesY = 0;
+    std::streamoff nOffset = 0;     // position of the first tile in the file
+};
+
+struct TiledTile {
+    uint64_t nKey;
+    std::vector<olc::Pixel> vTexels;
+};
+
+struct olc::TiledTextureData {
+    std::ifstream file;
+    int nWidth = 0, nHeight = 0;
+    int nTileSize = 0;
+    std::vector<TiledLevel> vLevels;
+    // the tile cache, most recently used first
+    size_t nBudget = 0;
+    std::list<TiledTile> lstTiles;
+    std::unordered_map<uint64_t, std::list<TiledTile>::iterator> mapTiles;
+    olc::TiledTextureReport report;
+    // the window of the last draw, which is reused if the next draw needs the same texels
+    std::vector<olc::Pixel> vWindow;
+    int nWindowLevel = -1;
+    olc::vi2d windowUL, windowSize;
+};
+
+// works out the sizes and the positions in the file of the levels
+static std::vector<TiledLevel> GetTiledLevels( int nWidth, int nHeight, int nTileSize ) {
+    std::vector<TiledLevel> vLevels;
+    std::streamoff nOffset = TILED_HEADER_SIZE;
+    olc::vi2d size = { nWidth, nHeight };
+    for (;;) {
+        TiledLevel level;
+        level.nWidth  = size.x;
+        level.nHeight = size.y;
+        level.nTilesX = (size.x + nTileSize - 1) / nTileSize;
+        level.nTilesY = (size.y + nTileSize - 1) / nTileSize;
+        level.nOffset = nOffset;
+        nOffset += std::streamoff( level.nTilesX ) * level.nTilesY * nTileSize * nTileSize * 4;
+        vLevels.push_back( level );
+        if (size.x == 1 && size.y == 1) {
+            return vLevels;
+        }
+        size = { std::max( 1, size.x / 2 ), std::max( 1, size.y / 2 ) };
+    }
+}
+
+static void WriteUint32( std::ofstream &file, uint32_t n ) {
+    uint8_t a[4] = { uint8_t( n ), uint8_t( n >> 8 ), uint8_t( n >> 16 ), uint8_t( n >> 24 ) };
+    file.write( reinterpret_cast<const char *>( a ), 4 );
+}
+
+static uint32_t ReadUint32( std::ifstream &file ) {
+    uint8_t a[4] = { 0, 0, 0, 0 };
+    file.read( reinterpret_cast<char *>( a ), 4 );
+    return uint32_t( a[0] ) | (uint32_t( a[1] ) << 8) | (uint32_t( a[2] ) << 16) | (uint32_t( a[3] ) << 24);
+}
+
+bool olc::WriteTiledTexture( const olc::Sprite *pSprite, const std::string &sFileName, int nTileSize ) {
+    if (pSprite == nullptr || pSprite->width <= 0 || pSprite->height <= 0 || nTileSize <= 0) {
+        return false;
+    }
+    std::ofstream file( sFileName, std::ios::binary );
+    if (!file) {
+        return false;
+    }
+    std::vector<TiledLevel> vLevels = GetTiledLevels( pSprite->width, pSprite->height, nTileSize );
+    WriteUint32( file, TILED_TEXTURE_MAGIC );
+    WriteUint32( file, TILED_TEXTURE_VERSION );
+    WriteUint32( file, uint32_t( pSprite->width  ));
+    WriteUint32( file, uint32_t( pSprite->height ));
+    WriteUint32( file, uint32_t( nTileSize ));
+    WriteUint32( file, uint32_t( vLevels.size() ));
+    // only the current level and the next one are kept in memory
+    WarpTexture level = GetSpriteTexture( pSprite );
+    std::vector<olc::Pixel> vLevelData, vNextData;
+    std::vector<olc::Pixel> vTile( size_t( nTileSize ) * nTileSize );
+    for (size_t l = 0; l < vLevels.size(); l++) {
+        for (int ty = 0; ty < vLevels[l].nTilesY; ty++) {
+            for (int tx = 0; tx < vLevels[l].nTilesX; tx++) {
+                std::fill( vTile.begin(), vTile.end(), olc::BLANK );
+                int nCols = std::min( nTileSize, level.nWidth  - tx * nTileSize );
+                int nRows = std::min( nTileSize, level.nHeight - ty * nTileSize );
+                for (int r = 0; r < nRows; r++) {
+                    const olc::Pixel *pRow = level.pTexels + size_t( ty * nTileSize + r ) * level.nStride + tx * nTileSize;
+                    std::copy( pRow, pRow + nCols, vTile.begin() + size_t( r ) * nTileSize );
+                }
+                // olc::Pixel holds the channels as r, g, b, a bytes
+                file.write( reinterpret_cast<const char *>( vTile.data() ), std::streamsize( vTile.size() * sizeof( olc::Pixel )));
+            }
+        }
+        if (l + 1 < vLevels.size()) {
+            BuildMipLevel( level, vLevels[l + 1].nWidth, vLevels[l + 1].nHeight, vNextData );
+            vLevelData.swap( vNextData );
+            level.pTexels = vLevelData.data();
+            level.nWidth  = vLevels[l + 1].nWidth;
+            level.nHeight = vLevels[l + 1].nHeight;
+            level.nStride = vLevels[l + 1].nWidth;
+        }
+    }
+    return bool( file );
+}
+
+bool olc::TiledTextureSource::Open( const std::string &sFileName, size_t nCacheBytes ) {
+    Close();
+    std::shared_ptr<TiledTextureData> pNew = std::make_shared<TiledTextureData>();
+    pNew->file.open( sFileName, std::ios::binary );
+    if (!pNew->file) {
+        return false;
+    }
+    uint32_t nMagic   = ReadUint32( pNew->file );
+    uint32_t nVersion = ReadUint32( pNew->file );
+    uint32_t nWidth   = ReadUint32( pNew->file );
+    uint32_t nHeight  = ReadUint32( pNew->file );
+    uint32_t nTile    = ReadUint32( pNew->file );
+    uint32_t nLevels  = ReadUint32( pNew->file );
+    if (!pNew->file || nMagic != TILED_TEXTURE_MAGIC || nVersion != TILED_TEXTURE_VERSION ||
+        nWidth == 0 || nWidth > INT_MAX || nHeight == 0 || nHeight > INT_MAX || nTile == 0 || nTile > 4096) {
+        return false;
+    }
+    pNew->nWidth    = int( nWidth );
+    pNew->nHeight   = int( nHeight );
+    pNew->nTileSize = int( nTile );
+    pNew->vLevels   = GetTiledLevels( pNew->nWidth, pNew->nHeight, pNew->nTileSize );
+    pNew->nBudget   = nCacheBytes;
+    if (nLevels != pNew->vLevels.size()) {
+        return false;
+    }
+    pData = pNew;
+    return true;
+}
+
+void olc::TiledTextureSource::Close() {
+    pData.reset();
+}
+
+int olc::TiledTextureSource::GetWidth() const {
+    return pData ? pData->nWidth : 0;
+}
+
+int olc::TiledTextureSource::GetHeight() const {
+    return pData ? pData->nHeight : 0;
+}
+
+int olc::TiledTextureSource::GetLevels() const {
+    return pData ? int( pData->vLevels.size() ) : 0;
+}
+
+olc::TiledTextureReport olc::TiledTextureSource::GetReport() const {
+    return pData ? pData->report : olc::TiledTextureReport();
+}
+
+// Returns the texels of the tile, reading it from the file if it's not in the cache. The pointer is valid until the
+// next call. Returns nullptr if the tile can't be read
+static const olc::Pixel *GetTile( olc::TiledTextureData &data, int nLevel, int tx, int ty ) {
+    uint64_t nKey = (uint64_t( nLevel ) << 48) | (uint64_t( ty ) << 24) | uint64_t( tx );
+    auto iter = data.mapTiles.find( nKey );
+    if (iter != data.mapTiles.end()) {
+        // move the tile to the front of the LRU order
+        data.lstTiles.splice( data.lstTiles.begin(), data.lstTiles, iter->second );
+        data.report.nTileHits++;
+        return iter->second->vTexels.data();
+    }
+    const TiledLevel &level = data.vLevels[nLevel];
+    size_t nTexels = size_t( data.nTileSize ) * data.nTileSize;
+    TiledTile tile;
+    tile.nKey = nKey;
+    tile.vTexels.resize( nTexels );
+    data.file.clear();
+    data.file.seekg( level.nOffset + (std::streamoff( ty ) * level.nTilesX + tx) * std::streamoff( nTexels * sizeof( olc::Pixel )));
+    data.file.read( reinterpret_cast<char *>( tile.vTexels.data() ), std::streamsize( nTexels * sizeof( olc::Pixel )));
+    if (!data.file) {
+        return nullptr;
+    }
+    data.report.nTileReads++;
+    // make room for the tile, but always keep it (even if it's larger than the budget)
+    size_t nTileBytes = nTexels * sizeof( olc::Pixel );
+    while (!data.lstTiles.empty() && data.report.nTileBytes + nTileBytes > data.nBudget) {
+        data.report.nTileBytes -= nTileBytes;
+        data.report.nTileEntries--;
+        data.mapTiles.erase( data.lstTiles.back().nKey );
+        data.lstTiles.pop_back();
+    }
+    data.lstTiles.push_front( std::move( tile ));
+    data.mapTiles[nKey] = data.lstTiles.begin();
+    data.report.nTileEntries++;
+    data.report.nTileBytes += nTileBytes;
+    return data.lstTiles.front().vTexels.data();
+}
+
+// fills the window with the texels of level nLevel in the rectangle at UL with size size, unless it holds them already
+static void FillTiledWindow( olc::TiledTextureData &data, int nLevel, const olc::vi2d &UL, const olc::vi2d &size ) {
+    if (nLevel == data.nWindowLevel && UL == data.windowUL && size == data.windowSize) {
+        return;
+    }
+    data.nWindowLevel = nLevel;
+    data.windowUL     = UL;
+    data.windowSize   = size;
+    data.vWindow.resize( size_t( size.x ) * size.y );
+    int nTileSize = data.nTileSize;
+    olc::vi2d LR = UL + size - olc::vi2d( 1, 1 );
+    for (int ty = UL.y / nTileSize; ty <= LR.y / nTileSize; ty++) {
+        for (int tx = UL.x / nTileSize; tx <= LR.x / nTileSize; tx++) {
+            const olc::Pixel *pTile = GetTile( data, nLevel, tx, ty );
+            // the part of the tile within the window
+            int x0 = std::max( UL.x, tx * nTileSize ), x1 = std::min( LR.x, tx * nTileSize + nTileSize - 1 );
+            int y0 = std::max( UL.y, ty * nTileSize ), y1 = std::min( LR.y, ty * nTileSize + nTileSize - 1 );
+            for (int y = y0; y <= y1; y++) {
+                olc::Pixel *pDst = data.vWindow.data() + size_t( y - UL.y ) * size.x + (x0 - UL.x);
+                if (pTile == nullptr) {
+                    std::fill_n( pDst, x1 - x0 + 1, olc::BLANK );
+                } else {
+                    const olc::Pixel *pSrc = pTile + size_t( y - ty * nTileSize ) * nTileSize + (x0 - tx * nTileSize);
+                    memcpy( pDst, pSrc, size_t( x1 - x0 + 1 ) * sizeof( olc::Pixel ));
+                }
+            }
+        }
+    }
+}
+
+// Works out the range of u and v that the pixels of the quad of ws within [ClipUL, ClipLR] map to, in aRange (u min,
+// u max, v min, v max). The extremes lie on the boundary of the visible part of the quad: either on the edges of the
+// quad (which are straight lines, so these are clipped exactly), or on the edges of the clipping rectangle where they
+// are within the quad. The latter are sampled per pixel, and the largest step in u and v from one sample to the next
+// is passed back in aStep, since the extremes may lie in between. Returns false if no part of the quad is visible.
+static bool GetVisibleUVRange( const WarpSetup &ws, const olc::vi2d &ClipUL, const olc::vi2d &ClipLR, double aRange[4], double aStep[2] ) {
+    aRange[0] = aRange[2] =  DBL_MAX;
+    aRange[1] = aRange[3] = -DBL_MAX;
+    aStep[0]  = aStep[1]  = 0.0;
+    auto Add = [&]( double u, double v ) {
+        aRange[0] = std::min( aRange[0], u );
+        aRange[1] = std::max( aRange[1], u );
+        aRange[2] = std::min( aRange[2], v );
+        aRange[3] = std::max( aRange[3], v );
+    };
+    // the edges of the quad, from (u0, v0) to (u1, v1), clipped against the rectangle (Liang-Barsky)
+    auto AddEdge = [&]( double u0, double v0, double u1, double v1 ) {
+        olc::vd2d p0 = ws.points[0] + ws.b1 * u0 + ws.b2 * v0 + ws.b3 * (u0 * v0);
+        olc::vd2d p1 = ws.points[0] + ws.b1 * u1 + ws.b2 * v1 + ws.b3 * (u1 * v1);
+        olc::vd2d d = p1 - p0;
+        double t0 = 0.0, t1 = 1.0;
+        double p[4] = { -d.x, d.x, -d.y, d.y };
+        double q[4] = { p0.x - ClipUL.x, ClipLR.x - p0.x, p0.y - ClipUL.y, ClipLR.y - p0.y };
+        for (int i = 0; i < 4; i++) {
+            if (p[i] == 0.0) {
+                if (q[i] < 0.0) {
+                    return;
+                }
+            } else if (p[i] < 0.0) {
+                t0 = std::max( t0, q[i] / p[i] );
+            } else {
+                t1 = std::min( t1, q[i] / p[i] );
+            }
+        }
+        if (t0 <= t1) {
+            Add( u0 + (u1 - u0) * t0, v0 + (v1 - v0) * t0 );
+            Add( u0 + (u1 - u0) * t1, v0 + (v1 - v0) * t1 );
+        }
+    };
+    AddEdge( 0.0, 0.0, 1.0, 0.0 );
+    AddEdge( 0.0, 1.0, 1.0, 1.0 );
+    AddEdge( 0.0, 0.0, 0.0, 1.0 );
+    AddEdge( 1.0, 0.0, 1.0, 1.0 );
+    // the edges of the clipping rectangle
+    auto AddClipEdge = [&]( olc::vi2d p, olc::vi2d d, int nCount ) {
+        bool bPrev = false;
+        double uPrev = 0.0, vPrev = 0.0;
+        for (int i = 0; i < nCount; i++, p += d) {
+            double u, v;
+            bool bValid = SolveWarpUV( ws, p.x, p.y, u, v ) && u >= 0.0 && u <= 1.0 && v >= 0.0 && v <= 1.0;
+            if (bValid) {
+                Add( u, v );
+                if (bPrev) {
+                    aStep[0] = std::max( aStep[0], fabs( u - uPrev ));
+                    aStep[1] = std::max( aStep[1], fabs( v - vPrev ));
+                }
+                uPrev = u;
+                vPrev = v;
+            }
+            bPrev = bValid;
+        }
+    };
+    int nCols = ClipLR.x - ClipUL.x + 1;
+    int nRows = ClipLR.y - ClipUL.y + 1;
+    AddClipEdge( ClipUL                  , { 1, 0 }, nCols );
+    AddClipEdge( { ClipUL.x, ClipLR.y }  , { 1, 0 }, nCols );
+    AddClipEdge( ClipUL                  , { 0, 1 }, nRows );
+    AddClipEdge( { ClipLR.x, ClipUL.y }  , { 0, 1 }, nRows );
+    return aRange[0] <= aRange[1] && aRange[2] <= aRange[3];
+}
+
+void olc::DrawWarpedTiledTexture( PixelGameEngine *gfx, TiledTextureSource &source, const std::array<olc::vf2d, 4> &cornerPoints ) {
+    WARP_STATS_ENTRY( DRAW_TILED_TEXTURE );
+    olc::Sprite *pTarget = gfx->GetDrawTarget();
+    if (!source.IsOpen() || pTarget == nullptr) {
+        return;
+    }
+    TiledTextureData &data = *source.pData;
+
+    // work out the per quad constants, and the part of the texture the visible pixels map to
+    WarpSetup ws;
+    SetupWarp( ToDoublePoints( cornerPoints ), ws );
+    olc::vi2d ClipUL = ws.UpperLeft.max( { 0, 0 } );
+    olc::vi2d ClipLR = ws.LowerRight.min( { pTarget->width - 1, pTarget->height - 1 } );
+    double aRange[4], aStep[2];
+    if (ClipUL.x > ClipLR.x || ClipUL.y > ClipLR.y || !GetVisibleUVRange( ws, ClipUL, ClipLR, aRange, aStep )) {
+        return;
+    }
+
+    // pick the level with one to two texels per pixel (along the edges of the quad) ...
+    double dEdgeX = 0.5 * ((ws.points[1] - ws.points[0]).mag() + (ws.points[3] - ws.points[2]).mag());
+    double dEdgeY = 0.5 * ((ws.points[2] - ws.points[0]).mag() + (ws.points[3] - ws.points[1]).mag());
+    double dTexelsPerPixel = std::max( data.nWidth / std::max( 1.0, dEdgeX ), data.nHeight / std::max( 1.0, dEdgeY ));
+    int nLevel = std::max( 0, std::min( int( data.vLevels.size() ) - 1, int( floor( log2( std::max( 1.0, dTexelsPerPixel ))))));
+    // ... or a smaller one if the window would get too large
+    olc::vi2d UL, LR;
+    for (;; nLevel++) {
+        // the texel rows run opposite to v (see RenderAffine())
+        const TiledLevel &level = data.vLevels[nLevel];
+        UL.x = int( floor( (aRange[0] - aStep[0]) * level.nWidth  )) - TILED_WINDOW_MARGIN;
+        LR.x = int( ceil(  (aRange[1] + aStep[0]) * level.nWidth  )) + TILED_WINDOW_MARGIN;
+        UL.y = int( floor( (1.0 - aRange[3] - aStep[1]) * level.nHeight )) - TILED_WINDOW_MARGIN;
+        LR.y = int( ceil(  (1.0 - aRange[2] + aStep[1]) * level.nHeight )) + TILED_WINDOW_MARGIN;
+        UL = UL.max( { 0, 0 } );
+        LR = LR.min( { level.nWidth - 1, level.nHeight - 1 } );
+        if (size_t( LR.x - UL.x + 1 ) * (LR.y - UL.y + 1) <= TILED_MAX_WINDOW || nLevel + 1 == int( data.vLevels.size() )) {
+            break;
+        }
+    }
+    olc::vi2d size = LR - UL + olc::vi2d( 1, 1 );
+    FillTiledWindow( data, nLevel, UL, size );
+    data.report.nLevel     = nLevel;
+    data.report.windowSize = size;
+
+    // The part of the quad that maps to the window is a quad itself, with the corner points at the corners of the window
+    // in uv space. Render that one, with the window as texture
+    const TiledLevel &level = data.vLevels[nLevel];
+    double u0 = double( UL.x ) / level.nWidth, u1 = double( UL.x + size.x ) / level.nWidth;
+    double v0 = 1.0 - double( UL.y + size.y ) / level.nHeight, v1 = 1.0 - double( UL.y ) / level.nHeight;
+    auto Map = [&]( double u, double v ) { return ws.points[0] + ws.b1 * u + ws.b2 * v + ws.b3 * (u * v); };
+    std::array<olc::vd2d, 4> windowPoints = { Map( u0, v1 ), Map( u0, v0 ), Map( u1, v0 ), Map( u1, v1 ) };
+    WarpSetup wsWindow;
+    if (ws.bAffine) {
+        SetupAffine( windowPoints, wsWindow );
+    } else {
+        SetupWarp( windowPoints, wsWindow );
+    }
+    WarpTexture tex;
+    tex.pTexels = data.vWindow.data();
+    tex.nWidth  = size.x;
+    tex.nHeight = size.y;
+    tex.nStride = size.x;
+    RenderQuad( gfx, wsWindow, tex, INT_MIN, INT_MAX, WarpShade::NONE, ShadeParams() );
+}
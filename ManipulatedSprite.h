@@ -13,7 +13,8 @@
 //   https://github.com/OneLoneCoder/olcPixelGameEngine
 //
 // The rotated sprite drawing is implemented by rotating the quad corner points and draw
-// the rotated quad calling the DrawWarpedSprite() implementation.
+// the rotated quad calling the DrawWarpedSprite() implementation. Since a rotated rectangle is a
+// parallelogram, this is done on the (cheaper) affine path of DrawAffineSprite().
 //
 // Have fun with it!
 // Joseph21
@@ -28,6 +29,11 @@ namespace olc {
     void GetQuadBoundingBox( std::array<olc::vf2d, 4> points, olc::vi2d &UpLeft, olc::vi2d &LwRght );
     void GetQuadBoundingBox( std::array<olc::vd2d, 4> points, olc::vi2d &UpLeft, olc::vi2d &LwRght );
 
+    // Convenience function to obtain the horizontal span of a quad on scanline y, so that only the covered part
+    // of each row needs to be sampled. The span is clamped to [nMinX, nMaxX] and passed back by reference as
+    // nStartX and nStopX. Returns false if the quad doesn't cover (any part of) the scanline.
+    bool GetQuadScanlineSpan( const std::array<olc::vd2d, 4> &points, int y, int nMinX, int nMaxX, int &nStartX, int &nStopX );
+
     // Convenience function to calculate and return the center point of a quad.
     olc::vi2d GetQuadCenterpoint( std::array<olc::vf2d, 4> points );
 
@@ -39,6 +45,158 @@ namespace olc {
     // The bilinear warping is implemented for the better part in this function
     bool WarpedSample( olc::vd2d q, olc::vd2d b1, olc::vd2d b2, olc::vd2d b3, olc::Sprite *pSprite, olc::Pixel &colour );
 
+    // The draw functions of this module write directly into the pixel data of the current draw target, and call
+    // PixelGameEngine::Draw() for Pixel::CUSTOM mode. Since the PGE doesn't expose its blend factor, Pixel::ALPHA mode
+    // goes through Draw() as well, unless this function is called: from then on the module blends inline with fBlend,
+    // so call it with the same value as SetPixelBlend() (and again each time that changes).
+    void SetWarpPixelBlend( float fBlend );
+
+    // The bilinear inverse is evaluated by a SIMD kernel that is selected at runtime, depending on what the CPU
+    // supports. The scalar kernel is the reference and the fallback, and all kernels produce the same result.
+    // SetWarpSimd() can be used to select a lower level (e.g. for testing or benchmarking), higher levels than
+    // supported are clamped to the highest supported level.
+    enum class WarpSimd { SCALAR = 0, SSE2, SSE41, AVX2 };
+    void SetWarpSimd( WarpSimd level );
+    WarpSimd GetWarpSimd();
+
+    // Selects how the texels are looked up: NEAREST takes the texel the sample point falls in (the default),
+    // BILINEAR interpolates between the four nearest texels, which looks smoother when sprites are scaled up.
+    // Each sampler has its own specialised inner loop, so the choice costs nothing per pixel.
+    enum class WarpSampler { NEAREST = 0, BILINEAR };
+    void SetWarpSampler( WarpSampler sampler );
+    WarpSampler GetWarpSampler();
+
+    // Mip mapping, for sprites that are drawn (much) smaller than their size. When enabled, a chain of half size versions
+    // of each sprite is built (lazily, the first time it's drawn) and cached, and the renderers sample the level that
+    // fits the on screen size of the quad - per quad for parallelograms and per scanline for other quads. The nearest
+    // sampler takes the nearest level, the bilinear sampler blends the two nearest levels (trilinear filtering).
+    // It's disabled by default. Partial draws always sample the sprite itself.
+    void SetWarpMipmaps( bool bEnable );
+    bool GetWarpMipmaps();
+
+    // Tiled textures, for large sprites that are rotated. When enabled, a copy of each sprite (and of each mip level) is
+    // made with its texels stored in tiles of 8 x 8, so that sampling a rotated sprite costs about the same at any angle.
+    // The copy is made the first time the sprite is drawn, and cached. It is used by the nearest sampler for
+    // parallelograms (e.g. DrawRotatedSprite()). It's disabled by default. Partial draws always sample the sprite itself.
+    void SetWarpTiledTextures( bool bEnable );
+    bool GetWarpTiledTextures();
+
+    // Opacity skipping, for sprites with large transparent areas that are drawn in Pixel::MASK mode. When enabled, an
+    // index of the blocks of 8 x 8 texels that hold opaque texels is built the first time a sprite is drawn, and cached.
+    // The bilinear path then skips the blocks of screen pixels that only map to transparent texels, instead of working
+    // out and testing each of their samples. The output is the same. It applies to Pixel::MASK mode (and to billboards
+    // of the WarpColumnRenderer) for quads that aren't parallelograms - the affine path is cheap per pixel already.
+    // It's disabled by default. Partial draws and mip mapped draws are never skipped.
+    void SetWarpOpacitySkipping( bool bEnable );
+    bool GetWarpOpacitySkipping();
+
+    // Block classification: for convex quads that aren't parallelograms, the screen is classified in blocks of 16 x 16
+    // pixels against the edges of the quad, so that the blocks outside it are rejected as a whole and the ones inside
+    // it skip the coverage test (and can be skipped or filled, see SetWarpOpacitySkipping()). The output is the same
+    // either way. It's enabled by default, disable it to measure what it gains, or to compare the output without it.
+    void SetWarpBlockClassification( bool bEnable );
+    bool GetWarpBlockClassification();
+
+    // The mip chains, tiled copies and opacity indices are cached per sprite. The cache notices when a sprite changes size or pixel buffer,
+    // but not when its pixels are modified: call InvalidateWarpTextureCache() for that sprite in that case, or with
+    // nullptr to clear the whole cache (e.g. when sprites are deleted).
+    void InvalidateWarpTextureCache( const olc::Sprite *pSprite = nullptr );
+
+    // Selects the precision of the warp math. DOUBLE is the reference (and the default). The other back-ends are
+    // faster, at the cost of some accuracy:
+    //   FLOAT - single precision for the bilinear inverse (8 pixels per AVX2 iteration instead of 4) and for the affine
+    //           path. u and v are within a few float epsilons (~1e-6) of the reference, also for quads that are nearly
+    //           (but not exactly) parallelograms, so a texel index can be off by one for pixels that sample right at a
+    //           texel boundary, and the coverage can differ for pixels right on the quad edges. On 200 random quads of
+    //           up to 600 pixels (half of them near parallelograms), 0.02% of the pixels had a texel that was off by
+    //           one, and none differed in coverage.
+    //   FIXED - 16.16 fixed point for the affine path (parallelograms, and thus rotated sprites). The coverage is the
+    //           same as for DOUBLE, and the texel coordinates are within 2^-10 + n * 2^-17 texel of the reference after
+    //           n pixels along a span (the 2^-10 is the snap to whole texels, see RenderAffine()), which gives the same
+    //           rounding quirks as FLOAT at texel boundaries. Non parallelogram quads use the DOUBLE back-end.
+    // The precision is read once per draw call, so it can be changed between draw calls, but not while another thread
+    // is drawing. Use MeasureWarpPrecision() to check the effect of a back-end on a specific quad, it does not change
+    // the precision that is set with SetWarpPrecision(), and can be called while other threads draw.
+    enum class WarpPrecision { DOUBLE = 0, FLOAT, FIXED };
+    void SetWarpPrecision( WarpPrecision precision );
+    WarpPrecision GetWarpPrecision();
+
+    // Renders the quad with both the DOUBLE back-end and the one given by precision, and reports how many pixels
+    // differ in coverage and in texel index, and the largest difference in texel index (in x or y).
+    struct WarpPrecisionReport {
+        int nCovered      = 0;      // nr of pixels covered by the DOUBLE reference
+        int nCoverageDiff = 0;      // nr of pixels that are covered by only one of both
+        int nTexelDiff    = 0;      // nr of pixels covered by both, but with a different texel
+        int nMaxTexelDist = 0;      // largest difference in texel index for those pixels
+    };
+    void MeasureWarpPrecision( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, WarpPrecision precision, WarpPrecisionReport &report );
+
+    // Large quads can be rendered in parallel, by splitting them in bands of rows that are rendered on a persistent
+    // thread pool. The output is identical to that of serial rendering. nThreads is the total nr of threads used
+    // (including the calling thread): 1 means serial (the default), 0 means one thread per hardware core.
+    // NOTE: Pixel::CUSTOM mode is always rendered serially.
+    void SetWarpThreads( int nThreads );
+    int  GetWarpThreads();
+
+    // Instrumentation, to see where the time goes. It's compiled out by default: define WARP_STATS when compiling
+    // ManipulatedSprite.cpp (e.g. -DWARP_STATS) to enable it. The counters are kept per entry point. A call is counted
+    // for the outermost entry point only (e.g. DrawRotatedSprite() calls DrawAffineSprite(), but counts as the first).
+    // For each pixel in the bounding boxes of the quads, either it's covered, or it's rejected for one of these reasons:
+    //   clipped            - outside the draw target or the clipping columns (or, for WarpColumnRenderer, in a column
+    //                        where the quad is hidden)
+    //   discriminant       - the discriminant of the bilinear inverse is negative (bilinear path only)
+    //   denominator        - a denominator of the bilinear inverse is near zero (bilinear path only)
+    //   out of range       - outside the quad otherwise (u or v outside [0.0, 1.0]), whether it was tested per pixel or
+    //                        rejected as part of a span or block
+    // Each pixel is counted where it's rejected, so the counters add up to the bounding boxes. Covered pixels that only
+    // map to transparent texels may be skipped without fetching the texels (in Pixel::MASK mode).
+    // Of the covered pixels, the ones that are written to the draw target are counted as drawn (Pixel::MASK mode skips
+    // the ones that aren't opaque). The time is split in the setup of the mapping, getting the texture (which includes
+    // building the texture cache) and rendering.
+    // GetWarpStats() returns a snapshot of the counters since the last ResetWarpStats() (e.g. call both once per frame).
+    // Without WARP_STATS the snapshot has bEnabled == false and all counters are 0. The entry point is tracked per thread,
+    // and the work that a draw hands to the thread pool (see SetWarpThreads()) counts for the entry point of that draw,
+    // so draws that are issued from multiple threads at the same time are kept apart.
+    enum class WarpEntry {
+        DRAW_WARPED = 0,        // DrawWarpedSprite()
+        DRAW_WARPED_CLIPPED,    // DrawWarpedSpriteClipped()
+        DRAW_WARPED_SHADED,     // DrawWarpedSpriteShaded()
+        DRAW_PARTIAL_WARPED,    // DrawPartialWarpedSprite() and DrawPartialWarpedSpriteClipped()
+        DRAW_PROJECTIVE,        // the DrawProjectiveSprite() family
+        DRAW_AFFINE,            // DrawAffineSprite()
+        DRAW_ROTATED,           // DrawRotatedSprite()
+        DRAW_PARTIAL_ROTATED,   // DrawPartialRotatedSprite()
+        DRAW_WARPED_ROTATED,    // DrawWarpedRotatedSprite()
+        DRAW_TILED_TEXTURE,     // DrawWarpedTiledTexture()
+        PLAN_DRAW,              // WarpPlan::Draw(), DrawClipped() and DrawPartial()
+        BATCH_DRAW,             // WarpedSpriteBatch::Draw()
+        COLUMN_DRAW,            // WarpColumnRenderer::Draw()
+        COUNT
+    };
+    struct WarpStats {
+        uint64_t nCalls              = 0;
+        uint64_t nBoxPixels          = 0;   // pixels in the bounding boxes of the quads
+        uint64_t nTestedPixels       = 0;   // pixels for which the mapping was evaluated one by one
+        uint64_t nCoveredPixels      = 0;
+        uint64_t nDrawnPixels        = 0;
+        uint64_t nRejectClipped      = 0;
+        uint64_t nRejectDiscriminant = 0;
+        uint64_t nRejectDenominator  = 0;
+        uint64_t nRejectOutOfRange   = 0;
+        uint64_t nTexelsFetched      = 0;   // 1 per covered pixel for the nearest sampler, 4 for bilinear, 8 for trilinear
+        double fSetupMs   = 0.0;
+        double fTextureMs = 0.0;
+        double fRenderMs  = 0.0;
+    };
+    struct WarpStatsSnapshot {
+        bool bEnabled = false;
+        WarpStats entries[int( WarpEntry::COUNT )];
+        WarpStats Total() const;
+    };
+    WarpStatsSnapshot GetWarpStats();
+    void ResetWarpStats();
+    const char *WarpEntryName( WarpEntry entry );
+
     // Draws a sprite with 4 arbitrary points, warping the texture to look "correct".
     // The different signatures are there for compliancy with the PGE on the DrawWarpedDecal() family of functions.
     void DrawWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints );
@@ -48,15 +206,234 @@ namespace olc {
     // I created a variant that allows for clipping left and right of the warped sprite, and takes a shading factor in [0.0f, 1.0f] for pixel rendering
     void DrawWarpedSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeFactor = 1.0f );
 
+    // Same as DrawWarpedSpriteClipped(), but the shading factor runs linearly from fShadeLeft at the left side of the quad
+    // to fShadeRight at its right side (e.g. for distance shading of walls)
+    void DrawWarpedSpriteShaded( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeLeft, float fShadeRight );
+
+    // Same as DrawWarpedSprite() and DrawWarpedSpriteClipped(), but only the part of the sprite at source_pos with size
+    // source_size is rendered onto the quad (e.g. a frame from a sprite sheet). The part is sampled in place, so no
+    // copy of it is made.
+    void DrawPartialWarpedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size );
+    void DrawPartialWarpedSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size, int nClipLeft, int nClipRight, float fShadeFactor = 1.0f );
+
+    // Same as the DrawWarpedSprite() family (with the same order of the corner points: ul, ll, lr, ur), but with a
+    // perspective correct (projective) mapping instead of the bilinear one. This is what a textured floor, wall or card
+    // seen in perspective looks like, and it's cheaper per pixel: one reciprocal instead of a sqrt and a few divides.
+    // The quad must be convex. Mip mapping and tiled textures are not used by these functions.
+    void DrawProjectiveSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints );
+    void DrawProjectiveSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeFactor = 1.0f );
+    void DrawProjectiveSpriteShaded( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fShadeLeft, float fShadeRight );
+    void DrawPartialProjectiveSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size );
+    void DrawPartialProjectiveSpriteClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size, int nClipLeft, int nClipRight, float fShadeFactor = 1.0f );
+
+    // Draws a sprite onto a parallelogram, using a linear (affine) mapping that is much cheaper than the bilinear one.
+    // The corner points are in the same order as for DrawWarpedSprite(). Only the first three are used, the fourth
+    // one is implied by the parallelogram. DrawWarpedSprite() takes this path as well if its quad is a parallelogram.
+    void DrawAffineSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vd2d, 4> &cornerPoints );
+
     // Draws a sprite at screen location pos, rotated to specified fAngle (radians), with point of rotation offset. You can scale the rotated sprite as well.
     void DrawRotatedSprite( PixelGameEngine *gfx, const olc::vf2d& pos, olc::Sprite *pSprite, const float fAngle, const olc::vf2d& center = { 0.0f, 0.0f }, const olc::vf2d& scale = { 1.0f, 1.0f } );
 
-    // Pretty much the same as DrawRotatedSprite(), but only a part of the sprite is rendered
+    // Rotation cache, for sprites that are drawn at a limited set of angles. When enabled (with a budget > 0 bytes),
+    // DrawRotatedSprite() quantises the angle to nAngleSteps steps per full turn, and center and pos to 1/16 pixels. It
+    // keeps the rendered bitmap per sprite, angle step, scale, offset of pos relative to center and sub pixel part of
+    // center. Drawing a sprite that is in the cache is a plain copy of the bitmap (honouring the pixel mode), moved by
+    // the whole pixel part of center. The result is the same as that of drawing the sprite with the cache disabled, at
+    // the quantised angle and positions.
+    // When the bitmaps take more than nBudgetBytes, the least recently used ones are dropped. Bitmaps that are larger
+    // than the budget on their own aren't cached, these are drawn as if the cache is disabled.
+    // Use the counters of the report to tune nAngleSteps against the memory use. SetWarpRotationCache() clears the
+    // cache and the counters. InvalidateWarpTextureCache() drops the bitmaps of the sprite(s) as well. It's disabled
+    // by default.
+    struct WarpRotationCacheReport {
+        size_t nHits      = 0;      // nr of draws that were served from the cache
+        size_t nMisses    = 0;      // nr of draws that had to render the bitmap
+        size_t nEvictions = 0;      // nr of bitmaps that were dropped to stay within the budget
+        size_t nEntries   = 0;      // nr of bitmaps in the cache
+        size_t nBytes     = 0;      // memory used by these bitmaps
+    };
+    void SetWarpRotationCache( size_t nBudgetBytes, int nAngleSteps = 256 );
+    WarpRotationCacheReport GetWarpRotationCacheReport();
+
+    // Pretty much the same as DrawRotatedSprite(), but only a part of the sprite is rendered. The part is sampled in place,
+    // so no copy of it is made (unless it sticks out of the sprite)
     void DrawPartialRotatedSprite( PixelGameEngine *gfx, const olc::vf2d& pos, olc::Sprite *pSprite, const float fAngle, const olc::vf2d& center, const olc::vf2d& source_pos, const olc::vf2d& source_size, const olc::vf2d& scale = { 1.0f, 1.0f } );
 
     // Draws a warped sprite that is rotated around centerPoint by fAngle.
     // NOTE: the same effect could be achieved by calling RotateQuadPoints() and then call DrawWarpedSprite() [ in fact this is how it's implemented ]
     void DrawWarpedRotatedSprite( PixelGameEngine *gfx, olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint );
+
+    // A plan holds everything that can be worked out for a quad before drawing it: the per quad constants of the mapping
+    // and the span of the quad on each row. For quads that don't move (or not every frame), make a plan once with one of
+    // the Set...() functions, and draw it as often as needed. The Set...() functions take the same parameters as their
+    // Draw...() counterparts, and the result of drawing a plan is the same as that of calling the Draw...() function.
+    // Since the mapping doesn't depend on the sprite, a plan can be drawn with any sprite. Note however that SetRotated()
+    // takes the sprite size, since it determines the size of the quad. Copies of a plan share the precomputed data.
+    //
+    // For a quad that doesn't move, but is drawn with a different sprite each frame (a video texture, animation frames),
+    // BakeUVMap() stores the coverage and the texel coordinates of each pixel in the plan, for sprites of size spriteSize.
+    // Drawing the plan then only copies texels, for sprites of that size, with the nearest sampler and without mip
+    // mapping (otherwise the regular renderers are used). The map covers the part of the quad within the draw target at
+    // the time of baking, and it's only used when the part to draw (within the current draw target and clip columns)
+    // lies within that, otherwise the regular renderers are used. It uses 4 bytes per covered pixel and 16 bytes per run
+    // of pixels on a row, see GetUVMapReport(). The Set...() functions drop the map, since the quad changes. Call
+    // InvalidateUVMap() to drop it otherwise (e.g. when the rendering settings change), or BakeUVMap() again after a
+    // switch to a larger draw target.
+    struct WarpUVMapReport {
+        bool   bBaked  = false;
+        int    nPixels = 0;         // nr of covered pixels
+        int    nRuns   = 0;         // nr of runs of covered pixels
+        size_t nBytes  = 0;         // memory used by the map
+    };
+
+    struct WarpPlanData;
+    class WarpPlan {
+    public:
+        void SetWarped( const std::array<olc::vf2d, 4> &cornerPoints );
+        void SetAffine( const std::array<olc::vd2d, 4> &cornerPoints );
+        void SetWarpedRotated( const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint );
+        void SetRotated( const olc::vf2d& pos, const olc::vi2d& spriteSize, const float fAngle, const olc::vf2d& center = { 0.0f, 0.0f }, const olc::vf2d& scale = { 1.0f, 1.0f } );
+        void Clear();
+        bool IsEmpty() const { return pData == nullptr; }
+
+        void Draw( PixelGameEngine *gfx, olc::Sprite *pSprite ) const;
+        void DrawClipped( PixelGameEngine *gfx, olc::Sprite *pSprite, int nClipLeft, int nClipRight, float fShadeFactor = 1.0f ) const;
+        // note that for DrawPartialRotatedSprite() equivalence, the plan must be made with SetRotated() for the whole sprite size
+        void DrawPartial( PixelGameEngine *gfx, olc::Sprite *pSprite, const olc::vf2d& source_pos, const olc::vf2d& source_size ) const;
+
+        void BakeUVMap( PixelGameEngine *gfx, const olc::vi2d &spriteSize );
+        void InvalidateUVMap();
+        WarpUVMapReport GetUVMapReport() const;
+
+    private:
+        std::shared_ptr<WarpPlanData> pData;    // the precomputed data, see ManipulatedSprite.cpp
+        friend class WarpedSpriteBatch;
+    };
+
+    // A batch collects many warped / rotated sprite draws and renders them in one go. The quads are binned into screen
+    // tiles in the order they were added, and the tiles are rendered in parallel on the thread pool (see SetWarpThreads()).
+    // Within each tile the quads are drawn in the order they were added, so the result is the same as calling the
+    // corresponding Draw...() functions one after another.
+    // The Add...() functions have the same parameters as their Draw...() counterparts. Draw() doesn't clear the batch,
+    // so a batch can be drawn multiple times. Call Clear() before recording the next set of draws.
+    class WarpedSpriteBatch {
+    public:
+        void AddWarped( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints );
+        void AddWarpedRotated( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, float fAngle, olc::vf2d centerPoint );
+        void AddRotated( olc::Sprite *pSprite, const olc::vf2d& pos, const float fAngle, const olc::vf2d& center = { 0.0f, 0.0f }, const olc::vf2d& scale = { 1.0f, 1.0f } );
+        void AddPartialRotated( olc::Sprite *pSprite, const olc::vf2d& pos, const float fAngle, const olc::vf2d& center, const olc::vf2d& source_pos, const olc::vf2d& source_size, const olc::vf2d& scale = { 1.0f, 1.0f } );
+        void AddPartialWarped( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, const olc::vf2d& source_pos, const olc::vf2d& source_size );
+
+        void AddPlan( olc::Sprite *pSprite, const olc::WarpPlan &plan );
+
+        void Draw( PixelGameEngine *gfx );
+        void Clear();
+        size_t Size() const { return vItems.size(); }
+
+    private:
+        struct BatchItem {
+            olc::Sprite *pSprite = nullptr;
+            std::shared_ptr<olc::Sprite> pPartial;     // owns the duplicated part, for partial draws of parts that stick out of the sprite
+            bool bPartial = false;                      // only the part at source_pos with size source_size is drawn
+            olc::vi2d source_pos, source_size;
+            std::shared_ptr<WarpPlanData> pPlan;        // for plans: the precomputed data
+            std::array<olc::vd2d, 4> points;            // corner points in order ul, ll, lr, ur
+            bool bAffine = false;                       // the quad is known to be a parallelogram
+        };
+        std::vector<BatchItem> vItems;
+    };
+
+    // A column renderer for raycasters. It collects the wall slices and billboards (sprites) of a frame, each with its
+    // depth, and renders them front to back with a depth buffer, so that every pixel is written once. Columns of a quad
+    // that are hidden behind what's drawn already are rejected before any sampling is done. The screen is rendered in
+    // vertical strips of 16 columns, row by row within each strip, and the strips are rendered in parallel on the
+    // thread pool (see SetWarpThreads()).
+    //   AddWall()      - an opaque quad, typically spanning a number of columns with clipping as for DrawWarpedSpriteClipped().
+    //                    The depth runs from fDepthLeft at the left side of the quad to fDepthRight at the right side
+    //                    (perspective correct, i.e. 1 / depth is interpolated linearly).
+    //   AddBillboard() - a quad at constant depth, of which only the opaque texels (alpha == 255) are drawn.
+    // Depths must be > 0. With SetDepthShading() the pixels are shaded by their depth, from 1.0 (no shading) at depth 0
+    // to fMinShade at fMaxDepth and beyond. The shade factors are taken from a table per column, instead of a multiply
+    // per pixel. Pass fMaxDepth <= 0 to disable shading (the default).
+    // The renderer writes into the draw target directly, and doesn't use the pixel mode of the PGE. Draw() doesn't clear
+    // the renderer, call Clear() before recording the next frame.
+    class WarpColumnRenderer {
+    public:
+        void AddWall( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fDepthLeft, float fDepthRight );
+        void AddBillboard( olc::Sprite *pSprite, const std::array<olc::vf2d, 4> &cornerPoints, int nClipLeft, int nClipRight, float fDepth );
+        void SetDepthShading( float fMaxDepth, float fMinShade = 0.0f );
+
+        void Draw( PixelGameEngine *gfx );
+        void Clear();
+        size_t Size() const { return vItems.size(); }
+
+    private:
+        struct ColumnItem {
+            olc::Sprite *pSprite = nullptr;
+            std::array<olc::vd2d, 4> points;            // corner points in order ul, ll, lr, ur
+            int nClipLeft = 0, nClipRight = 0;
+            bool bOpaque = true;                        // walls are opaque, billboards are masked
+            float fInvDepthLeft = 0.0f;                 // 1 / depth at the left and right side of the bounding box
+            float fInvDepthRight = 0.0f;
+        };
+        std::vector<ColumnItem> vItems;
+        std::vector<float>   vDepthBuffer;              // kept between frames, to prevent reallocation
+        float fShadeMaxDepth = 0.0f;
+        std::vector<uint8_t> vShadeTable;               // channel values multiplied by the shade factor, per shade level
+    };
+
+    // Sprite scaling. These write the scaled copy of pSource into *ppDest. If *ppDest points to a sprite already, that
+    // sprite is reused (its pixel buffer is only reallocated when it has to grow), otherwise a new sprite is created
+    // that the caller owns. The cached textures of *ppDest are dropped (see InvalidateWarpTextureCache()). pSource and
+    // *ppDest may be the same sprite. The rows are scaled in parallel on the thread pool (see SetWarpThreads()).
+    //   UpscaleSprite()   - by an integer factor: each texel becomes a block of nFactor x nFactor pixels
+    //   DownscaleSprite() - by an integer factor, with a box filter: each pixel is the average of a block of
+    //                       nFactor x nFactor texels. The size is rounded up, the blocks at the right and bottom edges
+    //                       average the texels they have
+    //   ResizeSprite()    - to any size, with the nearest or the bilinear sampler
+    void UpscaleSprite( const olc::Sprite *pSource, olc::Sprite **ppDest, int nFactor );
+    void DownscaleSprite( const olc::Sprite *pSource, olc::Sprite **ppDest, int nFactor );
+    void ResizeSprite( const olc::Sprite *pSource, olc::Sprite **ppDest, int nWidth, int nHeight, olc::WarpSampler sampler = olc::WarpSampler::NEAREST );
+
+    // Tiled textures, for images that are too large to keep in memory as a sprite. WriteTiledTexture() converts a sprite
+    // into a file that holds the image and its mip levels (each half the size of the previous one, down to 1 x 1), cut in
+    // tiles of nTileSize x nTileSize texels (see tileconvert.cpp for a converter from PNG). A TiledTextureSource opens
+    // such a file, and reads the tiles from it when they are needed. The tiles that were read are kept in a cache of at
+    // most nCacheBytes, and the least recently used ones are dropped when it's full.
+    // DrawWarpedTiledTexture() draws the image onto a quad, like DrawWarpedSprite(). It picks the mip level that has
+    // about one texel per pixel, and works out which texels of that level the visible part of the quad (i.e. within the
+    // draw target) maps to. Only the tiles for these are read, so the memory that's used depends on the size of the draw
+    // target, not on the size of the image. The texels are copied into one window, and the part of the quad that maps
+    // to it is drawn with the regular renderers, with the current sampler, precision and pixel mode.
+    // A source (and its copies, which share the cache) must not be used from multiple threads at the same time.
+    struct TiledTextureReport {
+        size_t nTileReads    = 0;   // nr of tiles read from the file
+        size_t nTileHits     = 0;   // nr of tiles that were found in the cache
+        size_t nTileEntries  = 0;   // nr of tiles in the cache
+        size_t nTileBytes    = 0;   // memory used by the cached tiles
+        int    nLevel        = 0;   // the mip level of the last draw
+        olc::vi2d windowSize;       // the size of the window of texels of the last draw
+    };
+
+    bool WriteTiledTexture( const olc::Sprite *pSprite, const std::string &sFileName, int nTileSize = 128 );
+
+    struct TiledTextureData;
+    class TiledTextureSource {
+    public:
+        bool Open( const std::string &sFileName, size_t nCacheBytes = size_t( 32 ) << 20 );
+        void Close();
+        bool IsOpen() const { return pData != nullptr; }
+        int  GetWidth() const;
+        int  GetHeight() const;
+        int  GetLevels() const;
+        TiledTextureReport GetReport() const;
+
+    private:
+        std::shared_ptr<TiledTextureData> pData;    // the file and the tile cache, see ManipulatedSprite.cpp
+        friend void DrawWarpedTiledTexture( PixelGameEngine *gfx, TiledTextureSource &source, const std::array<olc::vf2d, 4> &cornerPoints );
+    };
+
+    void DrawWarpedTiledTexture( PixelGameEngine *gfx, TiledTextureSource &source, const std::array<olc::vf2d, 4> &cornerPoints );
 };
 
 #endif // MANIPULATEDSPRITE_H
@@ -0,0 +1,357 @@
+// Batch sprite transform tool
+// ===========================
+// Headless tool to pre-bake rotated, scaled and warped variants of images with the ManipulatedSprite module.
+
+// The jobs are read from a job list, one job per line (empty lines and lines starting with # are skipped). The paths
+// can't contain spaces:
+//
+//   rotate <input> <output> <angle> [scale <sx> <sy>] [center <cx> <cy>] [part <x> <y> <w> <h>]
+//   warp   <input> <output> <x0> <y0> <x1> <y1> <x2> <y2> <x3> <y3> [part <x> <y> <w> <h>]
+//
+//   rotate - rotates the image by angle (in radians) around center (in pixels of the image, default its middle), after
+//            scaling it by (sx, sy), as DrawRotatedSprite() does. With part, only that part of the image is rendered
+//            onto the rotated rectangle, as DrawPartialRotatedSprite() does
+//   warp   - warps the image onto the quad with corner points ul, ll, lr, ur, as DrawWarpedSprite() does. With part,
+//            only that part of the image is rendered onto the quad, as DrawPartialWarpedSprite() does
+//
+// The output image is the bounding box of the transformed image, with a transparent background.
+// The jobs are run in a pipeline of three stages, that each have their own threads: decoding the input images,
+// transforming them, and encoding the output images. The stages are connected by bounded queues, so that the nr of
+// images in memory stays limited. When all jobs are done, the throughput is reported in images/s and Mpixels/s (of
+// the output images).
+// Usage: batchtransform <job list> [--threads <nr of threads per stage, default all cores>] [--bilinear]
+//
+// Build it like the demo, but with batchtransform.cpp instead of main.cpp, e.g. on Linux:
+//   g++ -O2 -std=c++17 batchtransform.cpp ManipulatedSprite.cpp -o batchtransform -lX11 -lGL -lpthread -lpng -lstdc++fs
+
+#define OLC_IMAGE_STB     // same configuration as the demo
+
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include "ManipulatedSprite.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+enum JobType { Rotate = 0, Warp };
+
+// one line of the job list
+struct Job {
+    int nLine = 0;
+    JobType type = Rotate;
+    std::string sInput, sOutput;
+    float fAngle = 0.0f;
+    olc::vf2d scale = { 1.0f, 1.0f };
+    bool bCenter = false;
+    olc::vf2d center;
+    std::array<olc::vf2d, 4> points;
+    bool bPart = false;
+    olc::vf2d partPos, partSize;
+};
+
+// a job on its way through the pipeline
+struct WorkItem {
+    const Job *pJob = nullptr;
+    olc::Sprite *pInput  = nullptr;
+    olc::Sprite *pOutput = nullptr;
+};
+
+// A queue with a maximum size. Push() waits while the queue is full, Pop() waits while it's empty. After Close(),
+// Pop() returns false once the queue is empty
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue( size_t nCapacity ) : nCapacity( std::max( size_t( 1 ), nCapacity )) {}
+
+    void Push( const T &item ) {
+        std::unique_lock<std::mutex> lock( mtx );
+        cvNotFull.wait( lock, [this] { return items.size() < nCapacity; } );
+        items.push_back( item );
+        cvNotEmpty.notify_one();
+    }
+
+    bool Pop( T &item ) {
+        std::unique_lock<std::mutex> lock( mtx );
+        cvNotEmpty.wait( lock, [this] { return bClosed || !items.empty(); } );
+        if (items.empty()) {
+            return false;
+        }
+        item = items.front();
+        items.pop_front();
+        cvNotFull.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock( mtx );
+        bClosed = true;
+        cvNotEmpty.notify_all();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cvNotFull, cvNotEmpty;
+    std::deque<T> items;
+    size_t nCapacity;
+    bool bClosed = false;
+};
+
+// The PGE is only used as the holder of the draw target and pixel mode, it's never started
+class HeadlessEngine : public olc::PixelGameEngine {
+public:
+    HeadlessEngine() {
+        sAppName = "Batch sprite transform";
+        // a draw target of its own, so there is always a valid one to go back to (see Transform())
+        SetDrawTarget( &idleTarget );
+    }
+
+private:
+    olc::Sprite idleTarget{ 1, 1 };
+};
+
+// parses one line of the job list. Returns false (with the reason in sError) if it's not a valid job
+bool ParseJob( const std::string &sLine, Job &job, std::string &sError ) {
+    std::istringstream in( sLine );
+    std::string sType;
+    in >> sType >> job.sInput >> job.sOutput;
+    if (sType == "rotate") {
+        job.type = Rotate;
+        in >> job.fAngle;
+    } else if (sType == "warp") {
+        job.type = Warp;
+        for (olc::vf2d &p : job.points) {
+            in >> p.x >> p.y;
+        }
+    } else {
+        sError = "unknown job type '" + sType + "'";
+        return false;
+    }
+    if (!in) {
+        sError = "missing parameters";
+        return false;
+    }
+    // the optional parameters
+    std::string sOption;
+    while (in >> sOption) {
+        if (sOption == "scale" && job.type == Rotate) {
+            in >> job.scale.x >> job.scale.y;
+        } else if (sOption == "center" && job.type == Rotate) {
+            in >> job.center.x >> job.center.y;
+            job.bCenter = true;
+        } else if (sOption == "part") {
+            in >> job.partPos.x >> job.partPos.y >> job.partSize.x >> job.partSize.y;
+            job.bPart = true;
+        } else {
+            sError = "unknown option '" + sOption + "'";
+            return false;
+        }
+        if (!in) {
+            sError = "missing values for option '" + sOption + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+// renders the job into a new sprite the size of the bounding box of the transformed input
+olc::Sprite *Transform( olc::PixelGameEngine *gfx, const Job &job, olc::Sprite *pInput ) {
+    // work out the corner points, with the origin at (0, 0)
+    std::array<olc::vd2d, 4> points;
+    olc::vd2d pivot;
+    if (job.type == Rotate) {
+        olc::vd2d size = { pInput->width * job.scale.x, pInput->height * job.scale.y };
+        pivot = job.bCenter ? olc::vd2d( job.center.x * job.scale.x, job.center.y * job.scale.y ) : size * 0.5;
+        points = { olc::vd2d( 0.0, 0.0 ), olc::vd2d( 0.0, size.y ), size, olc::vd2d( size.x, 0.0 ) };
+        olc::RotateQuadPoints( points, double( job.fAngle ), pivot );
+    } else {
+        for (int i = 0; i < 4; i++) {
+            points[i] = job.points[i];
+        }
+    }
+    // then move the bounding box to the origin of the output sprite. The corner points lie on pixel edges, so the box
+    // runs from floor( min ) up to (not including) ceil( max ) - GetQuadBoundingBox() would add a row and column
+    olc::vd2d minPt = points[0], maxPt = points[0];
+    for (int i = 1; i < 4; i++) {
+        minPt = minPt.min( points[i] );
+        maxPt = maxPt.max( points[i] );
+    }
+    olc::vi2d UpLeft = { int( floor( minPt.x )), int( floor( minPt.y )) };
+    olc::vi2d outSize = olc::vi2d( int( ceil( maxPt.x )), int( ceil( maxPt.y ))) - UpLeft;
+    if (outSize.x <= 0 || outSize.y <= 0) {
+        return nullptr;
+    }
+    olc::vf2d offset = -olc::vf2d( UpLeft );
+    olc::Sprite *pOutput = new olc::Sprite( outSize.x, outSize.y );
+    std::fill( pOutput->pColData.begin(), pOutput->pColData.end(), olc::BLANK );
+
+    // draw into the output, and go back to the previous target afterwards. Note that SetDrawTarget( nullptr ) would
+    // select the screen layer, which a PGE that's never started doesn't have
+    olc::Sprite *pPrevTarget = gfx->GetDrawTarget();
+    gfx->SetDrawTarget( pOutput );
+    gfx->SetPixelMode( olc::Pixel::NORMAL );
+    if (job.type == Rotate) {
+        olc::vf2d center = olc::vf2d( float( pivot.x ), float( pivot.y )) + offset;
+        if (job.bPart) {
+            olc::DrawPartialRotatedSprite( gfx, offset, pInput, job.fAngle, center, job.partPos, job.partSize, job.scale );
+        } else {
+            olc::DrawRotatedSprite( gfx, offset, pInput, job.fAngle, center, job.scale );
+        }
+    } else {
+        std::array<olc::vf2d, 4> quad;
+        for (int i = 0; i < 4; i++) {
+            quad[i] = job.points[i] + offset;
+        }
+        if (job.bPart) {
+            olc::DrawPartialWarpedSprite( gfx, pInput, quad, job.partPos, job.partSize );
+        } else {
+            olc::DrawWarpedSprite( gfx, pInput, quad );
+        }
+    }
+    gfx->SetDrawTarget( pPrevTarget );
+    return pOutput;
+}
+
+int main( int argc, char *argv[] ) {
+    std::string sJobList;
+    int nThreads = std::max( 1, int( std::thread::hardware_concurrency()));
+    bool bBilinear = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc) {
+            nThreads = std::max( 1, atoi( argv[++i] ));
+        } else if (strcmp( argv[i], "--bilinear" ) == 0) {
+            bBilinear = true;
+        } else if (sJobList.empty()) {
+            sJobList = argv[i];
+        } else {
+            sJobList.clear();
+            break;
+        }
+    }
+    if (sJobList.empty()) {
+        fprintf( stderr, "usage: %s <job list> [--threads <nr of threads per stage>] [--bilinear]\n", argv[0] );
+        return 1;
+    }
+
+    // read the job list
+    std::ifstream file( sJobList );
+    if (!file) {
+        fprintf( stderr, "can't open %s\n", sJobList.c_str() );
+        return 1;
+    }
+    std::vector<Job> vJobs;
+    std::string sLine;
+    int nErrors = 0;
+    for (int nLine = 1; std::getline( file, sLine ); nLine++) {
+        size_t nStart = sLine.find_first_not_of( " \t\r" );
+        if (nStart == std::string::npos || sLine[nStart] == '#') {
+            continue;
+        }
+        Job job;
+        job.nLine = nLine;
+        std::string sError;
+        if (ParseJob( sLine, job, sError )) {
+            vJobs.push_back( job );
+        } else {
+            fprintf( stderr, "%s:%d: %s\n", sJobList.c_str(), nLine, sError.c_str() );
+            nErrors++;
+        }
+    }
+
+    // the jobs run in parallel, so the module renders each of them on the calling thread
+    olc::SetWarpThreads( 1 );
+    olc::SetWarpSampler( bBilinear ? olc::WarpSampler::BILINEAR : olc::WarpSampler::NEAREST );
+    // one engine per transform thread, for its draw target. They are made here, since the PGE constructor isn't
+    // thread safe
+    std::vector<std::unique_ptr<HeadlessEngine>> vEngines;
+    for (int i = 0; i < nThreads; i++) {
+        vEngines.push_back( std::unique_ptr<HeadlessEngine>( new HeadlessEngine ));
+    }
+
+    // the pipeline
+    BoundedQueue<WorkItem> qDecoded( 2 * nThreads ), qTransformed( 2 * nThreads );
+    std::atomic<size_t> nNextJob( 0 );
+    std::atomic<int> nDecodersLeft( nThreads ), nTransformersLeft( nThreads );
+    std::atomic<int> nDone( 0 ), nFailed( 0 );
+    std::atomic<int64_t> nPixels( 0 );
+    std::mutex mtxReport;
+    auto Fail = [&]( const Job &job, const char *sWhat ) {
+        std::lock_guard<std::mutex> lock( mtxReport );
+        fprintf( stderr, "%s:%d: can't %s\n", sJobList.c_str(), job.nLine, sWhat );
+        nFailed++;
+    };
+
+    auto Decode = [&]() {
+        for (size_t j = nNextJob++; j < vJobs.size(); j = nNextJob++) {
+            WorkItem item;
+            item.pJob = &vJobs[j];
+            item.pInput = new olc::Sprite();
+            if (item.pInput->LoadFromFile( item.pJob->sInput ) != olc::rcode::OK || item.pInput->width <= 0 || item.pInput->height <= 0) {
+                Fail( *item.pJob, ("load " + item.pJob->sInput).c_str() );
+                delete item.pInput;
+                continue;
+            }
+            qDecoded.Push( item );
+        }
+        if (--nDecodersLeft == 0) {
+            qDecoded.Close();
+        }
+    };
+
+    auto Transform_ = [&]( int nThread ) {
+        WorkItem item;
+        while (qDecoded.Pop( item )) {
+            item.pOutput = Transform( vEngines[nThread].get(), *item.pJob, item.pInput );
+            // the module caches derived textures per sprite, so drop them before the sprite goes
+            olc::InvalidateWarpTextureCache( item.pInput );
+            delete item.pInput;
+            item.pInput = nullptr;
+            if (item.pOutput == nullptr) {
+                Fail( *item.pJob, "transform (the output is empty)" );
+                continue;
+            }
+            qTransformed.Push( item );
+        }
+        if (--nTransformersLeft == 0) {
+            qTransformed.Close();
+        }
+    };
+
+    auto Encode = [&]() {
+        WorkItem item;
+        while (qTransformed.Pop( item )) {
+            if (item.pOutput->SaveToFile( item.pJob->sOutput ) == olc::rcode::OK) {
+                nDone++;
+                nPixels += int64_t( item.pOutput->width ) * item.pOutput->height;
+            } else {
+                Fail( *item.pJob, ("save " + item.pJob->sOutput).c_str() );
+            }
+            delete item.pOutput;
+        }
+    };
+
+    auto tStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> vThreads;
+    for (int i = 0; i < nThreads; i++) {
+        vThreads.push_back( std::thread( Decode ));
+        vThreads.push_back( std::thread( Transform_, i ));
+        vThreads.push_back( std::thread( Encode ));
+    }
+    for (std::thread &t : vThreads) {
+        t.join();
+    }
+    double dSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - tStart ).count();
+
+    printf( "%d of %d jobs done (%d failed, %d invalid lines) in %.2f s with %d threads per stage: %.1f images/s, %.2f Mpixels/s\n",
+        nDone.load(), int( vJobs.size() ), nFailed.load(), nErrors, dSeconds, nThreads,
+        (dSeconds > 0.0) ? nDone / dSeconds : 0.0, (dSeconds > 0.0) ? double( nPixels ) * 1.0e-6 / dSeconds : 0.0 );
+    return (nFailed > 0 || nErrors > 0) ? 1 : 0;
+}
@@ -0,0 +1,247 @@
+// Warped and rotated sprite benchmark
+// ===================================
+// Headless benchmark for the ManipulatedSprite module.
+
+// The draw functions are called with an off screen olc::Sprite as draw target, so no window is opened (the PGE is never
+// started). The benchmark sweeps sprite size, quad shape, angle, display size, render mode (the same three modes as the
+// demo in main.cpp) and thread count, and prints one CSV line per case on stdout:
+//
+//   mode,shape,sprite_w,sprite_h,display,angle,threads,draws,us_per_draw,covered_px,bbox_px,coverage,mpix_per_s,ns_per_px
+//
+//   display     - size of the quad as a fraction of the height of the draw target
+//   covered_px  - nr of pixels the draw wrote. This doesn't depend on the timing, so a change between two builds
+//                 means the output changed
+//   bbox_px     - nr of pixels in the bounding box of the quad, clipped to the draw target
+//   coverage    - covered_px / bbox_px, i.e. the part of the bounding box that is actually covered by the quad
+//   mpix_per_s  - covered pixels per second (in millions), ns_per_px is its inverse
+//
+// The lines start with the parameters of the case, so the outputs of two builds can be joined on them (or diffed
+// after dropping the timing columns).
+// Usage: benchmark [--quick] [--min-ms <milliseconds per case, default 20>]
+//
+// Build it like the demo, but with benchmark.cpp instead of main.cpp, e.g. on Linux:
+//   g++ -O2 -std=c++17 benchmark.cpp ManipulatedSprite.cpp -o benchmark -lX11 -lGL -lpthread -lpng -lstdc++fs
+
+#define OLC_IMAGE_STB     // same configuration as the demo
+
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include "ManipulatedSprite.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// size of the off screen draw target - the same as the screen of the demo
+#define TARGET_X   1400
+#define TARGET_Y    800
+
+enum BenchMode { RotateOnly = 0, Warped, Partial };
+enum BenchShape { AxisAligned = 0, Rotated, StronglyWarped, Degenerate };
+
+std::string Mode2String( BenchMode mode ) {
+    switch (mode) {
+        case RotateOnly: return "ROTATE_ONLY";
+        case Warped    : return "WARPED"     ;
+        case Partial   : return "PARTIAL"    ;
+    }
+    return "_INVALID_";
+}
+
+std::string Shape2String( BenchShape shape ) {
+    switch (shape) {
+        case AxisAligned   : return "AXIS_ALIGNED";
+        case Rotated       : return "ROTATED"     ;
+        case StronglyWarped: return "WARPED"      ;
+        case Degenerate    : return "DEGENERATE"  ;
+    }
+    return "_INVALID_";
+}
+
+// one benchmark case
+struct BenchCase {
+    BenchMode  mode;
+    BenchShape shape;
+    olc::Sprite *pSprite;
+    float fDisplay;     // size of the quad as fraction of the target height
+    float fAngle;
+    int   nThreads;
+};
+
+// The PGE is only used as the holder of the draw target and pixel mode, it's never started
+class HeadlessEngine : public olc::PixelGameEngine {
+public:
+    HeadlessEngine() {
+        sAppName = "Warped and rotated sprite benchmark";
+    }
+};
+
+// makes a sprite with opaque texels only, so that the covered pixels can be counted in the draw target
+olc::Sprite *MakeSprite( int nWidth, int nHeight ) {
+    olc::Sprite *pSprite = new olc::Sprite( nWidth, nHeight );
+    for (int y = 0; y < nHeight; y++) {
+        for (int x = 0; x < nWidth; x++) {
+            bool bChecker = ((x >> 3) + (y >> 3)) & 1;
+            pSprite->SetPixel( x, y, olc::Pixel( uint8_t( x * 255 / nWidth ), uint8_t( y * 255 / nHeight ), bChecker ? 255 : 64 ));
+        }
+    }
+    return pSprite;
+}
+
+// the corner points (ul, ll, lr, ur) of the quad of the case before it is rotated. The quad is centered on the draw
+// target, and the rotation is around the center of the draw target
+std::array<olc::vf2d, 4> CasePoints( const BenchCase &bc ) {
+    olc::Sprite *pSprite = bc.pSprite;
+    float fHeight = bc.fDisplay * float( TARGET_Y );
+    float fWidth  = fHeight * float( pSprite->width ) / float( pSprite->height );
+    olc::vf2d center = { 0.5f * float( TARGET_X ), 0.5f * float( TARGET_Y ) };
+    olc::vf2d origin = center - olc::vf2d( 0.5f * fWidth, 0.5f * fHeight );
+    // the part of the sprite in Partial mode is drawn on the quad of the whole sprite. Outside Warped mode the degenerate
+    // quad has no height
+    olc::vf2d size   = { fWidth, (bc.shape == Degenerate && bc.mode != Warped) ? 0.0f : fHeight };
+    std::array<olc::vf2d, 4> points = {
+        origin,
+        origin + olc::vf2d( 0.0f  , size.y ),
+        origin + size,
+        origin + olc::vf2d( size.x, 0.0f   )
+    };
+    if (bc.mode == Warped) {
+        if (bc.shape == StronglyWarped) {
+            // narrow the top to a third, and pull the lower right corner in
+            points[0].x += fWidth / 3.0f;
+            points[3].x -= fWidth / 3.0f;
+            points[2]   -= olc::vf2d( 0.2f * fWidth, 0.3f * fHeight );
+        } else if (bc.shape == Degenerate) {
+            // all corner points on one line
+            for (int i = 0; i < 4; i++) {
+                points[i].y = center.y + 0.25f * (points[i].x - center.x);
+            }
+        }
+    }
+    return points;
+}
+
+// draws the case once, on the quad of CasePoints()
+void DrawCase( olc::PixelGameEngine *gfx, const BenchCase &bc ) {
+    olc::Sprite *pSprite = bc.pSprite;
+    std::array<olc::vf2d, 4> points = CasePoints( bc );
+    olc::vf2d center = { 0.5f * float( TARGET_X ), 0.5f * float( TARGET_Y ) };
+    float fScale = bc.fDisplay * float( TARGET_Y ) / float( pSprite->height );
+    olc::vf2d scale  = { fScale, (bc.shape == Degenerate) ? 0.0f : fScale };
+
+    switch (bc.mode) {
+        case RotateOnly:
+            olc::DrawRotatedSprite( gfx, points[0], pSprite, bc.fAngle, center, scale );
+            break;
+        case Partial: {
+            olc::vf2d partSource = { 0.25f * float( pSprite->width ), 0.25f * float( pSprite->height ) };
+            olc::vf2d partSize   = { 0.5f  * float( pSprite->width ), 0.5f  * float( pSprite->height ) };
+            olc::DrawPartialRotatedSprite( gfx, points[0], pSprite, bc.fAngle, center, partSource, partSize, scale );
+            break;
+        }
+        case Warped:
+            olc::DrawWarpedRotatedSprite( gfx, pSprite, points, bc.fAngle, center );
+            break;
+    }
+}
+
+// the bounding box of the quad of the case, clipped to the draw target, in pixels
+int64_t BoundingBoxPixels( const BenchCase &bc ) {
+    std::array<olc::vf2d, 4> casePoints = CasePoints( bc );
+    std::array<olc::vd2d, 4> points;
+    for (int i = 0; i < 4; i++) {
+        points[i] = olc::vd2d( casePoints[i].x, casePoints[i].y );
+    }
+    olc::RotateQuadPoints( points, double( bc.fAngle ), { 0.5 * TARGET_X, 0.5 * TARGET_Y } );
+    olc::vi2d UpLeft, LwRght;
+    olc::GetQuadBoundingBox( points, UpLeft, LwRght );
+    UpLeft = UpLeft.max( { 0, 0 } );
+    LwRght = LwRght.min( { TARGET_X - 1, TARGET_Y - 1 } );
+    return (UpLeft.x > LwRght.x || UpLeft.y > LwRght.y) ? 0 : int64_t( LwRght.x - UpLeft.x + 1 ) * (LwRght.y - UpLeft.y + 1);
+}
+
+int main( int argc, char *argv[] ) {
+    bool bQuick = false;
+    double dMinMs = 20.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp( argv[i], "--quick" ) == 0) {
+            bQuick = true;
+        } else if (strcmp( argv[i], "--min-ms" ) == 0 && i + 1 < argc) {
+            dMinMs = atof( argv[++i] );
+        } else {
+            fprintf( stderr, "usage: %s [--quick] [--min-ms <milliseconds per case>]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    // the target is declared before the engine, so it outlives it, and stays the draw target until the end
+    olc::Sprite target( TARGET_X, TARGET_Y );
+    HeadlessEngine engine;
+    engine.SetDrawTarget( &target );
+    engine.SetPixelMode( olc::Pixel::NORMAL );
+
+    // the sweep
+    std::vector<olc::vi2d> vSizes = bQuick ? std::vector<olc::vi2d>{ { 13, 16 }, { 256, 256 }, { 3008, 1692 } }
+                                           : std::vector<olc::vi2d>{ { 13, 16 }, { 64, 64 }, { 256, 256 }, { 1024, 768 }, { 3008, 1692 } };
+    std::vector<float> vDisplays = bQuick ? std::vector<float>{ 0.5f } : std::vector<float>{ 0.1f, 0.5f, 1.0f };
+    std::vector<float> vAngles   = bQuick ? std::vector<float>{ 0.3f } : std::vector<float>{ 0.3f, 1.5708f, 2.5f };
+    int nHardware = std::max( 1, int( std::thread::hardware_concurrency()));
+    std::vector<int> vThreads = { 1 };
+    if (nHardware > 1) {
+        vThreads.push_back( nHardware );
+    }
+
+    printf( "mode,shape,sprite_w,sprite_h,display,angle,threads,draws,us_per_draw,covered_px,bbox_px,coverage,mpix_per_s,ns_per_px\n" );
+    for (const olc::vi2d &size : vSizes) {
+        olc::Sprite *pSprite = MakeSprite( size.x, size.y );
+        for (BenchMode mode : { RotateOnly, Warped, Partial }) {
+            for (BenchShape shape : { AxisAligned, Rotated, StronglyWarped, Degenerate }) {
+                // the rotated modes can't make a strongly warped quad
+                if (shape == StronglyWarped && mode != Warped) {
+                    continue;
+                }
+                std::vector<float> vCaseAngles = (shape == Rotated) ? vAngles : std::vector<float>{ 0.0f };
+                for (float fDisplay : vDisplays) {
+                    for (float fAngle : vCaseAngles) {
+                        for (int nThreads : vThreads) {
+                            BenchCase bc = { mode, shape, pSprite, fDisplay, fAngle, nThreads };
+                            olc::SetWarpThreads( nThreads );
+
+                            // count the covered pixels (this draw builds any caches as well)
+                            std::fill( target.pColData.begin(), target.pColData.end(), olc::BLANK );
+                            DrawCase( &engine, bc );
+                            int64_t nCovered = 0;
+                            for (const olc::Pixel &p : target.pColData) {
+                                nCovered += (p.a == 255);
+                            }
+                            int64_t nBox = BoundingBoxPixels( bc );
+
+                            // time the draws until the minimum time has passed
+                            int nDraws = 0;
+                            double dElapsed = 0.0;
+                            auto tStart = std::chrono::steady_clock::now();
+                            while (nDraws < 3 || dElapsed < dMinMs) {
+                                DrawCase( &engine, bc );
+                                nDraws++;
+                                dElapsed = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - tStart ).count();
+                            }
+                            double dUsPerDraw = 1000.0 * dElapsed / nDraws;
+                            double dMPixPerS  = (dUsPerDraw > 0.0) ? double( nCovered ) / dUsPerDraw : 0.0;
+                            double dNsPerPx   = (nCovered > 0) ? 1000.0 * dUsPerDraw / double( nCovered ) : 0.0;
+                            double dCoverage  = (nBox > 0) ? double( nCovered ) / double( nBox ) : 0.0;
+                            printf( "%s,%s,%d,%d,%.2f,%.4f,%d,%d,%.3f,%lld,%lld,%.4f,%.2f,%.3f\n",
+                                Mode2String( mode ).c_str(), Shape2String( shape ).c_str(), size.x, size.y, fDisplay, fAngle, nThreads,
+                                nDraws, dUsPerDraw, (long long)nCovered, (long long)nBox, dCoverage, dMPixPerS, dNsPerPx );
+                            fflush( stdout );
+                        }
+                    }
+                }
+            }
+        }
+        olc::InvalidateWarpTextureCache( pSprite );
+        delete pSprite;
+    }
+    return 0;
+}
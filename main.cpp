@@ -12,6 +12,145 @@
 
 #include "ManipulatedSprite.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Snapshot pipeline
+// -----------------
+// Saves snapshots of the screen without stalling the frame. The pipeline owns a fixed pool of capture buffers. The game
+// thread acquires a free buffer, renders into it and submits it together with a file name. A background thread encodes
+// and saves the submitted buffers in order, and then puts them back in the pool. Since the nr of buffers is fixed, so
+// is the nr of snapshots that can be in flight. If all buffers are in use, Acquire() either returns nullptr (the
+// snapshot is dropped) or waits until the encoder frees one, depending on the policy.
+// The results of the saves are collected, and handed to the game thread by PollCompleted(), so that it can report them.
+class SnapshotPipeline {
+public:
+    enum Policy {
+        Drop = 0,   // drop the snapshot if no buffer is free
+        Block       // wait for a free buffer
+    };
+
+    struct Result {
+        std::string sFileName;
+        bool bSaved;
+    };
+
+    SnapshotPipeline( int nPoolSize, Policy policy ) : enPolicy( policy ) {
+        for (int i = 0; i < std::max( 1, nPoolSize ); i++) {
+            vFree.push_back( new olc::Sprite( 1, 1 ));
+        }
+        nBuffers = int( vFree.size() );
+        encoder = std::thread( &SnapshotPipeline::EncoderLoop, this );
+    }
+
+    // saves the snapshots that are still queued, then stops the encoder
+    ~SnapshotPipeline() {
+        {
+            std::lock_guard<std::mutex> lock( mtx );
+            bStop = true;
+        }
+        cvWork.notify_one();
+        encoder.join();
+        for (olc::Sprite *pBuffer : vFree) {
+            delete pBuffer;
+        }
+    }
+
+    void   SetPolicy( Policy policy ) { std::lock_guard<std::mutex> lock( mtx ); enPolicy = policy; }
+    Policy GetPolicy()                { std::lock_guard<std::mutex> lock( mtx ); return enPolicy;  }
+
+    // returns a buffer of nWidth x nHeight pixels to render the snapshot into, or nullptr if it's dropped. The contents
+    // of the buffer are undefined. The buffer must be handed back by Submit() or Cancel()
+    olc::Sprite *Acquire( int nWidth, int nHeight ) {
+        std::unique_lock<std::mutex> lock( mtx );
+        if (vFree.empty()) {
+            if (enPolicy == Drop) {
+                nDropped++;
+                return nullptr;
+            }
+            cvFree.wait( lock, [this] { return !vFree.empty(); } );
+        }
+        olc::Sprite *pBuffer = vFree.back();
+        vFree.pop_back();
+        lock.unlock();
+        // (re)size the buffer if needed - the pool adapts to the size of the screen
+        if (pBuffer->width != nWidth || pBuffer->height != nHeight) {
+            delete pBuffer;
+            pBuffer = new olc::Sprite( nWidth, nHeight );
+        }
+        return pBuffer;
+    }
+
+    // queues the buffer to be saved as sFileName
+    void Submit( olc::Sprite *pBuffer, const std::string &sFileName ) {
+        {
+            std::lock_guard<std::mutex> lock( mtx );
+            qJobs.push_back( { pBuffer, sFileName } );
+        }
+        cvWork.notify_one();
+    }
+
+    // hands back a buffer without saving it
+    void Cancel( olc::Sprite *pBuffer ) {
+        {
+            std::lock_guard<std::mutex> lock( mtx );
+            vFree.push_back( pBuffer );
+        }
+        cvFree.notify_one();
+    }
+
+    // returns (and forgets) the results of the saves that completed since the previous call
+    std::vector<Result> PollCompleted() {
+        std::lock_guard<std::mutex> lock( mtx );
+        std::vector<Result> vResults;
+        vResults.swap( vCompleted );
+        return vResults;
+    }
+
+    // nr of snapshots that are queued or being saved
+    int GetPending() { std::lock_guard<std::mutex> lock( mtx ); return nBuffers - int( vFree.size() ); }
+    int GetDropped() { std::lock_guard<std::mutex> lock( mtx ); return nDropped; }
+
+private:
+    struct Job {
+        olc::Sprite *pBuffer;
+        std::string sFileName;
+    };
+
+    void EncoderLoop() {
+        std::unique_lock<std::mutex> lock( mtx );
+        for (;;) {
+            cvWork.wait( lock, [this] { return bStop || !qJobs.empty(); } );
+            if (qJobs.empty()) {
+                return;     // stopped, and nothing left to save
+            }
+            Job job = qJobs.front();
+            qJobs.pop_front();
+            // the encoding is the slow part, so it's done without holding the lock
+            lock.unlock();
+            bool bSaved = (job.pBuffer->SaveToFile( job.sFileName ) == olc::rcode::OK);
+            lock.lock();
+            vCompleted.push_back( { job.sFileName, bSaved } );
+            vFree.push_back( job.pBuffer );
+            cvFree.notify_one();
+        }
+    }
+
+    std::mutex mtx;                     // guards all members below
+    std::condition_variable cvWork;     // signals a new job, or the stop request, to the encoder
+    std::condition_variable cvFree;     // signals a free buffer to a blocked Acquire()
+    std::vector<olc::Sprite *> vFree;   // the buffers that are not in use
+    std::deque<Job> qJobs;              // the submitted buffers, in order
+    std::vector<Result> vCompleted;
+    Policy enPolicy;
+    int  nBuffers = 0;
+    int  nDropped = 0;
+    bool bStop = false;
+    std::thread encoder;
+};
+
 
 class WarpedRotatedSprite : public olc::PixelGameEngine {
 public:
@@ -40,6 +179,13 @@ public:
         Partial
     } enRenderMode;
 
+    // snapshots are saved in the background, see SnapshotPipeline
+    SnapshotPipeline snapshots{ 4, SnapshotPipeline::Drop };
+    bool bRecording = false;           // if set, every frame is saved
+    int nSnapshot = 0;                 // to keep the file names of a burst apart
+    int nSaved = 0, nFailed = 0;
+    std::string sLastSnapshot;
+
 
 public:
 
@@ -52,27 +198,6 @@ public:
         return "_INVALID_";
     }
 
-    // creates a copy of orgSprite by scaling it with factor nScale
-    // the copy is passed as ppSprite
-    void ScaleSprite( olc::Sprite *orgSprite, olc::Sprite **ppSprite, int nScale ) {
-        // if ppSprite points to an existing sprite, delete it first
-        if (*ppSprite != nullptr)
-            delete *ppSprite;
-        // create new sprite as scaled version of orgSprite
-        *ppSprite = new olc::Sprite( orgSprite->width * nScale, orgSprite->height * nScale );
-        // fill the new sprite
-        for (int y = 0; y < orgSprite->height; y++) {
-            for (int x = 0; x < orgSprite->width; x++) {
-                olc::Pixel p = orgSprite->GetPixel( x, y );
-                for (int i = 0; i < nScale; i++) {
-                    for (int j = 0; j < nScale; j++) {
-                        (*ppSprite)->SetPixel( x * nScale + j, y * nScale + i, p );
-                    }
-                }
-            }
-        }
-    }
-
     // reset the display rectangle in pts as a percentage (fPerc) of screen height
     void ScaleDisplay( std::array<olc::vf2d, 4> &pts, float fPerc ) {
         // the margin is what's left divided by 2
@@ -102,7 +227,7 @@ public:
 //            "Risor_3008x1692.png"     // 3008 x 1692 pixels
         );
         nScaleSprite = 2;
-        ScaleSprite( sprOrg, &sprDemo, nScaleSprite );
+        UpscaleSprite( sprOrg, &sprDemo, nScaleSprite );
         fDispPercentage = 0.5f;
         ScaleDisplay( points, fDispPercentage );
 
@@ -155,13 +280,13 @@ public:
         // scale sprite
         if (GetKey( olc::Key::NP_ADD).bPressed) {
             nScaleSprite += 1;
-            ScaleSprite( sprOrg, &sprDemo, nScaleSprite );
+            UpscaleSprite( sprOrg, &sprDemo, nScaleSprite );   // sprDemo is reused
         }
         if (GetKey( olc::Key::NP_SUB).bPressed) {
             nScaleSprite -= 1;
             if (nScaleSprite < 1)
                 nScaleSprite = 1;
-            ScaleSprite( sprOrg, &sprDemo, nScaleSprite );
+            UpscaleSprite( sprOrg, &sprDemo, nScaleSprite );
         }
         // scale display surface
         if (GetKey( olc::Key::PGDN ).bHeld) { fDispPercentage -= float( dMultiplier ) * fElapsedTime; ScaleDisplay( points, fDispPercentage ); }
@@ -185,8 +310,16 @@ public:
         if (GetKey( olc::Key::NP3 ).bHeld) { partSize   -= olc::vf2d( 10.0f * fElapsedTime, 10.0f * fElapsedTime ); }
         if (GetKey( olc::Key::NP9 ).bHeld) { partSize   += olc::vf2d( 10.0f * fElapsedTime, 10.0f * fElapsedTime ); }
 
-        bool bSaveMode = GetKey( olc::S ).bPressed;
+        // snapshots - S saves one frame, R toggles saving every frame, P toggles between dropping and waiting when the
+        // encoder can't keep up
+        if (GetKey( olc::Key::R ).bPressed) bRecording = !bRecording;
+        if (GetKey( olc::Key::P ).bPressed) snapshots.SetPolicy( snapshots.GetPolicy() == SnapshotPipeline::Drop ? SnapshotPipeline::Block : SnapshotPipeline::Drop );
+        bool bSaveMode = GetKey( olc::S ).bPressed || bRecording;
         olc::Sprite *pSaveSpr = nullptr;
+        for (const SnapshotPipeline::Result &result : snapshots.PollCompleted()) {
+            if (result.bSaved) nSaved++; else nFailed++;
+            sLastSnapshot = result.sFileName;
+        }
 
         // Rendering part
         // ==============
@@ -199,23 +332,26 @@ public:
 
         olc::vf2d originPoint = olc::vf2d( points[0].x, points[0].y );
 
-        if (bSaveMode) {
-            // create a sprite the size of the screen and set it as draw target
-            pSaveSpr = new olc::Sprite( ScreenWidth(), ScreenHeight() );
-            SetDrawTarget( pSaveSpr );
-        }
-
-        switch (enRenderMode) {
-            case RotateOnly: DrawRotatedSprite(        this, originPoint, sprDemo, fTheta, centerPt,                       scaleFactor ); break;
-            case Warped    : DrawWarpedRotatedSprite(  this, sprDemo, points     , fTheta, centerPt                                    ); break;
-            case Partial   : DrawPartialRotatedSprite( this, originPoint, sprDemo, fTheta, centerPt, partSource, partSize, scaleFactor ); break;
-        }
+        auto DrawTestSprite = [&]() {
+            switch (enRenderMode) {
+                case RotateOnly: DrawRotatedSprite(        this, originPoint, sprDemo, fTheta, centerPt,                       scaleFactor ); break;
+                case Warped    : DrawWarpedRotatedSprite(  this, sprDemo, points     , fTheta, centerPt                                    ); break;
+                case Partial   : DrawPartialRotatedSprite( this, originPoint, sprDemo, fTheta, centerPt, partSource, partSize, scaleFactor ); break;
+            }
+        };
 
         if (bSaveMode) {
-            std::string sFileName = "snap" + std::to_string( time( 0 )) + ".png";
-            pSaveSpr->SaveToFile( sFileName );
-            SetDrawTarget( nullptr );
+            // get a capture buffer the size of the screen (nullptr if it's dropped), render into it and hand it to the encoder
+            pSaveSpr = snapshots.Acquire( ScreenWidth(), ScreenHeight() );
+            if (pSaveSpr != nullptr) {
+                SetDrawTarget( pSaveSpr );
+                Clear( olc::BLACK );    // the buffers are reused
+                DrawTestSprite();
+                SetDrawTarget( nullptr );
+                snapshots.Submit( pSaveSpr, "snap" + std::to_string( time( 0 )) + "_" + std::to_string( nSnapshot++ ) + ".png" );
+            }
         }
+        DrawTestSprite();
 
         SetPixelMode( olc::Pixel::NORMAL );
 
@@ -240,6 +376,10 @@ public:
         DrawString( 610, 10, "Mode                       : " + RenderMode2String( enRenderMode )                                                   , olc::YELLOW );
         DrawString( 610, 20, "[  NP_1/NP_7  ] Part origin: (" + std::to_string( partSource.x ) + ", " + std::to_string( partSource.y ) + ")"       , olc::YELLOW );
         DrawString( 610, 30, "[  NP_3/NP_9  ] Part size  : (" + std::to_string( partSize.x )   + ", " + std::to_string( partSize.y )   + ")"       , olc::YELLOW );
+        DrawString( 610, 40, "[S/R] Snapshot / record   : " + std::string( bRecording ? "RECORDING" : "-" )
+                                                            + "  [P] when busy: " + (snapshots.GetPolicy() == SnapshotPipeline::Drop ? "DROP" : "WAIT") , olc::YELLOW );
+        DrawString( 610, 50, "      saved " + std::to_string( nSaved ) + ", failed " + std::to_string( nFailed ) + ", dropped " + std::to_string( snapshots.GetDropped() )
+                                           + ", pending " + std::to_string( snapshots.GetPending() ) + "  " + sLastSnapshot                        , olc::YELLOW );
 
         return !GetKey( olc::Key::ESCAPE ).bPressed;
     }
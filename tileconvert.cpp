@@ -0,0 +1,63 @@
+// Tiled texture converter
+// =======================
+// Converts an image file (e.g. PNG) into a tiled texture file for olc::TiledTextureSource, see ManipulatedSprite.h.
+
+// The image is loaded into an olc::Sprite once, so the conversion itself needs the memory for the whole image (and
+// half of it for the mip levels). Drawing from the converted file doesn't: only the tiles that are visible are read.
+// Usage: tileconvert <input image> <output file> [--tile <tile size, default 128>]
+//
+// Build it like the demo, but with tileconvert.cpp instead of main.cpp, e.g. on Linux:
+//   g++ -O2 -std=c++17 tileconvert.cpp ManipulatedSprite.cpp -o tileconvert -lX11 -lGL -lpthread -lpng -lstdc++fs
+
+#define OLC_IMAGE_STB     // same configuration as the demo
+
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include "ManipulatedSprite.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+int main( int argc, char *argv[] ) {
+    std::string sInput, sOutput;
+    int nTileSize = 128;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp( argv[i], "--tile" ) == 0 && i + 1 < argc) {
+            nTileSize = atoi( argv[++i] );
+        } else if (sInput.empty()) {
+            sInput = argv[i];
+        } else if (sOutput.empty()) {
+            sOutput = argv[i];
+        } else {
+            sInput.clear();
+            break;
+        }
+    }
+    if (sInput.empty() || sOutput.empty() || nTileSize <= 0) {
+        fprintf( stderr, "usage: %s <input image> <output file> [--tile <tile size>]\n", argv[0] );
+        return 1;
+    }
+
+    auto tStart = std::chrono::steady_clock::now();
+    olc::Sprite image;
+    if (image.LoadFromFile( sInput ) != olc::rcode::OK || image.width <= 0 || image.height <= 0) {
+        fprintf( stderr, "can't load %s\n", sInput.c_str() );
+        return 1;
+    }
+    auto tLoaded = std::chrono::steady_clock::now();
+    if (!olc::WriteTiledTexture( &image, sOutput, nTileSize )) {
+        fprintf( stderr, "can't write %s\n", sOutput.c_str() );
+        return 1;
+    }
+    auto tWritten = std::chrono::steady_clock::now();
+
+    olc::TiledTextureSource source;
+    source.Open( sOutput );
+    printf( "%s: %d x %d pixels, %d levels, tiles of %d x %d - loaded in %.0f ms, converted in %.0f ms\n",
+        sOutput.c_str(), image.width, image.height, source.GetLevels(), nTileSize, nTileSize,
+        std::chrono::duration<double, std::milli>( tLoaded  - tStart  ).count(),
+        std::chrono::duration<double, std::milli>( tWritten - tLoaded ).count() );
+    return 0;
+}
@@ -0,0 +1,938 @@
+// Warped and rotated sprite tests
+// ===============================
+// Headless checks for the ManipulatedSprite module.
+
+// The draw functions are called with an off screen olc::Sprite as draw target, so no window is opened (the PGE is never
+// started). Each check prints one line with PASS or FAIL and what it found, and the exit code is the nr of failed checks:
+//
+//   identity   - a sprite drawn with DrawRotatedSprite() at angle 0 and a whole number scale must give each texel
+//                exactly scale x scale pixels, for each precision back-end
+//   precision  - the FLOAT and FIXED back-ends must cover the same pixels as the DOUBLE reference (FLOAT may differ
+//                on a few edge pixels), with texel indices that are at most one texel off (see MeasureWarpPrecision())
+//   precision threads - measuring a back-end on one thread must not change what is drawn on another one
+//   kernels    - each SIMD kernel must give the same pixels as the scalar one, for whole sprites and for parts of a
+//                sprite (DrawPartialWarpedSprite()), with the DOUBLE and the FLOAT back-end
+//   threads    - random quads and rotated sprites must give the same pixels with 1 and with 4 threads, for each
+//                sampler and precision back-end
+//   batch      - random warped, rotated and partial sprites drawn with a WarpedSpriteBatch must give the same pixels
+//                as drawing them one by one in the same order, with 1 and with 4 threads
+//   rotation cache - with the rotation cache enabled, DrawRotatedSprite() must draw the same pixels as without it, for
+//                angles and positions on the quantisation grid, both when the bitmap is rendered and when it's reused
+//   uv map     - a plan with a baked UV map must draw the same as without it, also on a larger draw target than the
+//                one it was baked on, and with clip columns
+//   block classification - random convex, concave and self intersecting quads, also off the draw target and across
+//                its edges, must give the same pixels with the block classification enabled and disabled
+//   column renderer - a single wall drawn with WarpColumnRenderer must give the pixels of DrawWarpedSpriteClipped() with
+//                the same clip columns and the depth shading applied, a near wall must hide a far wall without any of
+//                its pixels being written, and the texels of a billboard that are not opaque must leave both the draw
+//                target and the depth buffer alone
+//   alpha      - in Pixel::ALPHA mode the draw functions must blend with the blend factor of the PGE, and with the one
+//                of SetWarpPixelBlend() once that is called
+//   stats      - (only if ManipulatedSprite.cpp is compiled with WARP_STATS) for each entry point, the covered and the
+//                rejected pixels must add up to the bounding boxes, also with the thread pool, and draws issued from
+//                two threads at the same time must each be counted for their own entry point
+//
+// Usage: warptest
+//
+// Build it like the demo, but with warptest.cpp instead of main.cpp, e.g. on Linux:
+//   g++ -O2 -std=c++17 warptest.cpp ManipulatedSprite.cpp -o warptest -lX11 -lGL -lpthread -lpng -lstdc++fs
+
+#define OLC_IMAGE_STB     // same configuration as the demo
+
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include "ManipulatedSprite.h"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <thread>
+
+// The PGE is only used as the holder of the draw target and pixel mode, it's never started
+class HeadlessEngine : public olc::PixelGameEngine {
+public:
+    HeadlessEngine() {
+        sAppName = "Warped and rotated sprite tests";
+    }
+};
+
+std::string Precision2String( olc::WarpPrecision precision ) {
+    switch (precision) {
+        case olc::WarpPrecision::DOUBLE: return "DOUBLE";
+        case olc::WarpPrecision::FLOAT : return "FLOAT" ;
+        case olc::WarpPrecision::FIXED : return "FIXED" ;
+    }
+    return "_INVALID_";
+}
+
+int nFailed = 0;
+
+// prints the result of a check, and counts it if it failed
+void Report( bool bPass, const std::string &sCheck, const std::string &sDetails ) {
+    printf( "%s %s: %s\n", bPass ? "PASS" : "FAIL", sCheck.c_str(), sDetails.c_str() );
+    nFailed += bPass ? 0 : 1;
+}
+
+// makes a sprite in which each texel holds its own coordinates, so that the texel a pixel was sampled from can be
+// read back from the draw target
+olc::Sprite *MakeIndexSprite( int nWidth, int nHeight ) {
+    olc::Sprite *pSprite = new olc::Sprite( nWidth, nHeight );
+    for (int y = 0; y < nHeight; y++) {
+        for (int x = 0; x < nWidth; x++) {
+            pSprite->SetPixel( x, y, olc::Pixel( uint8_t( x ), uint8_t( y ), 0 ));
+        }
+    }
+    return pSprite;
+}
+
+enum class QuadKind { CONVEX = 0, CONCAVE, SELF_INTERSECTING, COUNT };
+
+// tells whether the quad (corner points in order) is convex, concave or self intersecting
+QuadKind GetQuadKind( const std::array<olc::vf2d, 4> &q ) {
+    auto Cross = []( const olc::vf2d &a, const olc::vf2d &b, const olc::vf2d &c ) { return (b - a).cross( c - a ); };
+    auto Intersect = [&]( const olc::vf2d &a, const olc::vf2d &b, const olc::vf2d &c, const olc::vf2d &d ) {
+        return Cross( a, b, c ) * Cross( a, b, d ) < 0.0f && Cross( c, d, a ) * Cross( c, d, b ) < 0.0f;
+    };
+    if (Intersect( q[0], q[1], q[2], q[3] ) || Intersect( q[1], q[2], q[3], q[0] )) {
+        return QuadKind::SELF_INTERSECTING;
+    }
+    int nLeftTurns = 0;
+    for (int i = 0; i < 4; i++) {
+        nLeftTurns += (Cross( q[i], q[(i + 1) % 4], q[(i + 2) % 4] ) > 0.0f);
+    }
+    return (nLeftTurns == 0 || nLeftTurns == 4) ? QuadKind::CONVEX : QuadKind::CONCAVE;
+}
+
+// Makes nPerKind random convex, concave and self intersecting quads each, with sizes from a few pixels up to larger than
+// the draw target. Their centers are spread over an area that's larger than the draw target, so that some of them lie
+// off the target, and some lie across its edges.
+std::vector<std::array<olc::vf2d, 4>> MakeRandomQuads( const olc::Sprite *pTarget, int nPerKind, unsigned nSeed ) {
+    std::mt19937 rng( nSeed );
+    std::uniform_real_distribution<float> PosX( -0.5f * pTarget->width, 1.5f * pTarget->width ), PosY( -0.5f * pTarget->height, 1.5f * pTarget->height );
+    std::uniform_real_distribution<float> Radius( 4.0f, float( pTarget->width )), Unit( -1.0f, 1.0f );
+    std::vector<std::array<olc::vf2d, 4>> vQuads;
+    int aCount[int( QuadKind::COUNT )] = { 0 };
+    while (int( vQuads.size() ) < nPerKind * int( QuadKind::COUNT )) {
+        olc::vf2d center = { PosX( rng ), PosY( rng ) };
+        float r = Radius( rng );
+        std::array<olc::vf2d, 4> quad;
+        for (olc::vf2d &point : quad) {
+            point = center + olc::vf2d( Unit( rng ), Unit( rng )) * r;
+        }
+        int &nCount = aCount[int( GetQuadKind( quad ))];
+        if (nCount < nPerKind) {
+            nCount++;
+            vQuads.push_back( quad );
+        }
+    }
+    return vQuads;
+}
+
+// Draws an index sprite at a whole pixel position, angle 0 and whole number scales, and checks that every pixel of
+// the sprite rectangle holds the texel it lies on. The pixels on the closing edges (right and bottom) are covered as
+// well, with the last texel, so these are not checked.
+void CheckIdentity( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 50, 40 );
+    olc::vi2d pos = { 7, 5 };
+    for (olc::WarpPrecision precision : { olc::WarpPrecision::DOUBLE, olc::WarpPrecision::FLOAT, olc::WarpPrecision::FIXED }) {
+        olc::SetWarpPrecision( precision );
+        for (int nScale = 1; nScale <= 3; nScale++) {
+            std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+            olc::vf2d center = olc::vf2d( pos ) + olc::vf2d( 0.5f * 50.0f * nScale, 0.5f * 40.0f * nScale );
+            olc::DrawRotatedSprite( gfx, olc::vf2d( pos ), pSprite, 0.0f, center, { float( nScale ), float( nScale ) } );
+
+            int nWrong = 0;
+            std::vector<bool> vRows( pSprite->height, false );
+            for (int y = 0; y < pSprite->height * nScale; y++) {
+                for (int x = 0; x < pSprite->width * nScale; x++) {
+                    olc::Pixel p = pTarget->GetPixel( pos.x + x, pos.y + y );
+                    if (p.a != 255 || p.r != x / nScale || p.g != y / nScale) {
+                        nWrong++;
+                    } else {
+                        vRows[p.g] = true;
+                    }
+                }
+            }
+            int nRows = int( std::count( vRows.begin(), vRows.end(), true ));
+            Report( nWrong == 0, "identity " + Precision2String( precision ) + " scale " + std::to_string( nScale ),
+                std::to_string( nWrong ) + " wrong pixels, " + std::to_string( nRows ) + " of " + std::to_string( pSprite->height ) + " rows sampled" );
+        }
+    }
+    olc::SetWarpPrecision( olc::WarpPrecision::DOUBLE );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Measures the FLOAT and FIXED back-ends against the DOUBLE reference, on random rotated sprites (the affine path) and
+// random warped quads
+void CheckPrecision() {
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    std::mt19937 rng( 21 );
+    std::uniform_real_distribution<float> Pos( 0.0f, 400.0f ), Angle( -3.2f, 3.2f ), Scale( 0.3f, 4.0f );
+    for (olc::WarpPrecision precision : { olc::WarpPrecision::FLOAT, olc::WarpPrecision::FIXED }) {
+        int nCovered = 0, nCoverageDiff = 0, nTexelDiff = 0, nMaxTexelDist = 0;
+        for (int nQuad = 0; nQuad < 200; nQuad++) {
+            std::array<olc::vf2d, 4> points;
+            if (nQuad % 2 == 0) {
+                // a rotated and scaled sprite is a parallelogram
+                olc::vd2d center = { Pos( rng ), Pos( rng ) };
+                olc::vd2d size = { pSprite->width * Scale( rng ), pSprite->height * Scale( rng ) };
+                std::array<olc::vd2d, 4> rotated = { center, center + olc::vd2d( 0.0, size.y ), center + size, center + olc::vd2d( size.x, 0.0 ) };
+                olc::RotateQuadPoints( rotated, Angle( rng ), center );
+                for (int i = 0; i < 4; i++) {
+                    points[i] = olc::vf2d( float( rotated[i].x ), float( rotated[i].y ));
+                }
+            } else {
+                // a convex warped quad around a random center
+                olc::vf2d center = { Pos( rng ), Pos( rng ) };
+                float r = 20.0f * Scale( rng );
+                points = { center + olc::vf2d( -r, -0.8f * r ), center + olc::vf2d( -0.7f * r, r ), center + olc::vf2d( r, 1.1f * r ), center + olc::vf2d( 0.9f * r, -r ) };
+            }
+            olc::WarpPrecisionReport report;
+            olc::MeasureWarpPrecision( pSprite, points, precision, report );
+            nCovered      += report.nCovered;
+            nCoverageDiff += report.nCoverageDiff;
+            nTexelDiff    += report.nTexelDiff;
+            nMaxTexelDist  = std::max( nMaxTexelDist, report.nMaxTexelDist );
+        }
+        // the fixed point back-end works out the spans in double, so its coverage is exact
+        int nMaxCoverageDiff = (precision == olc::WarpPrecision::FIXED) ? 0 : nCovered / 10000;
+        Report( nCovered > 0 && nCoverageDiff <= nMaxCoverageDiff && nMaxTexelDist <= 1, "precision " + Precision2String( precision ),
+            std::to_string( nCovered ) + " pixels covered, " + std::to_string( nCoverageDiff ) + " differ in coverage, " +
+            std::to_string( nTexelDiff ) + " in texel (at most " + std::to_string( nMaxTexelDist ) + " texel)" );
+    }
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Draws the same rotated sprite over and over with the DOUBLE back-end, while another thread keeps measuring the
+// FIXED back-end, and checks that all draws give the same pixels
+void CheckPrecisionThreads( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    auto Draw = [&]() {
+        std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+        olc::DrawRotatedSprite( gfx, { 40.0f, 30.0f }, pSprite, 0.37f, { 90.0f, 70.0f }, { 1.7f, 1.3f } );
+    };
+    Draw();
+    std::vector<olc::Pixel> vReference = pTarget->pColData;
+
+    std::atomic<bool> bStop( false );
+    std::atomic<int>  nMeasured( 0 );
+    std::thread measurer( [&]() {
+        std::array<olc::vf2d, 4> points = { olc::vf2d( 10.3f, 20.1f ), olc::vf2d( 30.7f, 140.2f ), olc::vf2d( 190.1f, 120.9f ), olc::vf2d( 170.6f, 0.4f ) };
+        while (!bStop) {
+            olc::WarpPrecisionReport report;
+            olc::MeasureWarpPrecision( pSprite, points, olc::WarpPrecision::FIXED, report );
+            nMeasured++;
+        }
+    });
+    int nDraws = 0, nChanged = 0;
+    auto tStart = std::chrono::steady_clock::now();
+    while (nDraws < 20 || std::chrono::steady_clock::now() - tStart < std::chrono::milliseconds( 300 )) {
+        Draw();
+        nChanged += (pTarget->pColData != vReference);
+        nDraws++;
+    }
+    bStop = true;
+    measurer.join();
+    Report( nChanged == 0, "precision threads", std::to_string( nChanged ) + " of " + std::to_string( nDraws ) + " draws changed, " +
+        std::to_string( nMeasured ) + " measurements on the other thread" );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Draws random warped quads (which take the bilinear inverse, and thus the SIMD kernels) with each SIMD level the CPU
+// supports, and compares them to the scalar kernel. The partial draws sample a part of the sprite in place, so there
+// the texel index must be worked out with the width of the whole sprite.
+void CheckKernels( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    olc::WarpSimd highest = olc::GetWarpSimd();
+    auto Simd2String = []( olc::WarpSimd level ) {
+        switch (level) {
+            case olc::WarpSimd::SCALAR: return "SCALAR";
+            case olc::WarpSimd::SSE2  : return "SSE2"  ;
+            case olc::WarpSimd::SSE41 : return "SSE41" ;
+            case olc::WarpSimd::AVX2  : return "AVX2"  ;
+        }
+        return "_INVALID_";
+    };
+    for (olc::WarpPrecision precision : { olc::WarpPrecision::DOUBLE, olc::WarpPrecision::FLOAT }) {
+        olc::SetWarpPrecision( precision );
+        for (bool bPartial : { false, true }) {
+            // the random quads and source rectangles are the same for each level
+            std::mt19937 rng( 10 );
+            std::uniform_real_distribution<float> Pos( -20.0f, 220.0f ), Src( 0.0f, 40.0f ), Size( 4.0f, 24.0f );
+            std::vector<std::array<olc::vf2d, 4>> vQuads( 100 );
+            std::vector<std::pair<olc::vf2d, olc::vf2d>> vSources( vQuads.size() );
+            for (size_t i = 0; i < vQuads.size(); i++) {
+                for (olc::vf2d &point : vQuads[i]) {
+                    point = { Pos( rng ), Pos( rng ) };
+                }
+                vSources[i] = { olc::vf2d( Src( rng ), Src( rng ) * 0.5f ), olc::vf2d( Size( rng ), Size( rng )) };
+            }
+            std::vector<olc::Pixel> vReference;
+            for (int nLevel = int( olc::WarpSimd::SCALAR ); nLevel <= int( highest ); nLevel++) {
+                olc::SetWarpSimd( olc::WarpSimd( nLevel ));
+                std::vector<olc::Pixel> vResult;
+                for (size_t i = 0; i < vQuads.size(); i++) {
+                    std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+                    if (bPartial) {
+                        olc::DrawPartialWarpedSprite( gfx, pSprite, vQuads[i], vSources[i].first, vSources[i].second );
+                    } else {
+                        olc::DrawWarpedSprite( gfx, pSprite, vQuads[i] );
+                    }
+                    vResult.insert( vResult.end(), pTarget->pColData.begin(), pTarget->pColData.end() );
+                }
+                if (nLevel == int( olc::WarpSimd::SCALAR )) {
+                    vReference = vResult;
+                    continue;
+                }
+                int nDiffer = 0, nCovered = 0;
+                for (size_t i = 0; i < vResult.size(); i++) {
+                    nDiffer  += (vResult[i] != vReference[i]);
+                    nCovered += (vReference[i].a != 0);
+                }
+                Report( nCovered > 0 && nDiffer == 0, std::string( "kernels " ) + Simd2String( olc::WarpSimd( nLevel )) + " " +
+                    Precision2String( precision ) + (bPartial ? " partial" : " whole"),
+                    std::to_string( nDiffer ) + " of " + std::to_string( nCovered ) + " pixels differ from SCALAR" );
+            }
+        }
+    }
+    olc::SetWarpSimd( highest );
+    olc::SetWarpPrecision( olc::WarpPrecision::DOUBLE );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Draws random quads and rotated sprites with 1 thread and with 4 threads, and checks that the pixels are the same, for
+// each sampler and precision. The draw target is larger than the one of the other checks, so that most draws are
+// large enough to be split in bands
+void CheckThreads( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    olc::Sprite large( 480, 360 );
+    gfx->SetDrawTarget( &large );
+    std::vector<std::array<olc::vf2d, 4>> vQuads = MakeRandomQuads( &large, 10, 6 );
+    std::mt19937 rng( 6 );
+    std::uniform_real_distribution<float> Angle( -3.2f, 3.2f ), Scale( 1.0f, 6.0f );
+    std::vector<std::pair<float, olc::vf2d>> vRotations( 20 );
+    for (std::pair<float, olc::vf2d> &rotation : vRotations) {
+        rotation = { Angle( rng ), olc::vf2d( Scale( rng ), Scale( rng )) };
+    }
+    int nThreads = olc::GetWarpThreads();
+    for (olc::WarpSampler sampler : { olc::WarpSampler::NEAREST, olc::WarpSampler::BILINEAR }) {
+        olc::SetWarpSampler( sampler );
+        for (olc::WarpPrecision precision : { olc::WarpPrecision::DOUBLE, olc::WarpPrecision::FLOAT, olc::WarpPrecision::FIXED }) {
+            olc::SetWarpPrecision( precision );
+            std::vector<olc::Pixel> vResult[2];
+            for (int nPass = 0; nPass < 2; nPass++) {
+                olc::SetWarpThreads( nPass == 0 ? 1 : 4 );
+                auto Keep = [&]() {
+                    vResult[nPass].insert( vResult[nPass].end(), large.pColData.begin(), large.pColData.end() );
+                };
+                for (const std::array<olc::vf2d, 4> &quad : vQuads) {
+                    std::fill( large.pColData.begin(), large.pColData.end(), olc::BLANK );
+                    olc::DrawWarpedSprite( gfx, pSprite, quad );
+                    Keep();
+                }
+                for (const std::pair<float, olc::vf2d> &rotation : vRotations) {
+                    std::fill( large.pColData.begin(), large.pColData.end(), olc::BLANK );
+                    olc::vf2d center = { 0.5f * large.width, 0.5f * large.height };
+                    olc::vf2d size   = olc::vf2d( float( pSprite->width ), float( pSprite->height )) * rotation.second;
+                    olc::DrawRotatedSprite( gfx, center - 0.5f * size, pSprite, rotation.first, center, rotation.second );
+                    Keep();
+                }
+            }
+            int nDiffer = 0, nDrawn = 0;
+            for (size_t i = 0; i < vResult[0].size(); i++) {
+                nDiffer += (vResult[1][i] != vResult[0][i]);
+                nDrawn  += (vResult[0][i] != olc::BLANK);
+            }
+            Report( nDrawn > 0 && nDiffer == 0, std::string( "threads " ) + (sampler == olc::WarpSampler::NEAREST ? "NEAREST " : "BILINEAR ") +
+                Precision2String( precision ), std::to_string( nDiffer ) + " of " + std::to_string( nDrawn ) + " pixels differ between 1 and 4 threads" );
+        }
+    }
+    olc::SetWarpThreads( nThreads );
+    olc::SetWarpPrecision( olc::WarpPrecision::DOUBLE );
+    olc::SetWarpSampler( olc::WarpSampler::NEAREST );
+    gfx->SetDrawTarget( pTarget );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Records random warped, warped rotated, rotated, partial rotated and partial warped sprites in a WarpedSpriteBatch,
+// on a draw target that spans several tiles. The items overlap and lie across the tile and target edges, so drawing
+// the batch (with 1 and with 4 threads) must give the same pixels as drawing the items one by one in the same order.
+void CheckBatch( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    olc::Sprite large( 480, 360 );
+    gfx->SetDrawTarget( &large );
+    std::vector<std::array<olc::vf2d, 4>> vQuads = MakeRandomQuads( &large, 6, 7 );
+    std::mt19937 rng( 7 );
+    std::uniform_real_distribution<float> Angle( -3.2f, 3.2f ), Scale( 0.5f, 4.0f ), PosX( -60.0f, 540.0f ), PosY( -60.0f, 420.0f );
+    std::uniform_int_distribution<int> Kind( 0, 4 ), SourceX( 0, 40 ), SourceY( 0, 30 ), Size( 4, 24 );
+    // each item is recorded in the batch, and kept as a function that draws it directly
+    olc::WarpedSpriteBatch batch;
+    std::vector<std::function<void()>> vDirect;
+    for (int nItem = 0; nItem < 60; nItem++) {
+        const std::array<olc::vf2d, 4> quad = vQuads[nItem % vQuads.size()];
+        float fAngle = Angle( rng );
+        olc::vf2d pos = { PosX( rng ), PosY( rng ) }, center = { PosX( rng ) / 8.0f, PosY( rng ) / 8.0f };
+        olc::vf2d scale = { Scale( rng ), Scale( rng ) };
+        olc::vf2d source_pos = { float( SourceX( rng )), float( SourceY( rng )) }, source_size = { float( Size( rng )), float( Size( rng )) };
+        switch (Kind( rng )) {
+            case 0:
+                batch.AddWarped( pSprite, quad );
+                vDirect.push_back( [=]() { olc::DrawWarpedSprite( gfx, pSprite, quad ); } );
+                break;
+            case 1:
+                batch.AddWarpedRotated( pSprite, quad, fAngle, pos );
+                vDirect.push_back( [=]() { olc::DrawWarpedRotatedSprite( gfx, pSprite, quad, fAngle, pos ); } );
+                break;
+            case 2:
+                batch.AddRotated( pSprite, pos, fAngle, center, scale );
+                vDirect.push_back( [=]() { olc::DrawRotatedSprite( gfx, pos, pSprite, fAngle, center, scale ); } );
+                break;
+            case 3:
+                batch.AddPartialRotated( pSprite, pos, fAngle, center, source_pos, source_size, scale );
+                vDirect.push_back( [=]() { olc::DrawPartialRotatedSprite( gfx, pos, pSprite, fAngle, center, source_pos, source_size, scale ); } );
+                break;
+            default:
+                batch.AddPartialWarped( pSprite, quad, source_pos, source_size );
+                vDirect.push_back( [=]() { olc::DrawPartialWarpedSprite( gfx, pSprite, quad, source_pos, source_size ); } );
+                break;
+        }
+    }
+    int nThreads = olc::GetWarpThreads();
+    for (olc::WarpSampler sampler : { olc::WarpSampler::NEAREST, olc::WarpSampler::BILINEAR }) {
+        olc::SetWarpSampler( sampler );
+        olc::SetWarpThreads( 1 );
+        std::fill( large.pColData.begin(), large.pColData.end(), olc::BLANK );
+        for (const std::function<void()> &DrawDirect : vDirect) {
+            DrawDirect();
+        }
+        std::vector<olc::Pixel> vExpected = large.pColData;
+        for (int nThreadCount : { 1, 4 }) {
+            olc::SetWarpThreads( nThreadCount );
+            std::fill( large.pColData.begin(), large.pColData.end(), olc::BLANK );
+            batch.Draw( gfx );
+            int nDiffer = 0, nDrawn = 0;
+            for (size_t i = 0; i < vExpected.size(); i++) {
+                nDiffer += (large.pColData[i] != vExpected[i]);
+                nDrawn  += (vExpected[i] != olc::BLANK);
+            }
+            Report( nDrawn > 0 && nDiffer == 0, std::string( "batch " ) + (sampler == olc::WarpSampler::NEAREST ? "NEAREST " : "BILINEAR ") +
+                std::to_string( nThreadCount ) + (nThreadCount == 1 ? " thread" : " threads"),
+                std::to_string( nDiffer ) + " of " + std::to_string( nDrawn ) + " pixels differ from drawing the " + std::to_string( batch.Size()) + " items one by one" );
+        }
+    }
+    olc::SetWarpThreads( nThreads );
+    olc::SetWarpSampler( olc::WarpSampler::NEAREST );
+    gfx->SetDrawTarget( pTarget );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Draws random rotated sprites at angles and positions on the grid the rotation cache quantises to, with and without
+// the cache. Each sprite is drawn twice with the cache: once when the bitmap is rendered (a miss), and once moved by a
+// whole nr of pixels (a hit). Both must give the same pixels as drawing the sprite in place without the cache.
+void CheckRotationCache( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 50, 40 );
+    const int nSteps = 256;
+    std::mt19937 rng( 19 );
+    std::uniform_int_distribution<int> Step( 0, nSteps - 1 ), Sixteenths( -1600, 4000 ), Move( -60, 60 );
+    std::uniform_real_distribution<float> Scale( 0.5f, 3.0f );
+    auto DrawSprite = [&]( bool bCached, olc::vf2d pos, float fAngle, olc::vf2d center, olc::vf2d scale ) {
+        olc::SetWarpRotationCache( bCached ? 64 * 1024 * 1024 : 0, nSteps );
+        std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+        olc::DrawRotatedSprite( gfx, pos, pSprite, fAngle, center, scale );
+        return pTarget->pColData;
+    };
+    int nWrong = 0, nHits = 0, nMisses = 0;
+    for (int nCase = 0; nCase < 100; nCase++) {
+        float fAngle = float( 6.283185307179586 * Step( rng ) / nSteps );
+        olc::vf2d center = { Sixteenths( rng ) / 32.0f, Sixteenths( rng ) / 48.0f };
+        center = { std::round( center.x * 16.0f ) / 16.0f, std::round( center.y * 16.0f ) / 16.0f };
+        olc::vf2d offset = { Sixteenths( rng ) / 100.0f, Sixteenths( rng ) / 100.0f };
+        offset = { std::round( offset.x * 16.0f ) / 16.0f, std::round( offset.y * 16.0f ) / 16.0f };
+        olc::vf2d scale = { Scale( rng ), Scale( rng ) };
+        olc::vf2d move = { float( Move( rng )), float( Move( rng )) };
+
+        std::vector<olc::Pixel> vDirect = DrawSprite( false, center + offset, fAngle, center, scale );
+        std::vector<olc::Pixel> vMoved  = DrawSprite( false, center + move + offset, fAngle, center + move, scale );
+        // the cache is cleared when it's enabled, so the first draw renders the bitmap, and the second one reuses it
+        olc::SetWarpRotationCache( 64 * 1024 * 1024, nSteps );
+        for (int nDraw = 0; nDraw < 2; nDraw++) {
+            olc::vf2d shift = (nDraw == 0) ? olc::vf2d( 0.0f, 0.0f ) : move;
+            std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+            olc::DrawRotatedSprite( gfx, center + shift + offset, pSprite, fAngle, center + shift, scale );
+            const std::vector<olc::Pixel> &vExpected = (nDraw == 0) ? vDirect : vMoved;
+            for (size_t i = 0; i < vExpected.size(); i++) {
+                nWrong += (pTarget->pColData[i] != vExpected[i]);
+            }
+        }
+        olc::WarpRotationCacheReport report = olc::GetWarpRotationCacheReport();
+        nHits   += int( report.nHits   );
+        nMisses += int( report.nMisses );
+    }
+    olc::SetWarpRotationCache( 0 );
+    Report( nWrong == 0 && nHits == 100 && nMisses == 100, "rotation cache", std::to_string( nWrong ) + " wrong pixels, " +
+        std::to_string( nMisses ) + " misses and " + std::to_string( nHits ) + " hits" );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Bakes the UV map of a plan on a small draw target, and checks that drawing the plan gives the same pixels as
+// DrawWarpedSprite(), on that target and on a larger one (where the map doesn't hold all pixels of the quad)
+void CheckUVMap( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    olc::Sprite small( 120, 90 );
+    std::array<olc::vf2d, 4> points = { olc::vf2d( 30.0f, 20.0f ), olc::vf2d( 45.0f, 140.0f ), olc::vf2d( 190.0f, 125.0f ), olc::vf2d( 160.0f, 10.0f ) };
+    olc::WarpPlan plan;
+    plan.SetWarped( points );
+    gfx->SetDrawTarget( &small );
+    plan.BakeUVMap( gfx, { pSprite->width, pSprite->height } );
+
+    for (olc::Sprite *pDrawTarget : { &small, pTarget }) {
+        for (int nClipLeft : { INT_MIN, 70 }) {
+            gfx->SetDrawTarget( pDrawTarget );
+            std::fill( pDrawTarget->pColData.begin(), pDrawTarget->pColData.end(), olc::BLANK );
+            olc::DrawWarpedSpriteClipped( gfx, pSprite, points, nClipLeft, INT_MAX );
+            std::vector<olc::Pixel> vExpected = pDrawTarget->pColData;
+            std::fill( pDrawTarget->pColData.begin(), pDrawTarget->pColData.end(), olc::BLANK );
+            plan.DrawClipped( gfx, pSprite, nClipLeft, INT_MAX );
+
+            int nWrong = 0;
+            for (size_t i = 0; i < vExpected.size(); i++) {
+                nWrong += (pDrawTarget->pColData[i] != vExpected[i]);
+            }
+            Report( nWrong == 0, std::string( "uv map " ) + (pDrawTarget == &small ? "baked target" : "larger target") +
+                (nClipLeft == INT_MIN ? "" : " clipped"), std::to_string( nWrong ) + " wrong pixels" );
+        }
+    }
+    gfx->SetDrawTarget( pTarget );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Draws random quads with the block classification enabled and disabled, and checks that the pixels are the same, for
+// both samplers, in Pixel::NORMAL mode and in Pixel::MASK mode with opacity skipping. The sprite is magnified on the
+// larger quads, so that there are cells to fill, and its left half is transparent, so that there are cells to skip.
+// Besides the random quads there are thin convex ones near the corners of the target, whose bounding boxes overlap
+// the target while the quads don't, for the early reject of the whole clipped bounding box
+void CheckBlockClassification( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = MakeIndexSprite( 40, 30 );
+    for (int y = 0; y < pSprite->height; y++) {
+        for (int x = 0; x < pSprite->width / 2; x++) {
+            pSprite->SetPixel( x, y, olc::Pixel( uint8_t( x ), uint8_t( y ), 0, 0 ));
+        }
+    }
+    std::vector<std::array<olc::vf2d, 4>> vQuads = MakeRandomQuads( pTarget, 60, 15 );
+    float w = float( pTarget->width ), h = float( pTarget->height );
+    vQuads.push_back( { olc::vf2d( -50.0f,  20.0f ), olc::vf2d( -40.0f,  30.0f ), olc::vf2d( 31.0f, -40.0f ), olc::vf2d( 20.0f, -50.0f ) } );
+    vQuads.push_back( { olc::vf2d( w + 50.0f, h - 20.0f ), olc::vf2d( w - 20.0f, h + 50.0f ), olc::vf2d( w - 31.0f, h + 40.0f ), olc::vf2d( w + 40.0f, h - 30.0f ) } );
+    int nOff = 0, nAcross = 0;
+    for (const std::array<olc::vf2d, 4> &quad : vQuads) {
+        olc::vi2d UpLeft, LwRght;
+        olc::GetQuadBoundingBox( quad, UpLeft, LwRght );
+        if (LwRght.x < 0 || LwRght.y < 0 || UpLeft.x >= pTarget->width || UpLeft.y >= pTarget->height) {
+            nOff++;
+        } else if (UpLeft.x < 0 || UpLeft.y < 0 || LwRght.x >= pTarget->width || LwRght.y >= pTarget->height) {
+            nAcross++;
+        }
+    }
+    olc::SetWarpOpacitySkipping( true );
+    for (olc::WarpSampler sampler : { olc::WarpSampler::NEAREST, olc::WarpSampler::BILINEAR }) {
+        olc::SetWarpSampler( sampler );
+        for (olc::Pixel::Mode mode : { olc::Pixel::NORMAL, olc::Pixel::MASK }) {
+            gfx->SetPixelMode( mode );
+            std::vector<olc::Pixel> vResult[2];
+            for (bool bClassify : { true, false }) {
+                olc::SetWarpBlockClassification( bClassify );
+                for (const std::array<olc::vf2d, 4> &quad : vQuads) {
+                    std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+                    olc::DrawWarpedSprite( gfx, pSprite, quad );
+                    vResult[bClassify].insert( vResult[bClassify].end(), pTarget->pColData.begin(), pTarget->pColData.end() );
+                }
+            }
+            int nDiffer = 0, nDrawn = 0;
+            for (size_t i = 0; i < vResult[0].size(); i++) {
+                nDiffer += (vResult[1][i] != vResult[0][i]);
+                nDrawn  += (vResult[0][i] != olc::BLANK);
+            }
+            Report( nDrawn > 0 && nDiffer == 0, std::string( "block classification " ) + (sampler == olc::WarpSampler::NEAREST ? "NEAREST" : "BILINEAR") +
+                (mode == olc::Pixel::MASK ? " MASK" : " NORMAL"), std::to_string( nDiffer ) + " of " + std::to_string( nDrawn ) + " pixels differ on " +
+                std::to_string( vQuads.size() ) + " quads (" + std::to_string( nOff ) + " off the target, " + std::to_string( nAcross ) + " across its edges)" );
+        }
+    }
+    gfx->SetPixelMode( olc::Pixel::NORMAL );
+    olc::SetWarpBlockClassification( true );
+    olc::SetWarpSampler( olc::WarpSampler::NEAREST );
+    olc::SetWarpOpacitySkipping( false );
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// Checks WarpColumnRenderer::Draw() against DrawWarpedSpriteClipped() and against itself for walls and billboards that
+// overlap. The far wall and the billboard don't share any colour with the near wall, so it's visible in the draw
+// target which item a pixel came from
+void CheckColumnRenderer( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pNear      = MakeIndexSprite( 64, 48 );
+    olc::Sprite *pFar       = new olc::Sprite( 32, 32 );
+    olc::Sprite *pBillboard = new olc::Sprite( 24, 24 );
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 32; x++) {
+            pFar->SetPixel( x, y, olc::Pixel( uint8_t( x ), uint8_t( y ), 200 ));
+        }
+    }
+    // the billboard has opaque, half transparent and fully transparent texels
+    for (int y = 0; y < 24; y++) {
+        for (int x = 0; x < 24; x++) {
+            int nKind = (x / 3 + y / 3) % 3;
+            pBillboard->SetPixel( x, y, olc::Pixel( uint8_t( x ), uint8_t( y ), 100, uint8_t( nKind == 0 ? 255 : (nKind == 1 ? 128 : 0) )));
+        }
+    }
+    olc::Pixel background = olc::Pixel( 10, 60, 110 );
+    auto Clear = [&]() {
+        std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), background );
+    };
+    auto CountDiffs = [&]( const std::vector<olc::Pixel> &vExpected ) {
+        int nDiffs = 0;
+        for (size_t i = 0; i < vExpected.size(); i++) {
+            nDiffs += (pTarget->pColData[i] != vExpected[i]);
+        }
+        return nDiffs;
+    };
+    std::array<olc::vf2d, 4> wall = { olc::vf2d( 20.0f, 30.0f ), olc::vf2d( 20.0f, 120.0f ), olc::vf2d( 180.0f, 100.0f ), olc::vf2d( 180.0f, 50.0f ) };
+
+    // a single wall. The renderer shades with a table of 64 levels, and picks the level per column from the depth, which
+    // is interpolated as 1 / depth over the bounding box of the quad (see WarpColumnRenderer::Draw())
+    {
+        const int SHADE_LEVELS = 64;
+        float fMaxDepth  = 12.0f, fMinShade   = 0.2f;
+        float fDepthLeft =  2.0f, fDepthRight = 9.0f;
+        int   nClipLeft  = 35   , nClipRight  = 161;
+        Clear();
+        olc::DrawWarpedSpriteClipped( gfx, pNear, wall, nClipLeft, nClipRight );
+        olc::vi2d UpLeft, LwRght;
+        olc::GetQuadBoundingBox( wall, UpLeft, LwRght );
+        float fLevelScale = float( SHADE_LEVELS - 1 ) / fMaxDepth;
+        for (int x = 0; x < pTarget->width; x++) {
+            float fT     = float( x - UpLeft.x ) / float( LwRght.x - UpLeft.x );
+            float fDepth = 1.0f / (1.0f / fDepthLeft + (1.0f / fDepthRight - 1.0f / fDepthLeft) * fT);
+            int nLevel   = int( std::min( float( SHADE_LEVELS - 1 ), fDepth * fLevelScale + 0.5f ));
+            float fShade = std::max( fMinShade, 1.0f - float( nLevel ) / float( SHADE_LEVELS - 1 ));
+            auto Shade = [&]( uint8_t c ) { return uint8_t( std::min( 255.0f, std::max( 0.0f, float( c ) * fShade ))); };
+            for (int y = 0; y < pTarget->height; y++) {
+                olc::Pixel p = pTarget->GetPixel( x, y );
+                if (p != background) {
+                    pTarget->SetPixel( x, y, olc::Pixel( Shade( p.r ), Shade( p.g ), Shade( p.b ), p.a ));
+                }
+            }
+        }
+        std::vector<olc::Pixel> vExpected = pTarget->pColData;
+        int nDrawn = int( vExpected.size() - std::count( vExpected.begin(), vExpected.end(), background ));
+        Clear();
+        olc::WarpColumnRenderer renderer;
+        renderer.SetDepthShading( fMaxDepth, fMinShade );
+        renderer.AddWall( pNear, wall, nClipLeft, nClipRight, fDepthLeft, fDepthRight );
+        renderer.Draw( gfx );
+        int nDiffs = CountDiffs( vExpected );
+        Report( nDrawn > 0 && nDiffs == 0, "column renderer single wall",
+            std::to_string( nDiffs ) + " of " + std::to_string( nDrawn ) + " pixels differ from DrawWarpedSpriteClipped() with shading" );
+    }
+
+    // a far wall that lies completely behind the near one, added before and after it. Only the near wall may show, and
+    // (with WARP_STATS) no more pixels may be counted as drawn than for the near wall alone
+    {
+        std::array<olc::vf2d, 4> far = { olc::vf2d( 50.0f, 50.0f ), olc::vf2d( 55.0f, 95.0f ), olc::vf2d( 140.0f, 85.0f ), olc::vf2d( 135.0f, 60.0f ) };
+        olc::WarpColumnRenderer renderer;
+        renderer.AddWall( pNear, wall, INT_MIN, INT_MAX, 3.0f, 3.0f );
+        olc::ResetWarpStats();
+        Clear();
+        renderer.Draw( gfx );
+        std::vector<olc::Pixel> vExpected = pTarget->pColData;
+        uint64_t nNearDrawn = olc::GetWarpStats().entries[int( olc::WarpEntry::COLUMN_DRAW )].nDrawnPixels;
+        for (bool bFarFirst : { true, false }) {
+            renderer.Clear();
+            if (bFarFirst) {
+                renderer.AddWall( pFar, far, INT_MIN, INT_MAX, 5.0f, 6.0f );
+            }
+            renderer.AddWall( pNear, wall, INT_MIN, INT_MAX, 3.0f, 3.0f );
+            if (!bFarFirst) {
+                renderer.AddWall( pFar, far, INT_MIN, INT_MAX, 5.0f, 6.0f );
+            }
+            olc::ResetWarpStats();
+            Clear();
+            renderer.Draw( gfx );
+            uint64_t nDrawn = olc::GetWarpStats().entries[int( olc::WarpEntry::COLUMN_DRAW )].nDrawnPixels;
+            int nDiffs = CountDiffs( vExpected );
+            Report( nDiffs == 0 && nDrawn == nNearDrawn, std::string( "column renderer hidden wall, far wall added " ) + (bFarFirst ? "first" : "last"),
+                std::to_string( nDiffs ) + " pixels differ from the near wall alone, " + std::to_string( nDrawn ) + " pixels drawn (" +
+                std::to_string( nNearDrawn ) + " for the near wall alone)" );
+        }
+    }
+
+    // a billboard in front of the far wall. Where the billboard texel isn't opaque, the draw target must keep the
+    // background when it's drawn alone, and show the far wall when that's behind it - which it can't if the depth
+    // buffer was written there
+    {
+        std::array<olc::vf2d, 4> far  = { olc::vf2d( 30.0f, 20.0f ), olc::vf2d( 25.0f, 130.0f ), olc::vf2d( 175.0f, 135.0f ), olc::vf2d( 170.0f, 15.0f ) };
+        std::array<olc::vf2d, 4> bill = { olc::vf2d( 60.0f, 40.0f ), olc::vf2d( 60.0f, 110.0f ), olc::vf2d( 130.0f, 110.0f ), olc::vf2d( 130.0f, 40.0f ) };
+        // the sampled billboard texels, with alpha 0 for the pixels that are not covered
+        std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+        olc::DrawWarpedSprite( gfx, pBillboard, bill );
+        std::vector<olc::Pixel> vSampled = pTarget->pColData;
+        Clear();
+        olc::WarpColumnRenderer renderer;
+        renderer.AddWall( pFar, far, INT_MIN, INT_MAX, 8.0f, 8.0f );
+        renderer.Draw( gfx );
+        std::vector<olc::Pixel> vFarOnly = pTarget->pColData;
+
+        for (bool bWithWall : { false, true }) {
+            renderer.Clear();
+            renderer.AddBillboard( pBillboard, bill, INT_MIN, INT_MAX, 4.0f );
+            if (bWithWall) {
+                renderer.AddWall( pFar, far, INT_MIN, INT_MAX, 8.0f, 8.0f );
+            }
+            Clear();
+            renderer.Draw( gfx );
+            int nOpaque = 0, nSeeThrough = 0, nWrong = 0;
+            for (size_t i = 0; i < vSampled.size(); i++) {
+                olc::Pixel behind = bWithWall ? vFarOnly[i] : background;
+                if (vSampled[i].a == 255) {
+                    nOpaque++;
+                    nWrong += (pTarget->pColData[i] != vSampled[i]);
+                } else {
+                    nSeeThrough += (vSampled[i].a != 0);
+                    nWrong += (pTarget->pColData[i] != behind);
+                }
+            }
+            Report( nOpaque > 0 && nSeeThrough > 0 && nWrong == 0, std::string( "column renderer billboard" ) + (bWithWall ? " in front of a wall" : ""),
+                std::to_string( nWrong ) + " wrong pixels, " + std::to_string( nOpaque ) + " opaque and " + std::to_string( nSeeThrough ) +
+                " half transparent billboard pixels" );
+        }
+    }
+    for (olc::Sprite *pSprite : { pNear, pFar, pBillboard }) {
+        olc::InvalidateWarpTextureCache( pSprite );
+        delete pSprite;
+    }
+}
+
+// Draws a quad in Pixel::ALPHA mode with blend factor fBlend, and checks that each pixel is blended as
+// PixelGameEngine::Draw() does it, using the colours of the same quad drawn in Pixel::NORMAL mode
+void CheckAlphaBlend( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    olc::Sprite *pSprite = new olc::Sprite( 30, 20 );
+    for (int y = 0; y < pSprite->height; y++) {
+        for (int x = 0; x < pSprite->width; x++) {
+            pSprite->SetPixel( x, y, olc::Pixel( uint8_t( x * 8 ), uint8_t( y * 12 ), 200, uint8_t( (x + y) % 3 == 0 ? 255 : 100 )));
+        }
+    }
+    std::array<olc::vf2d, 4> points = { olc::vf2d( 20.0f, 10.0f ), olc::vf2d( 5.0f, 120.0f ), olc::vf2d( 170.0f, 140.0f ), olc::vf2d( 150.0f, 30.0f ) };
+    olc::Pixel background = olc::Pixel( 10, 60, 110 );
+    float fBlend = 0.5f;
+
+    // the sampled colours, with alpha 0 for the pixels that are not covered
+    std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+    olc::DrawWarpedSprite( gfx, pSprite, points );
+    std::vector<olc::Pixel> vSampled = pTarget->pColData;
+
+    for (bool bMirrored : { false, true }) {
+        if (bMirrored) {
+            olc::SetWarpPixelBlend( fBlend );
+        }
+        std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), background );
+        gfx->SetPixelMode( olc::Pixel::ALPHA );
+        gfx->SetPixelBlend( fBlend );
+        olc::DrawWarpedSprite( gfx, pSprite, points );
+        gfx->SetPixelMode( olc::Pixel::NORMAL );
+        gfx->SetPixelBlend( 1.0f );
+
+        int nWrong = 0;
+        for (size_t i = 0; i < vSampled.size(); i++) {
+            olc::Pixel expected = background;
+            if (vSampled[i].a != 0) {
+                // same blending as PixelGameEngine::Draw()
+                float a = (float)(vSampled[i].a / 255.0f) * fBlend;
+                float c = 1.0f - a;
+                expected = olc::Pixel( (uint8_t)(a * (float)vSampled[i].r + c * (float)background.r),
+                                       (uint8_t)(a * (float)vSampled[i].g + c * (float)background.g),
+                                       (uint8_t)(a * (float)vSampled[i].b + c * (float)background.b));
+            }
+            nWrong += (pTarget->pColData[i] != expected);
+        }
+        Report( nWrong == 0, std::string( "alpha " ) + (bMirrored ? "with SetWarpPixelBlend()" : "with SetPixelBlend()"),
+            std::to_string( nWrong ) + " wrong pixels" );
+    }
+    olc::InvalidateWarpTextureCache( pSprite );
+    delete pSprite;
+}
+
+// returns the nr of pixels of the bounding boxes that are not accounted for by the covered and rejected pixels
+int64_t UnaccountedPixels( const olc::WarpStats &stats ) {
+    return int64_t( stats.nBoxPixels ) - int64_t( stats.nCoveredPixels + stats.nRejectClipped + stats.nRejectDiscriminant +
+        stats.nRejectDenominator + stats.nRejectOutOfRange );
+}
+
+// Draws with each kind of entry point on the thread pool, and checks that the counters of the instrumentation add up,
+// and that they are counted for the entry point only. For opaque sprites, the covered pixels must be the pixels that
+// are drawn. Then two threads draw at the same time, with different entry points, and each must get its own counters.
+void CheckStats( olc::PixelGameEngine *gfx, olc::Sprite *pTarget ) {
+    if (!olc::GetWarpStats().bEnabled) {
+        printf( "SKIP stats: compile ManipulatedSprite.cpp with WARP_STATS to check the instrumentation\n" );
+        return;
+    }
+    olc::Sprite *pSprite = MakeIndexSprite( 64, 48 );
+    olc::Sprite *pSmall  = MakeIndexSprite( 12, 9 );
+    olc::Sprite *pMasked = MakeIndexSprite( 64, 48 );
+    for (int y = 0; y < pMasked->height; y++) {
+        for (int x = 0; x < pMasked->width; x++) {
+            if (x < pMasked->width / 2) {
+                pMasked->SetPixel( x, y, olc::BLANK );
+            }
+        }
+    }
+    std::array<olc::vf2d, 4> warped    = { olc::vf2d( -20.3f, 10.1f ), olc::vf2d( 30.7f, 170.2f ), olc::vf2d( 190.1f, 120.9f ), olc::vf2d( 160.6f, -15.4f ) };
+    std::array<olc::vf2d, 4> projected = { olc::vf2d( 10.3f, 20.1f ), olc::vf2d( 30.7f, 140.2f ), olc::vf2d( 230.1f, 120.9f ), olc::vf2d( 170.6f, 0.4f ) };
+    auto DrawRotated = [&]( olc::PixelGameEngine *pge ) {
+        olc::DrawRotatedSprite( pge, { 40.0f, 30.0f }, pSprite, 0.37f, { 90.0f, 70.0f }, { 2.7f, 2.3f } );
+    };
+
+    struct StatsCase {
+        std::string sName;
+        olc::WarpEntry entry;
+        bool bOpaque;       // covered pixels are the drawn pixels
+        std::function<void()> Draw;
+    };
+    olc::WarpPlan plan;
+    plan.SetWarped( warped );
+    plan.BakeUVMap( gfx, { pSprite->width, pSprite->height } );
+    std::vector<StatsCase> vCases = {
+        { "warped",    olc::WarpEntry::DRAW_WARPED,     true , [&]() { olc::DrawWarpedSprite( gfx, pSprite, warped ); } },
+        // with cells that are filled with a single texel
+        { "magnified", olc::WarpEntry::DRAW_WARPED,     true , [&]() { olc::DrawWarpedSprite( gfx, pSmall, warped ); } },
+        // with cells that are skipped since they only map to transparent texels
+        { "masked",    olc::WarpEntry::DRAW_WARPED,     false, [&]() {
+            olc::SetWarpOpacitySkipping( true );
+            gfx->SetPixelMode( olc::Pixel::MASK );
+            olc::DrawWarpedSprite( gfx, pMasked, warped );
+            gfx->SetPixelMode( olc::Pixel::NORMAL );
+            olc::SetWarpOpacitySkipping( false );
+        } },
+        { "rotated",   olc::WarpEntry::DRAW_ROTATED,    true , [&]() { DrawRotated( gfx ); } },
+        { "rotation cache", olc::WarpEntry::DRAW_ROTATED, true, [&]() {
+            olc::SetWarpRotationCache( 64 * 1024 * 1024 );
+            DrawRotated( gfx );
+            std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+            olc::ResetWarpStats();
+            DrawRotated( gfx );
+            olc::SetWarpRotationCache( 0 );
+        } },
+        { "projective", olc::WarpEntry::DRAW_PROJECTIVE, true, [&]() { olc::DrawProjectiveSprite( gfx, pSprite, projected ); } },
+        { "uv map",    olc::WarpEntry::PLAN_DRAW,       true , [&]() { plan.Draw( gfx, pSprite ); } },
+        { "batch",     olc::WarpEntry::BATCH_DRAW,      true , [&]() {
+            olc::WarpedSpriteBatch batch;
+            batch.AddWarped( pSprite, { olc::vf2d( 5.0f, 5.0f ), olc::vf2d( 10.0f, 70.0f ), olc::vf2d( 95.0f, 60.0f ), olc::vf2d( 80.0f, 2.0f ) } );
+            batch.AddRotated( pSprite, { 150.0f, 100.0f }, 0.8f, { 32.0f, 24.0f }, { 1.5f, 1.5f } );
+            batch.Draw( gfx );
+        } },
+        { "columns",   olc::WarpEntry::COLUMN_DRAW,     false, [&]() {
+            olc::WarpColumnRenderer columns;
+            columns.AddWall( pSprite, { olc::vf2d( 0.0f, 20.0f ), olc::vf2d( 0.0f, 130.0f ), olc::vf2d( 200.0f, 110.0f ), olc::vf2d( 200.0f, 40.0f ) }, 0, 199, 2.0f, 4.0f );
+            columns.AddWall( pSprite, { olc::vf2d( 50.0f, 40.0f ), olc::vf2d( 50.0f, 110.0f ), olc::vf2d( 150.0f, 100.0f ), olc::vf2d( 150.0f, 50.0f ) }, 0, 199, 5.0f, 6.0f );
+            columns.AddBillboard( pMasked, { olc::vf2d( 60.0f, 30.0f ), olc::vf2d( 60.0f, 120.0f ), olc::vf2d( 120.0f, 120.0f ), olc::vf2d( 120.0f, 30.0f ) }, 0, 199, 1.0f );
+            columns.Draw( gfx );
+        } },
+    };
+    olc::SetWarpThreads( 4 );
+    for (const StatsCase &sc : vCases) {
+        std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+        olc::ResetWarpStats();
+        sc.Draw();
+        olc::WarpStatsSnapshot snapshot = olc::GetWarpStats();
+        const olc::WarpStats &stats = snapshot.entries[int( sc.entry )];
+        olc::WarpStats total = snapshot.Total();
+        int64_t nDrawn = 0;
+        for (const olc::Pixel &p : pTarget->pColData) {
+            nDrawn += (p != olc::BLANK);
+        }
+        bool bPass = UnaccountedPixels( stats ) == 0 && stats.nBoxPixels > 0 && total.nBoxPixels == stats.nBoxPixels &&
+                     total.nCoveredPixels == stats.nCoveredPixels && (!sc.bOpaque || int64_t( stats.nCoveredPixels ) == nDrawn);
+        Report( bPass, "stats " + sc.sName, std::to_string( stats.nBoxPixels ) + " box pixels, " + std::to_string( UnaccountedPixels( stats )) +
+            " unaccounted, " + std::to_string( stats.nCoveredPixels ) + " covered, " + std::to_string( nDrawn ) + " drawn, " +
+            std::to_string( total.nBoxPixels - stats.nBoxPixels ) + " box pixels for other entry points" );
+    }
+
+    // the other thread draws on its own target, with the rotated sprite
+    std::fill( pTarget->pColData.begin(), pTarget->pColData.end(), olc::BLANK );
+    olc::ResetWarpStats();
+    olc::DrawWarpedSprite( gfx, pSprite, warped );
+    olc::WarpStats warpedOnce = olc::GetWarpStats().entries[int( olc::WarpEntry::DRAW_WARPED )];
+    olc::ResetWarpStats();
+    DrawRotated( gfx );
+    olc::WarpStats rotatedOnce = olc::GetWarpStats().entries[int( olc::WarpEntry::DRAW_ROTATED )];
+    olc::ResetWarpStats();
+    std::atomic<bool> bStop( false );
+    std::atomic<int>  nRotated( 0 );
+    std::thread drawer( [&]() {
+        olc::Sprite target( pTarget->width, pTarget->height );
+        HeadlessEngine engine;
+        engine.SetDrawTarget( &target );
+        while (!bStop) {
+            DrawRotated( &engine );
+            nRotated++;
+        }
+    });
+    int nWarped = 0;
+    auto tStart = std::chrono::steady_clock::now();
+    while (nWarped < 20 || std::chrono::steady_clock::now() - tStart < std::chrono::milliseconds( 300 )) {
+        olc::DrawWarpedSprite( gfx, pSprite, warped );
+        nWarped++;
+    }
+    bStop = true;
+    drawer.join();
+    olc::WarpStatsSnapshot snapshot = olc::GetWarpStats();
+    const olc::WarpStats &warpedStats  = snapshot.entries[int( olc::WarpEntry::DRAW_WARPED  )];
+    const olc::WarpStats &rotatedStats = snapshot.entries[int( olc::WarpEntry::DRAW_ROTATED )];
+    int64_t nWrongWarped  = int64_t( warpedStats.nCoveredPixels  ) - int64_t( warpedOnce.nCoveredPixels  ) * nWarped;
+    int64_t nWrongRotated = int64_t( rotatedStats.nCoveredPixels ) - int64_t( rotatedOnce.nCoveredPixels ) * nRotated;
+    bool bPass = nWrongWarped == 0 && nWrongRotated == 0 && UnaccountedPixels( warpedStats ) == 0 && UnaccountedPixels( rotatedStats ) == 0 &&
+                 warpedStats.nCalls == uint64_t( nWarped ) && rotatedStats.nCalls == uint64_t( nRotated );
+    Report( bPass, "stats threads", std::to_string( nWarped ) + " warped and " + std::to_string( nRotated ) + " rotated draws, " +
+        std::to_string( nWrongWarped ) + " and " + std::to_string( nWrongRotated ) + " covered pixels counted for the wrong entry point" );
+    olc::SetWarpThreads( 1 );
+
+    olc::InvalidateWarpTextureCache( pSprite );
+    olc::InvalidateWarpTextureCache( pSmall  );
+    olc::InvalidateWarpTextureCache( pMasked );
+    delete pSprite;
+    delete pSmall;
+    delete pMasked;
+}
+
+int main() {
+    // the target must outlive the engine, since the engine keeps pointing at it
+    olc::Sprite target( 200, 150 );
+    HeadlessEngine engine;
+    engine.SetDrawTarget( &target );
+    engine.SetPixelMode( olc::Pixel::NORMAL );
+
+    CheckIdentity( &engine, &target );
+    CheckPrecision();
+    CheckPrecisionThreads( &engine, &target );
+    CheckKernels( &engine, &target );
+    CheckThreads( &engine, &target );
+    CheckBatch( &engine, &target );
+    CheckRotationCache( &engine, &target );
+    CheckUVMap( &engine, &target );
+    CheckBlockClassification( &engine, &target );
+    CheckColumnRenderer( &engine, &target );
+    CheckAlphaBlend( &engine, &target );
+    CheckStats( &engine, &target );
+
+    printf( "%d checks failed\n", nFailed );
+    return nFailed;
+}